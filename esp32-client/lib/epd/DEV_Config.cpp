@@ -28,6 +28,14 @@
 #
 ******************************************************************************/
 #include "DEV_Config.h"
+#include "Log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+#if EPD_USE_HW_SPI
+#include "driver/spi_master.h"
+#include "soc/soc_memory_layout.h"
+#endif
 
 void GPIO_Config(void)
 {
@@ -61,6 +69,159 @@ void GPIO_Mode(UWORD GPIO_Pin, UWORD Mode)
 		pinMode(GPIO_Pin , OUTPUT);
 	}
 }
+#if EPD_USE_HW_SPI
+static spi_device_handle_t epd_spi = NULL;
+static UDOUBLE spi_clock_hz = EPD_SPI_CLOCK_HZ;
+static bool spi_bus_ready = false;
+static UBYTE *dma_buf[EPD_SPI_QUEUE_DEPTH];
+static spi_transaction_t dma_trans[EPD_SPI_QUEUE_DEPTH];
+static int dma_next = 0;
+static int dma_inflight = 0;
+
+// Command batches: each queued command is one transaction whose chip
+// selects are driven from the pre/post callbacks, so a whole register
+// sequence can be queued without the CPU toggling pins in between.
+static UBYTE *cmd_buf = NULL;
+static UDOUBLE cmd_buf_used = 0;
+static spi_transaction_t cmd_trans[EPD_SPI_CMD_QUEUE];
+static int cmd_next = 0;
+
+#ifdef EPD_SPI_TRACE
+static DEV_SPI_Tracer spi_tracer = NULL;
+
+void DEV_SPI_SetTracer(DEV_SPI_Tracer tracer)
+{
+    spi_tracer = tracer;
+}
+
+#define DEV_SPI_TRACE(kind, cs, data, rowLen, stride, rows) \
+    do { if (spi_tracer) spi_tracer(kind, cs, data, rowLen, stride, rows); } while (0)
+#else
+#define DEV_SPI_TRACE(kind, cs, data, rowLen, stride, rows) do { } while (0)
+#endif
+
+static void IRAM_ATTR DEV_SPI_PreTransfer(spi_transaction_t *t)
+{
+    uintptr_t cs = (uintptr_t)t->user;
+    if (cs & EPD_CS_M) DEV_GPIO_Clear(EPD_CS_M_PIN);
+    if (cs & EPD_CS_S) DEV_GPIO_Clear(EPD_CS_S_PIN);
+}
+
+static void IRAM_ATTR DEV_SPI_PostTransfer(spi_transaction_t *t)
+{
+    uintptr_t cs = (uintptr_t)t->user;
+    if (cs & EPD_CS_M) DEV_GPIO_Set(EPD_CS_M_PIN);
+    if (cs & EPD_CS_S) DEV_GPIO_Set(EPD_CS_S_PIN);
+}
+
+static bool DEV_SPI_AddDevice(void)
+{
+    // Chip selects stay under software control: the panel needs both
+    // controllers selected at once for shared commands.
+    spi_device_interface_config_t dev = {};
+    dev.mode = 0;
+    dev.clock_speed_hz = spi_clock_hz;
+    dev.spics_io_num = -1;
+    dev.queue_size = EPD_SPI_CMD_QUEUE;
+    dev.flags = SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX;
+    dev.pre_cb = DEV_SPI_PreTransfer;
+    dev.post_cb = DEV_SPI_PostTransfer;
+    return spi_bus_add_device(SPI2_HOST, &dev, &epd_spi) == ESP_OK;
+}
+
+static bool DEV_SPI_Init(void)
+{
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = EPD_MOSI_PIN;
+    bus.miso_io_num = -1;
+    bus.sclk_io_num = EPD_SCK_PIN;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = EPD_SPI_DMA_CHUNK;
+    if (spi_bus_initialize(SPI2_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK) {
+        return false;
+    }
+    spi_bus_ready = true;
+
+    if (!DEV_SPI_AddDevice()) {
+        epd_spi = NULL;
+        return false;
+    }
+
+    for (int i = 0; i < EPD_SPI_QUEUE_DEPTH; i++) {
+        dma_buf[i] = (UBYTE *)heap_caps_malloc(EPD_SPI_DMA_CHUNK, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!dma_buf[i]) {
+            return false;
+        }
+    }
+    cmd_buf = (UBYTE *)heap_caps_malloc(EPD_SPI_CMD_BUFFER, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (!cmd_buf) {
+        return false;
+    }
+    dma_next = 0;
+    dma_inflight = 0;
+    cmd_next = 0;
+    cmd_buf_used = 0;
+    return true;
+}
+
+static void DEV_SPI_Deinit(void)
+{
+    if (epd_spi) {
+        spi_bus_remove_device(epd_spi);
+        epd_spi = NULL;
+    }
+    if (spi_bus_ready) {
+        spi_bus_free(SPI2_HOST);
+        spi_bus_ready = false;
+    }
+    for (int i = 0; i < EPD_SPI_QUEUE_DEPTH; i++) {
+        heap_caps_free(dma_buf[i]);
+        dma_buf[i] = NULL;
+    }
+    heap_caps_free(cmd_buf);
+    cmd_buf = NULL;
+}
+
+// Wait for the oldest queued transaction. Results come back in queue order,
+// so once this returns the bounce buffer at dma_next is free again.
+static void DEV_SPI_Reap(void)
+{
+    spi_transaction_t *done;
+    spi_device_get_trans_result(epd_spi, &done, portMAX_DELAY);
+    dma_inflight--;
+}
+
+static void DEV_SPI_Flush(void)
+{
+    while (dma_inflight > 0) {
+        DEV_SPI_Reap();
+    }
+    cmd_buf_used = 0;
+}
+
+// Claim the next transaction slot, waiting for it to drain if the queue is full
+static int DEV_SPI_NextSlot(void)
+{
+    if (dma_inflight == EPD_SPI_QUEUE_DEPTH) {
+        DEV_SPI_Reap();
+    }
+    int slot = dma_next;
+    dma_next = (dma_next + 1) % EPD_SPI_QUEUE_DEPTH;
+    return slot;
+}
+
+static void DEV_SPI_Queue(int slot, const UBYTE *pData, UDOUBLE len)
+{
+    spi_transaction_t *t = &dma_trans[slot];
+    memset(t, 0, sizeof(*t));
+    t->length = len * 8;
+    t->tx_buffer = pData;
+    spi_device_queue_trans(epd_spi, t, portMAX_DELAY);
+    dma_inflight++;
+}
+#endif
+
 /******************************************************************************
 function:	Module Initialize, the BCM2835 library and initialize the pins, SPI protocol
 parameter:
@@ -75,10 +236,13 @@ UBYTE DEV_Module_Init(void)
 	Serial.begin(115200);
 
 	// spi
-	// SPI.setDataMode(SPI_MODE0);
-	// SPI.setBitOrder(MSBFIRST);
-	// SPI.setClockDivider(SPI_CLOCK_DIV4);
-	// SPI.begin();
+#if EPD_USE_HW_SPI
+	if (!DEV_SPI_Init()) {
+		LOG_E("SPI host init failed");
+		DEV_SPI_Deinit();
+		return 1;
+	}
+#endif
 
 	return 0;
 }
@@ -87,48 +251,337 @@ UBYTE DEV_Module_Init(void)
 function:
 			SPI read and write
 ******************************************************************************/
-
+#if EPD_USE_HW_SPI
 
 void DEV_SPI_WriteByte(UBYTE data)
 {
-    for (int i = 0; i < 8; i++)
-    {
-        if ((data & 0x80) == 0) digitalWrite(EPD_MOSI_PIN, GPIO_PIN_RESET); 
-        else                    digitalWrite(EPD_MOSI_PIN, GPIO_PIN_SET);
+    DEV_SPI_Flush();
+    DEV_SPI_TRACE(EPD_TRACE_BYTE, 0, &data, 1, 1, 1);
+    spi_transaction_t t = {};
+    t.flags = SPI_TRANS_USE_TXDATA;
+    t.length = 8;
+    t.tx_data[0] = data;
+    spi_device_polling_transmit(epd_spi, &t);
+}
 
-        data <<= 1;
-        digitalWrite(EPD_SCK_PIN, GPIO_PIN_SET);     
-        digitalWrite(EPD_SCK_PIN, GPIO_PIN_RESET);
+UBYTE DEV_SPI_ReadByte()
+{
+    DEV_SPI_Flush();
+    spi_transaction_t t = {};
+    t.flags = SPI_TRANS_USE_RXDATA;
+    t.rxlength = 8;
+    spi_device_polling_transmit(epd_spi, &t);
+    return t.rx_data[0];
+}
+
+void DEV_SPI_Write_nByte(UBYTE *pData, UDOUBLE len)
+{
+    DEV_SPI_Write_Rows(pData, len, len, 1);
+}
+
+/******************************************************************************
+function:	Send `rows` blocks of `rowLen` bytes taken every `stride` bytes
+parameter:
+Info:		A stride of 0 repeats the same row. Rows are gathered into the
+			DMA bounce buffers so the source can live anywhere, including
+			PSRAM and memory-mapped flash, without a full-frame copy.
+			Returns once the last byte has been clocked out.
+******************************************************************************/
+void DEV_SPI_Write_Rows(const UBYTE *pData, UDOUBLE rowLen, UDOUBLE stride, UDOUBLE rows)
+{
+    DEV_SPI_Flush();
+    if (rowLen == 0 || rows == 0) {
+        return;
+    }
+    DEV_SPI_TRACE(EPD_TRACE_ROWS, 0, pData, rowLen, stride, rows);
+
+    // Contiguous DMA-capable sources need no bounce buffer at all
+    if (stride == rowLen && esp_ptr_dma_capable(pData)) {
+        UDOUBLE remaining = rowLen * rows;
+        while (remaining > 0) {
+            UDOUBLE n = remaining < EPD_SPI_DMA_CHUNK ? remaining : EPD_SPI_DMA_CHUNK;
+            DEV_SPI_Queue(DEV_SPI_NextSlot(), pData, n);
+            pData += n;
+            remaining -= n;
+        }
+        DEV_SPI_Flush();
+        return;
+    }
+
+    if (rowLen > EPD_SPI_DMA_CHUNK) {
+        // Rows wider than a bounce buffer are split into contiguous pieces
+        for (UDOUBLE r = 0; r < rows; r++) {
+            const UBYTE *row = pData + r * stride;
+            for (UDOUBLE off = 0; off < rowLen; off += EPD_SPI_DMA_CHUNK) {
+                UDOUBLE n = rowLen - off < EPD_SPI_DMA_CHUNK ? rowLen - off : EPD_SPI_DMA_CHUNK;
+                int slot = DEV_SPI_NextSlot();
+                memcpy(dma_buf[slot], row + off, n);
+                DEV_SPI_Queue(slot, dma_buf[slot], n);
+            }
+        }
+        DEV_SPI_Flush();
+        return;
     }
 
+    const UDOUBLE rowsPerChunk = EPD_SPI_DMA_CHUNK / rowLen;
+    UDOUBLE r = 0;
+    while (r < rows) {
+        UDOUBLE n = rows - r < rowsPerChunk ? rows - r : rowsPerChunk;
+        int slot = DEV_SPI_NextSlot();
+        UBYTE *dst = dma_buf[slot];
+        for (UDOUBLE i = 0; i < n; i++, r++) {
+            memcpy(dst + i * rowLen, pData + r * stride, rowLen);
+        }
+        DEV_SPI_Queue(slot, dst, n * rowLen);
+    }
+    DEV_SPI_Flush();
+}
+
+/******************************************************************************
+function:	Queue a command and its parameters for the selected controllers
+parameter:
+    cs   : EPD_CS_M, EPD_CS_S or EPD_CS_BOTH
+Info:		Returns as soon as the transaction is queued; chip selects are
+			asserted and released by the transfer callbacks. Call
+			DEV_SPI_Wait() before touching the bus or pins directly.
+******************************************************************************/
+void DEV_SPI_Queue_Command(UBYTE cs, UBYTE cmd, const UBYTE *pData, UBYTE len)
+{
+    // Keep every command 4-byte aligned so the driver never has to copy it
+    UDOUBLE size = (1 + len + 3) & ~3UL;
+    if (cmd_buf_used + size > EPD_SPI_CMD_BUFFER) {
+        DEV_SPI_Flush();
+    }
+    if (dma_inflight == EPD_SPI_CMD_QUEUE) {
+        DEV_SPI_Reap();
+    }
+
+    UBYTE *dst = cmd_buf + cmd_buf_used;
+    dst[0] = cmd;
+    if (len) {
+        memcpy(dst + 1, pData, len);
+    }
+    cmd_buf_used += size;
+    DEV_SPI_TRACE(EPD_TRACE_COMMAND, cs, dst, 1 + len, 1 + len, 1);
+
+    spi_transaction_t *t = &cmd_trans[cmd_next];
+    cmd_next = (cmd_next + 1) % EPD_SPI_CMD_QUEUE;
+    memset(t, 0, sizeof(*t));
+    t->length = (1 + len) * 8;
+    t->tx_buffer = dst;
+    t->user = (void *)(uintptr_t)cs;
+    spi_device_queue_trans(epd_spi, t, portMAX_DELAY);
+    dma_inflight++;
+}
+
+void DEV_SPI_Wait(void)
+{
+    DEV_SPI_Flush();
+}
+
+/******************************************************************************
+function:	Change the SPI clock, e.g. to a rate found by clock calibration
+Info:		The device is re-added to the bus; the effective rate is the
+			closest APB divider at or below the requested one. Returns
+			false if it could not be added at the new rate; it is then
+			added back at the previous one.
+******************************************************************************/
+bool DEV_SPI_SetClock(UDOUBLE hz)
+{
+    UDOUBLE previous = spi_clock_hz;
+    spi_clock_hz = hz;
+    if (!epd_spi) {
+        return true; // picked up by the next DEV_Module_Init
+    }
+    DEV_SPI_Flush();
+    spi_bus_remove_device(epd_spi);
+    if (DEV_SPI_AddDevice()) {
+        return true;
+    }
+    spi_clock_hz = previous;
+    if (!DEV_SPI_AddDevice()) {
+        epd_spi = NULL;
+    }
+    return false;
+}
+
+UDOUBLE DEV_SPI_GetClock(void)
+{
+    return spi_clock_hz;
+}
+
+#else
+
+/******************************************************************************
+Bit-bang backend: MOSI and SCK are driven through the GPIO set/clear
+registers with the byte loop fully unrolled and kept in IRAM, instead of
+two digitalWrite() calls per clock edge.
+******************************************************************************/
+#define DEV_SPI_BIT(_data, _mask) do { \
+        if ((_data) & (_mask)) DEV_GPIO_Set(EPD_MOSI_PIN); \
+        else                   DEV_GPIO_Clear(EPD_MOSI_PIN); \
+        DEV_GPIO_Set(EPD_SCK_PIN); \
+        DEV_GPIO_Clear(EPD_SCK_PIN); \
+    } while (0)
+
+static inline void IRAM_ATTR DEV_SPI_ShiftOut(UBYTE data)
+{
+    DEV_SPI_BIT(data, 0x80);
+    DEV_SPI_BIT(data, 0x40);
+    DEV_SPI_BIT(data, 0x20);
+    DEV_SPI_BIT(data, 0x10);
+    DEV_SPI_BIT(data, 0x08);
+    DEV_SPI_BIT(data, 0x04);
+    DEV_SPI_BIT(data, 0x02);
+    DEV_SPI_BIT(data, 0x01);
+}
+
+static inline bool DEV_GPIO_Read(int pin)
+{
+    if (pin < 32) return (GPIO.in >> (pin & 31)) & 1;
+    return (GPIO.in1.val >> (pin & 31)) & 1;
+}
+
+void IRAM_ATTR DEV_SPI_WriteByte(UBYTE data)
+{
+    DEV_SPI_ShiftOut(data);
 }
 
 UBYTE DEV_SPI_ReadByte()
 {
-    UBYTE j=0xff;
+    UBYTE j = 0;
     GPIO_Mode(EPD_MOSI_PIN, 0);
     for (int i = 0; i < 8; i++)
     {
-        j = j << 1;
-        if (digitalRead(EPD_MOSI_PIN))  j = j | 0x01;
-        else                            j = j & 0xfe;
-        
-        digitalWrite(EPD_SCK_PIN, GPIO_PIN_SET);     
-        digitalWrite(EPD_SCK_PIN, GPIO_PIN_RESET);
+        j = (j << 1) | DEV_GPIO_Read(EPD_MOSI_PIN);
+        DEV_GPIO_Set(EPD_SCK_PIN);
+        DEV_GPIO_Clear(EPD_SCK_PIN);
     }
     GPIO_Mode(EPD_MOSI_PIN, 1);
     return j;
 }
 
-void DEV_SPI_Write_nByte(UBYTE *pData, UDOUBLE len)
+void IRAM_ATTR DEV_SPI_Write_nByte(UBYTE *pData, UDOUBLE len)
+{
+    for (UDOUBLE i = 0; i < len; i++)
+        DEV_SPI_ShiftOut(pData[i]);
+}
+
+void DEV_SPI_Write_Rows(const UBYTE *pData, UDOUBLE rowLen, UDOUBLE stride, UDOUBLE rows)
+{
+    for (UDOUBLE i = 0; i < rows; i++) {
+        DEV_SPI_Write_nByte((UBYTE *)pData + i * stride, rowLen);
+        if ((i & 31) == 31) {
+            DEV_Delay_ms(1); // a full frame still takes ~1 s, let the idle task run
+        }
+    }
+}
+
+void DEV_SPI_Queue_Command(UBYTE cs, UBYTE cmd, const UBYTE *pData, UBYTE len)
+{
+    if (cs & EPD_CS_M) DEV_Digital_Write(EPD_CS_M_PIN, 0);
+    if (cs & EPD_CS_S) DEV_Digital_Write(EPD_CS_S_PIN, 0);
+    DEV_SPI_WriteByte(cmd);
+    DEV_SPI_Write_nByte((UBYTE *)pData, len);
+    DEV_Digital_Write(EPD_CS_M_PIN, 1);
+    DEV_Digital_Write(EPD_CS_S_PIN, 1);
+}
+
+void DEV_SPI_Wait(void)
+{
+}
+
+bool DEV_SPI_SetClock(UDOUBLE hz)
+{
+    return false; // no clock to set
+}
+
+UDOUBLE DEV_SPI_GetClock(void)
+{
+    return 0;
+}
+
+#ifdef EPD_SPI_TRACE
+void DEV_SPI_SetTracer(DEV_SPI_Tracer tracer)
+{
+    // The bit-bang backend is not traced
+    (void)tracer;
+}
+#endif
+
+#endif
+
+
+#ifdef EPD_SPI_BENCHMARK
+// Reference implementation the register-level loop replaced
+static void DEV_SPI_WriteByte_Arduino(UBYTE data)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        digitalWrite(EPD_MOSI_PIN, (data & 0x80) ? HIGH : LOW);
+        data <<= 1;
+        digitalWrite(EPD_SCK_PIN, HIGH);
+        digitalWrite(EPD_SCK_PIN, LOW);
+    }
+}
+
+/******************************************************************************
+function:	Measure the effective SPI bit rate of the active backend against
+			the original digitalWrite loop
+Info:		Both chip selects are held high, so the panel ignores the data.
+			Call after DEV_Module_Init().
+******************************************************************************/
+void DEV_SPI_Benchmark(void)
 {
-    for (int i = 0; i < len; i++)
-        DEV_SPI_WriteByte(pData[i]);
+    const UDOUBLE len = 32 * 1024;
+    UBYTE *buf = (UBYTE *)heap_caps_malloc(len, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (!buf) {
+        return;
+    }
+    for (UDOUBLE i = 0; i < len; i++) {
+        buf[i] = (UBYTE)(i * 37);
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    DEV_SPI_Write_Rows(buf, len, len, 1);
+    int64_t active = esp_timer_get_time() - t0;
+
+    t0 = esp_timer_get_time();
+    for (UDOUBLE i = 0; i < len; i++) {
+        DEV_SPI_WriteByte_Arduino(buf[i]);
+    }
+    int64_t legacy = esp_timer_get_time() - t0;
+
+    // bits per microsecond == MHz of an evenly clocked bus
+    double activeMhz = len * 8.0 / active;
+    double legacyMhz = len * 8.0 / legacy;
+#if EPD_USE_HW_SPI
+    LOG_I("SPI benchmark: hw spi %.2f MHz at a %u kHz clock, digitalWrite %.2f MHz (%.1fx)",
+          activeMhz, (unsigned)(DEV_SPI_GetClock() / 1000), legacyMhz, activeMhz / legacyMhz);
+#else
+    LOG_I("SPI benchmark: register bit-bang %.2f MHz, digitalWrite %.2f MHz (%.1fx)",
+          activeMhz, legacyMhz, activeMhz / legacyMhz);
+#endif
+    heap_caps_free(buf);
 }
+#endif
 
+/******************************************************************************
+function:   Release the SPI host but leave the panel powered and out of
+            reset, for a controller kept in standby between updates
+******************************************************************************/
+void DEV_Module_Standby(void)
+{
+#if EPD_USE_HW_SPI
+    DEV_SPI_Deinit();
+#endif
+}
 
 void DEV_Module_Exit(void)
 {
+#if EPD_USE_HW_SPI
+    DEV_SPI_Deinit();
+#endif
     digitalWrite(EPD_PWR_PIN , LOW);
     digitalWrite(EPD_RST_PIN , LOW);
 }
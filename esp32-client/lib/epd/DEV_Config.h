@@ -33,6 +33,7 @@
 #include <Arduino.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "soc/gpio_struct.h"
 
 
 
@@ -84,6 +85,49 @@
 
 
 
+/**
+ * SPI backend
+ * EPD_USE_HW_SPI=1 drives the panel through the SPI2 host with DMA,
+ * 0 keeps the original bit-bang implementation.
+**/
+#ifndef EPD_USE_HW_SPI
+#define EPD_USE_HW_SPI 1
+#endif
+
+#ifndef EPD_SPI_CLOCK_HZ
+#define EPD_SPI_CLOCK_HZ    (10 * 1000 * 1000)
+#endif
+
+// Size of each internal DMA bounce buffer. Sources that the DMA engine
+// cannot reach (PSRAM, memory-mapped flash) are streamed through these.
+#define EPD_SPI_DMA_CHUNK   4800
+#define EPD_SPI_QUEUE_DEPTH 2
+
+// Queued command transactions (see DEV_SPI_Queue_Command)
+#define EPD_SPI_CMD_QUEUE   8
+#define EPD_SPI_CMD_BUFFER  256
+
+/**
+ * SPI trace hook for capture builds (CAPTURE_SESSION in src/Capture.h)
+ * The tracer sees every write of the hardware backend before it goes out:
+ * single bytes, queued commands with their parameters, and row writes
+ * (with their layout, not copied).
+**/
+#if defined(CAPTURE_SESSION) && CAPTURE_SESSION && !defined(EPD_SPI_TRACE)
+#define EPD_SPI_TRACE
+#endif
+
+#define EPD_TRACE_BYTE    0
+#define EPD_TRACE_COMMAND 1
+#define EPD_TRACE_ROWS    2
+
+/**
+ * Controller selection for queued commands
+**/
+#define EPD_CS_M    0x01
+#define EPD_CS_S    0x02
+#define EPD_CS_BOTH (EPD_CS_M | EPD_CS_S)
+
 #define GPIO_PIN_SET   1
 #define GPIO_PIN_RESET 0
 
@@ -93,6 +137,17 @@
 #define DEV_Digital_Write(_pin, _value) digitalWrite(_pin, _value == 0? LOW:HIGH)
 #define DEV_Digital_Read(_pin) digitalRead(_pin)
 
+// Direct set/clear registers, safe from ISR context. Pins are compile-time
+// constants so the bank check folds away.
+#define DEV_GPIO_Set(_pin) do { \
+        if ((_pin) < 32) GPIO.out_w1ts = 1UL << ((_pin) & 31); \
+        else GPIO.out1_w1ts.val = 1UL << ((_pin) & 31); \
+    } while (0)
+#define DEV_GPIO_Clear(_pin) do { \
+        if ((_pin) < 32) GPIO.out_w1tc = 1UL << ((_pin) & 31); \
+        else GPIO.out1_w1tc.val = 1UL << ((_pin) & 31); \
+    } while (0)
+
 /**
  * delay x ms
 **/
@@ -104,6 +159,23 @@ void GPIO_Mode(UWORD GPIO_Pin, UWORD Mode);
 void DEV_SPI_WriteByte(UBYTE data);
 UBYTE DEV_SPI_ReadByte();
 void DEV_SPI_Write_nByte(UBYTE *pData, UDOUBLE len);
+void DEV_SPI_Write_Rows(const UBYTE *pData, UDOUBLE rowLen, UDOUBLE stride, UDOUBLE rows);
+void DEV_SPI_Queue_Command(UBYTE cs, UBYTE cmd, const UBYTE *pData, UBYTE len);
+void DEV_SPI_Wait(void);
+bool DEV_SPI_SetClock(UDOUBLE hz);
+UDOUBLE DEV_SPI_GetClock(void);
 void DEV_Module_Exit(void);
+void DEV_Module_Standby(void);
+
+#ifdef EPD_SPI_BENCHMARK
+void DEV_SPI_Benchmark(void);
+#endif
+
+#ifdef EPD_SPI_TRACE
+// kind is EPD_TRACE_*; cs is set for commands only. Bytes and commands
+// pass pData/rowLen as the bytes sent, with stride == rowLen and rows == 1.
+typedef void (*DEV_SPI_Tracer)(UBYTE kind, UBYTE cs, const UBYTE *pData, UDOUBLE rowLen, UDOUBLE stride, UDOUBLE rows);
+void DEV_SPI_SetTracer(DEV_SPI_Tracer tracer);
+#endif
 
 #endif
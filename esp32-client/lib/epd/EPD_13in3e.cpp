@@ -28,7 +28,8 @@
 #
 ******************************************************************************/
 #include "EPD_13in3e.h"
-#include "Debug.h"
+#include "Log.h"
+#include "EPD_Command.h"
 
 
 // const UBYTE spiCsPin[2] = {
@@ -91,6 +92,34 @@ const UBYTE BUCK_BOOST_VDDN_V[1] = {
 const UBYTE TFT_VCOM_POWER_V[1] = {
 	0x02
 };
+const UBYTE DSLP_V[1] = {
+	0xA5
+};
+
+// Register setup after reset. Analog timing and the booster/power settings
+// only go to the master controller; panel settings go to both halves.
+static constexpr EPD_Command EPD_13IN3E_InitSequence[] = {
+    EPD_CMD(AN_TM,           AN_TM_V,           EPD_CS_M),
+    EPD_CMD(CMD66,           CMD66_V,           EPD_CS_BOTH),
+    EPD_CMD(PSR,             PSR_V,             EPD_CS_BOTH),
+    EPD_CMD(CDI,             CDI_V,             EPD_CS_BOTH),
+    EPD_CMD(TCON,            TCON_V,            EPD_CS_BOTH),
+    EPD_CMD(AGID,            AGID_V,            EPD_CS_BOTH),
+    EPD_CMD(PWS,             PWS_V,             EPD_CS_BOTH),
+    EPD_CMD(CCSET,           CCSET_V,           EPD_CS_BOTH),
+    EPD_CMD(TRES,            TRES_V,            EPD_CS_BOTH),
+    EPD_CMD(PWR_epd,         PWR_V,             EPD_CS_M),
+    EPD_CMD(EN_BUF,          EN_BUF_V,          EPD_CS_M),
+    EPD_CMD(BTST_P,          BTST_P_V,          EPD_CS_M),
+    EPD_CMD(BOOST_VDDP_EN,   BOOST_VDDP_EN_V,   EPD_CS_M),
+    EPD_CMD(BTST_N,          BTST_N_V,          EPD_CS_M),
+    EPD_CMD(BUCK_BOOST_VDDN, BUCK_BOOST_VDDN_V, EPD_CS_M),
+    EPD_CMD(TFT_VCOM_POWER,  TFT_VCOM_POWER_V,  EPD_CS_M),
+};
+
+static constexpr EPD_Command EPD_13IN3E_SleepSequence[] = {
+    EPD_CMD(DSLP,            DSLP_V,            EPD_CS_BOTH),
+};
 
 
 static void EPD_13IN3E_CS_ALL(UBYTE Value)
@@ -145,10 +174,6 @@ static void EPD_13IN3E_SendData(UBYTE Reg)
 {
     DEV_SPI_WriteByte(Reg);
 }
-static void EPD_13IN3E_SendData2(const UBYTE *buf, uint32_t Len)
-{
-    DEV_SPI_Write_nByte((UBYTE *)buf,Len);
-}
 
 /******************************************************************************
 function :	Wait until the busy_pin goes LOW
@@ -156,41 +181,54 @@ parameter:
 ******************************************************************************/
 static void EPD_13IN3E_ReadBusyH(void)
 {
-    Debug("e-Paper busy\r\n");
+    LOG_D("e-Paper busy");
 	while(!DEV_Digital_Read(EPD_BUSY_PIN)) {      //LOW: busy, HIGH: idle
         DEV_Delay_ms(10);
         // Debug("e-Paper busy release\r\n");
     }
 	DEV_Delay_ms(20);
-    Debug("e-Paper busy release\r\n");
+    LOG_D("e-Paper busy release");
 }
 
 
 /******************************************************************************
 function :  Turn On Display
 parameter:
+    The refresh is split in two: Start powers the panel on and issues DRF,
+    Finish waits out the refresh (BUSY low for 30-45 s) and powers off.
+    Callers may do other work in between.
 ******************************************************************************/
-static void EPD_13IN3E_TurnOnDisplay(void)
+static void EPD_13IN3E_TurnOnDisplayStart(void)
 {
-    printf("Write PON \r\n");
+    LOG_D("Write PON");
     EPD_13IN3E_CS_ALL(0);
     EPD_13IN3E_SendCommand(0x04); // POWER_ON
     EPD_13IN3E_CS_ALL(1);
     EPD_13IN3E_ReadBusyH();
 
-    printf("Write DRF \r\n");
+    LOG_D("Write DRF");
     DEV_Delay_ms(50);
     EPD_13IN3E_CS_ALL(0);
     EPD_13IN3E_SPI_Sand(DRF, DRF_V, sizeof(DRF_V));
     EPD_13IN3E_CS_ALL(1);
+}
+
+static void EPD_13IN3E_TurnOnDisplayFinish(void)
+{
     EPD_13IN3E_ReadBusyH();
 
-    printf("Write POF \r\n");
+    LOG_D("Write POF");
     EPD_13IN3E_CS_ALL(0);
     EPD_13IN3E_SPI_Sand(POF, POF_V, sizeof(POF_V));
     EPD_13IN3E_CS_ALL(1);
     // EPD_13IN3E_ReadBusyH();
-    printf("Display Done!! \r\n");
+    LOG_D("Display Done!!");
+}
+
+static void EPD_13IN3E_TurnOnDisplay(void)
+{
+    EPD_13IN3E_TurnOnDisplayStart();
+    EPD_13IN3E_TurnOnDisplayFinish();
 }
 
 /******************************************************************************
@@ -202,71 +240,28 @@ void EPD_13IN3E_Init(void)
 	EPD_13IN3E_Reset();
 //    EPD_13IN3E_ReadBusyH();
 
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-	EPD_13IN3E_SPI_Sand(AN_TM, AN_TM_V, sizeof(AN_TM_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-	EPD_13IN3E_SPI_Sand(CMD66, CMD66_V, sizeof(CMD66_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-	EPD_13IN3E_SPI_Sand(PSR, PSR_V, sizeof(PSR_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-	EPD_13IN3E_SPI_Sand(CDI, CDI_V, sizeof(CDI_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-	EPD_13IN3E_SPI_Sand(TCON, TCON_V, sizeof(TCON_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-	EPD_13IN3E_SPI_Sand(AGID, AGID_V, sizeof(AGID_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-	EPD_13IN3E_SPI_Sand(PWS, PWS_V, sizeof(PWS_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-	EPD_13IN3E_SPI_Sand(CCSET, CCSET_V, sizeof(CCSET_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-	EPD_13IN3E_SPI_Sand(TRES, TRES_V, sizeof(TRES_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-	EPD_13IN3E_SPI_Sand(PWR_epd, PWR_V, sizeof(PWR_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-	EPD_13IN3E_SPI_Sand(EN_BUF, EN_BUF_V, sizeof(EN_BUF_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-	EPD_13IN3E_SPI_Sand(BTST_P, BTST_P_V, sizeof(BTST_P_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-	EPD_13IN3E_SPI_Sand(BOOST_VDDP_EN, BOOST_VDDP_EN_V, sizeof(BOOST_VDDP_EN_V));
-    EPD_13IN3E_CS_ALL(1);
-	
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-	EPD_13IN3E_SPI_Sand(BTST_N, BTST_N_V, sizeof(BTST_N_V));
-    EPD_13IN3E_CS_ALL(1);
+    EPD_RunCommands(EPD_13IN3E_InitSequence, EPD_CMD_COUNT(EPD_13IN3E_InitSequence));
+}
 
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-	EPD_13IN3E_SPI_Sand(BUCK_BOOST_VDDN, BUCK_BOOST_VDDN_V, sizeof(BUCK_BOOST_VDDN_V));
-    EPD_13IN3E_CS_ALL(1);
+const EPD_PaletteColor EPD_13IN3E_Panel::Palette[EPD_13IN3E_Panel::PaletteSize] = {
+    { 0,   0,   0,   EPD_13IN3E_BLACK  },
+    { 255, 255, 255, EPD_13IN3E_WHITE  },
+    { 255, 255, 0,   EPD_13IN3E_YELLOW },
+    { 255, 0,   0,   EPD_13IN3E_RED    },
+    { 0,   0,   255, EPD_13IN3E_BLUE   },
+    { 0,   255, 0,   EPD_13IN3E_GREEN  },
+};
 
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-	EPD_13IN3E_SPI_Sand(TFT_VCOM_POWER, TFT_VCOM_POWER_V, sizeof(TFT_VCOM_POWER_V));
-    EPD_13IN3E_CS_ALL(1);
-    
-}
+// Measured on the actual panel: white is a light grey and the saturated
+// colours are much darker than nominal.
+const EPD_PaletteColor EPD_13IN3E_Panel::MeasuredPalette[EPD_13IN3E_Panel::PaletteSize] = {
+    { 2,   2,   2,   EPD_13IN3E_BLACK  },
+    { 190, 200, 200, EPD_13IN3E_WHITE  },
+    { 205, 202, 0,   EPD_13IN3E_YELLOW },
+    { 135, 19,  0,   EPD_13IN3E_RED    },
+    { 5,   64,  158, EPD_13IN3E_BLUE   },
+    { 39,  102, 60,  EPD_13IN3E_GREEN  },
+};
 
 /******************************************************************************
 function :  Clear screen
@@ -274,167 +269,40 @@ parameter:
 ******************************************************************************/
 void EPD_13IN3E_Clear(UBYTE color)
 {
-    UDOUBLE Width, Height;
-    UBYTE Color;
-    Width = (EPD_13IN3E_WIDTH % 2 == 0)? (EPD_13IN3E_WIDTH / 2 ): (EPD_13IN3E_WIDTH / 2 + 1);
-    Height = EPD_13IN3E_HEIGHT;
-    Color = (color<<4)|color;
-    
-    UBYTE buf[Width/2];
-    
-    for (UDOUBLE j = 0; j < Width/2; j++) {
-        buf[j] = Color;
-    }
-    
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SendCommand(0x10);
-    for (UDOUBLE j = 0; j < EPD_13IN3E_HEIGHT; j++) {
-        EPD_13IN3E_SendData2(buf, Width/2);
-        DEV_Delay_ms(1);
-    }
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_S_PIN, 0);
-    EPD_13IN3E_SendCommand(0x10);
-    for (UDOUBLE j = 0; j < EPD_13IN3E_HEIGHT; j++) {
-        EPD_13IN3E_SendData2(buf, Width/2);
-        DEV_Delay_ms(1);
-    }
-    EPD_13IN3E_CS_ALL(1);
-    
+    EPD_SendFill<EPD_13IN3E_Panel>((color << 4) | color);
     EPD_13IN3E_TurnOnDisplay();
 }
 
 
 void EPD_13IN3E_Display(const UBYTE *Image)
 {
-    UDOUBLE Width, Width1, Height;
-    Width = (EPD_13IN3E_WIDTH % 2 == 0)? (EPD_13IN3E_WIDTH / 2 ): (EPD_13IN3E_WIDTH / 2 + 1);
-    Width1 = (Width % 2 == 0)? (Width / 2 ): (Width / 2 + 1);
-    Height = EPD_13IN3E_HEIGHT;
-    
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SendCommand(0x10);
-    for(UDOUBLE i=0; i<Height; i++ )
-    {
-        EPD_13IN3E_SendData2(Image + i*Width,Width1);
-        DEV_Delay_ms(1);
-    }
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_S_PIN, 0);
-    EPD_13IN3E_SendCommand(0x10);
-    for(UDOUBLE i=0; i<Height; i++ )
-    {
-        EPD_13IN3E_SendData2(Image + i*Width + Width1,Width1);
-        DEV_Delay_ms(1);
-    }
-       
-    EPD_13IN3E_CS_ALL(1);
-    
+    // Image may live in PSRAM or memory-mapped flash; the SPI layer
+    // gathers each controller's strip straight from it.
+    EPD_SendFrame<EPD_13IN3E_Panel>(Image);
     EPD_13IN3E_TurnOnDisplay();
 }
 
+/******************************************************************************
+function :  Upload a frame and start the refresh without waiting for it
+parameter:
+    Must be followed by EPD_13IN3E_DisplayFinish before the panel is
+    touched again or put to sleep.
+******************************************************************************/
+void EPD_13IN3E_DisplayStart(const UBYTE *Image)
+{
+    EPD_SendFrame<EPD_13IN3E_Panel>(Image);
+    EPD_13IN3E_TurnOnDisplayStart();
+}
 
-void EPD_13IN3E_DisplayPart(const UBYTE *Image, UWORD xstart, UWORD ystart, UWORD image_width, UWORD image_heigh)
+void EPD_13IN3E_DisplayFinish(void)
 {
-    UDOUBLE Width, Width1, Height;
-    Width = (EPD_13IN3E_WIDTH % 2 == 0)? (EPD_13IN3E_WIDTH / 2 ): (EPD_13IN3E_WIDTH / 2 + 1);
-    Width1 = (Width % 2 == 0)? (Width / 2 ): (Width / 2 + 1);
-    Height = EPD_13IN3E_HEIGHT;
-    
-    UWORD Xend = ((xstart + image_width)%2 == 0)?((xstart + image_width) / 2 - 1): ((xstart + image_width) / 2 );
-    UWORD Yend = ystart + image_heigh-1;
-    xstart = xstart / 2;
-    
-    if(xstart > 300 )
-    {
-        Xend = Xend - 300;
-        xstart = xstart - 300;
-        DEV_Digital_Write(EPD_CS_M_PIN, 0);
-        EPD_13IN3E_SendCommand(0x10);
-        for (UDOUBLE i = 0; i < Height; i++) {
-            for (UDOUBLE j = 0; j < Width1; j++) {
-                EPD_13IN3E_SendData(0x11);
-            }
-            DEV_Delay_ms(1);
-        }
-        EPD_13IN3E_CS_ALL(1);
-        
-        
-        DEV_Digital_Write(EPD_CS_S_PIN, 0);
-        EPD_13IN3E_SendCommand(0x10);
-        for (UDOUBLE i = 0; i < Height; i++) {
-            for (UDOUBLE j = 0; j < Width1; j++) {
-                if((i<Yend) && (i>=ystart) && (j<Xend) && (j>=xstart)) {
-                    EPD_13IN3E_SendData(Image[(j-xstart) + (image_width/2*(i-ystart))]);
-                }
-                else
-                    EPD_13IN3E_SendData(0x11);
-            }
-            DEV_Delay_ms(1);
-        }
-        EPD_13IN3E_CS_ALL(1);
-    }
-    else if(Xend < 300 )
-    {
-        DEV_Digital_Write(EPD_CS_M_PIN, 0);
-        EPD_13IN3E_SendCommand(0x10);
-        for (UDOUBLE i = 0; i < Height; i++) {
-            for (UDOUBLE j = 0; j < Width1; j++) {
-                if((i<Yend) && (i>=ystart) && (j<Xend) && (j>=xstart)) {
-                    EPD_13IN3E_SendData(Image[(j-xstart) + (image_width/2*(i-ystart))]);
-                }
-                else
-                    EPD_13IN3E_SendData(0x11);
-            }
-            DEV_Delay_ms(1);
-        }
-        EPD_13IN3E_CS_ALL(1);
-        
-        
-        DEV_Digital_Write(EPD_CS_S_PIN, 0);
-        EPD_13IN3E_SendCommand(0x10);
-        for (UDOUBLE i = 0; i < Height; i++) {
-            for (UDOUBLE j = 0; j < Width1; j++) {
-                EPD_13IN3E_SendData(0x11);
-            }
-            DEV_Delay_ms(1);
-        }
-        EPD_13IN3E_CS_ALL(1);
-    }
-    else
-    {
-        DEV_Digital_Write(EPD_CS_M_PIN, 0);
-        EPD_13IN3E_SendCommand(0x10);
-        for (UDOUBLE i = 0; i < Height; i++) {
-            for (UDOUBLE j = 0; j < Width1; j++) {
-                if((i<Yend) && (i>=ystart) && (j>=xstart)) {
-                    EPD_13IN3E_SendData(Image[(j-xstart) + (image_width/2*(i-ystart))]);
-                }
-                else
-                    EPD_13IN3E_SendData(0x11);
-            }
-            DEV_Delay_ms(1);
-        }
-        EPD_13IN3E_CS_ALL(1);
-        
-        
-        DEV_Digital_Write(EPD_CS_S_PIN, 0);
-        EPD_13IN3E_SendCommand(0x10);
-        for (UDOUBLE i = 0; i < Height; i++) {
-            for (UDOUBLE j = 0; j < Width1; j++) {
-                if((i<Yend) && (i>=ystart) && (j<Xend-300)) {
-                    EPD_13IN3E_SendData(Image[(j+300-xstart) + (image_width/2*(i-ystart))]);
-                }
-                else
-                    EPD_13IN3E_SendData(0x11);
-            }
-            DEV_Delay_ms(1);
-        }
-        EPD_13IN3E_CS_ALL(1);
-    }
+    EPD_13IN3E_TurnOnDisplayFinish();
+}
+
 
+void EPD_13IN3E_DisplayPart(const UBYTE *Image, UWORD xstart, UWORD ystart, UWORD image_width, UWORD image_heigh)
+{
+    EPD_SendWindow<EPD_13IN3E_Panel>(Image, xstart, ystart, image_width, image_heigh);
     EPD_13IN3E_TurnOnDisplay();
 }
 
@@ -484,13 +352,114 @@ parameter:
 ******************************************************************************/
 void EPD_13IN3E_Sleep(void)
 {
-    EPD_13IN3E_CS_ALL(0);
-    EPD_13IN3E_SendCommand(0x07); // DEEP_SLEEP
-    EPD_13IN3E_SendData(0XA5);
-    EPD_13IN3E_CS_ALL(1);
+    EPD_RunCommands(EPD_13IN3E_SleepSequence, EPD_CMD_COUNT(EPD_13IN3E_SleepSequence));
 }
 
 
+/******************************************************************************
+function :  Pick up a controller left powered between updates
+parameter:
+Info:       Every refresh ends with POF, which turns off the panel's high
+            voltages but keeps the registers, so a controller that was not
+            sent DSLP and never lost power or RST needs no reset and no init
+            sequence; the next PON starts from the retained settings. Returns
+            0 if it is not idle (BUSY low) and has to go through
+            EPD_13IN3E_Init.
+******************************************************************************/
+UBYTE EPD_13IN3E_Resume(void)
+{
+    if (!DEV_Digital_Read(EPD_BUSY_PIN)) {
+        LOG_D("e-Paper busy on resume");
+        return 0;
+    }
+    return 1;
+}
 
 
+/******************************************************************************
+function :  Find the fastest SPI clock the wiring carries reliably
+parameter:
+Info:       The controller's RAM cannot be read back, so each candidate rate
+            is verified by reading the revision register repeatedly and
+            comparing it with a reference read at the slowest rate. This
+            covers both directions: a corrupted command byte returns the
+            wrong data. Reads are also the slower direction, which leaves
+            margin for writes. Leaves the bus at the chosen rate in *hz, or
+            0 when readback is not available. Returns false, with the bus
+            back at its original rate, if the SPI device could not be moved
+            to a rate; nothing was measured then.
+******************************************************************************/
+#define EPD_CAL_READS   64
+#define EPD_REV_LEN     4
 
+static void EPD_13IN3E_ReadRevision(UBYTE *rev)
+{
+    DEV_Digital_Write(EPD_CS_M_PIN, 0);
+    EPD_13IN3E_SendCommand(REV);
+    for (int i = 0; i < EPD_REV_LEN; i++) {
+        rev[i] = DEV_SPI_ReadByte();
+    }
+    EPD_13IN3E_CS_ALL(1);
+}
+
+bool EPD_13IN3E_CalibrateClock(UDOUBLE *hz)
+{
+    *hz = 0;
+#if EPD_USE_HW_SPI
+    // APB (80 MHz) dividers, slowest first
+    static const UDOUBLE steps[] = {
+        8000000, 10000000, 13333333, 16000000, 20000000, 26666667, 40000000
+    };
+    const UDOUBLE original = DEV_SPI_GetClock();
+
+    EPD_13IN3E_Reset();
+
+    UBYTE ref[EPD_REV_LEN], rev[EPD_REV_LEN];
+    if (!DEV_SPI_SetClock(steps[0])) {
+        LOG_E("SPI calibration: cannot set %u kHz", (unsigned)(steps[0] / 1000));
+        DEV_SPI_SetClock(original);
+        return false;
+    }
+    EPD_13IN3E_ReadRevision(ref);
+    EPD_13IN3E_ReadRevision(rev);
+
+    bool floating = true;
+    for (int i = 0; i < EPD_REV_LEN; i++) {
+        if (ref[i] != 0x00 && ref[i] != 0xFF) floating = false;
+    }
+    if (floating || memcmp(ref, rev, EPD_REV_LEN) != 0) {
+        LOG_W("SPI calibration: no stable readback, keeping default clock");
+        DEV_SPI_SetClock(original);
+        return true;
+    }
+
+    UDOUBLE best = steps[0];
+    for (UWORD s = 1; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        if (!DEV_SPI_SetClock(steps[s])) {
+            LOG_E("SPI calibration: cannot set %u kHz", (unsigned)(steps[s] / 1000));
+            DEV_SPI_SetClock(original);
+            return false;
+        }
+        bool ok = true;
+        for (int r = 0; r < EPD_CAL_READS && ok; r++) {
+            EPD_13IN3E_ReadRevision(rev);
+            ok = memcmp(ref, rev, EPD_REV_LEN) == 0;
+        }
+        if (!ok) {
+            break;
+        }
+        best = steps[s];
+    }
+
+    if (!DEV_SPI_SetClock(best)) {
+        LOG_E("SPI calibration: cannot set %u kHz", (unsigned)(best / 1000));
+        DEV_SPI_SetClock(original);
+        return false;
+    }
+    LOG_I("SPI calibration: %u kHz", (unsigned)(best / 1000));
+    *hz = best;
+    return true;
+#else
+    return true;
+#endif
+}
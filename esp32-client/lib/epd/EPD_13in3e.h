@@ -31,6 +31,7 @@
 #define _EPD_13IN3E_H_
 
 #include "DEV_Config.h"
+#include "EPD_Panel.h"
 
 // M/S 控制区域 600*1600
 #define EPD_13IN3E_WIDTH        1200
@@ -48,6 +49,7 @@
 #define PWR_epd         0x01
 #define POF             0x02
 #define PON             0x04
+#define DSLP            0x07
 #define BTST_N          0x05
 #define BTST_P          0x06
 #define DTM             0x10
@@ -55,6 +57,7 @@
 #define CDI             0x50
 #define TCON            0x60
 #define TRES            0x61
+#define REV             0x70
 #define AN_TM           0x74
 #define AGID            0x86
 #define BUCK_BOOST_VDDN 0xB0
@@ -65,15 +68,43 @@
 #define PWS             0xE3
 #define CMD66           0xF0
 
+// Panel traits, see EPD_Panel.h
+struct EPD_13IN3E_Panel : EPD_PanelGeometry<EPD_13IN3E_WIDTH, EPD_13IN3E_HEIGHT, 4, 2> {
+    static const UBYTE DataCommand = DTM;
+    static const UBYTE FillByte = (EPD_13IN3E_WHITE << 4) | EPD_13IN3E_WHITE;
+
+    static const UBYTE PaletteSize = 6;
+    static const EPD_PaletteColor Palette[PaletteSize];         // nominal colours
+    static const EPD_PaletteColor MeasuredPalette[PaletteSize]; // as they look on the panel
+
+    // Controller 0 (CS_M) drives the left strip, 1 (CS_S) the right one
+    static void Select(UBYTE controller)
+    {
+        DEV_Digital_Write(controller == 0 ? EPD_CS_M_PIN : EPD_CS_S_PIN, 0);
+    }
+    static void DeselectAll(void)
+    {
+        DEV_Digital_Write(EPD_CS_M_PIN, 1);
+        DEV_Digital_Write(EPD_CS_S_PIN, 1);
+    }
+    static void SendCommand(UBYTE cmd)
+    {
+        DEV_SPI_WriteByte(cmd);
+    }
+};
 
 
 
 void EPD_13IN3E_Init(void);
 void EPD_13IN3E_Clear(UBYTE color);
 void EPD_13IN3E_Display(const UBYTE *Image);
+void EPD_13IN3E_DisplayStart(const UBYTE *Image);
+void EPD_13IN3E_DisplayFinish(void);
 void EPD_13IN3E_DisplayPart(const UBYTE *Image, UWORD xstart, UWORD ystart, UWORD image_width, UWORD image_heigh);
 void EPD_13IN3E_Show6Block(void);
 void EPD_13IN3E_Sleep(void);
+UBYTE EPD_13IN3E_Resume(void);
+bool EPD_13IN3E_CalibrateClock(UDOUBLE *hz);
 
 #endif
 
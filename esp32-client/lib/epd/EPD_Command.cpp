@@ -0,0 +1,25 @@
+/*****************************************************************************
+* | File      	:   EPD_Command.cpp
+* | Function    :   Table-driven register sequences for e-Paper controllers
+******************************************************************************/
+#include "EPD_Command.h"
+
+/******************************************************************************
+function :	Replay a command table
+parameter:
+    Cmds  : command table
+    Count : number of entries
+Info:		Commands are queued back to back; the queue is only drained
+			where an entry asks for a post-delay, and once at the end.
+******************************************************************************/
+void EPD_RunCommands(const EPD_Command *Cmds, UWORD Count)
+{
+    for (UWORD i = 0; i < Count; i++) {
+        DEV_SPI_Queue_Command(Cmds[i].Cs, Cmds[i].Cmd, Cmds[i].Data, Cmds[i].Len);
+        if (Cmds[i].DelayMs) {
+            DEV_SPI_Wait();
+            DEV_Delay_ms(Cmds[i].DelayMs);
+        }
+    }
+    DEV_SPI_Wait();
+}
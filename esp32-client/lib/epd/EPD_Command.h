@@ -0,0 +1,27 @@
+/*****************************************************************************
+* | File      	:   EPD_Command.h
+* | Function    :   Table-driven register sequences for e-Paper controllers
+* | Info        :
+*   A panel's init (or any fixed register sequence) is described as a
+*   constant table and replayed by EPD_RunCommands, which queues the whole
+*   sequence as one batch of SPI transactions.
+******************************************************************************/
+#ifndef _EPD_COMMAND_H_
+#define _EPD_COMMAND_H_
+
+#include "DEV_Config.h"
+
+typedef struct {
+    UBYTE Cmd;
+    const UBYTE *Data;
+    UBYTE Len;
+    UBYTE Cs;       // EPD_CS_M, EPD_CS_S or EPD_CS_BOTH
+    UWORD DelayMs;  // wait after the command has been clocked out
+} EPD_Command;
+
+#define EPD_CMD(_cmd, _data, _cs)  { (_cmd), (_data), sizeof(_data), (_cs), 0 }
+#define EPD_CMD_COUNT(_table)      (sizeof(_table) / sizeof((_table)[0]))
+
+void EPD_RunCommands(const EPD_Command *Cmds, UWORD Count);
+
+#endif
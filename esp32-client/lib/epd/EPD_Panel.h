@@ -0,0 +1,142 @@
+/*****************************************************************************
+* | File      	:   EPD_Panel.h
+* | Function    :   Compile-time panel description and frame upload loops
+* | Info        :
+*   A panel is described by a traits struct derived from EPD_PanelGeometry:
+*   resolution, pixel depth, how each row is split across controllers,
+*   chip selects, fill byte, palette and the data-transfer command. The
+*   upload templates below are instantiated per panel, so the controller
+*   loop is unrolled and every size is a constant; nothing in the hot path
+*   branches on which panel is attached.
+*
+*   Traits requirements (besides the geometry):
+*       static const UBYTE DataCommand;               // e.g. DTM
+*       static const UBYTE FillByte;                  // two white pixels
+*       static void Select(UBYTE controller);         // assert one CS
+*       static void DeselectAll(void);
+*       static void SendCommand(UBYTE cmd);
+******************************************************************************/
+#ifndef _EPD_PANEL_H_
+#define _EPD_PANEL_H_
+
+#include "DEV_Config.h"
+
+typedef struct {
+    UBYTE R, G, B;
+    UBYTE Index;    // value written to the frame buffer
+} EPD_PaletteColor;
+
+template <UWORD W, UWORD H, UBYTE Bpp, UBYTE Ctrls>
+struct EPD_PanelGeometry {
+    static const UWORD Width = W;
+    static const UWORD Height = H;
+    static const UBYTE BitsPerPixel = Bpp;
+    static const UBYTE PixelsPerByte = 8 / Bpp;
+    static const UBYTE Controllers = Ctrls;
+    static const UDOUBLE RowBytes = (UDOUBLE)W * Bpp / 8;
+    static const UDOUBLE ControllerBytes = RowBytes / Ctrls;  // each controller drives a vertical strip
+    static const UWORD ControllerWidth = W / Ctrls;
+    static const UDOUBLE FrameBytes = RowBytes * H;
+
+    static_assert(8 % Bpp == 0, "pixels must not straddle bytes");
+    static_assert(RowBytes % Ctrls == 0, "controller split must fall on a byte boundary");
+};
+
+/******************************************************************************
+Frame upload, one controller strip at a time. `Remaining` counts down so the
+recursion ends on a plain partial specialisation.
+******************************************************************************/
+template <class Panel, UBYTE Remaining = Panel::Controllers>
+struct EPD_FrameUpload {
+    static const UBYTE C = Panel::Controllers - Remaining;
+
+    // Full frame in panel row order (RowBytes per line)
+    static void Send(const UBYTE *Image)
+    {
+        Panel::Select(C);
+        Panel::SendCommand(Panel::DataCommand);
+        DEV_SPI_Write_Rows(Image + C * Panel::ControllerBytes,
+                           Panel::ControllerBytes, Panel::RowBytes, Panel::Height);
+        Panel::DeselectAll();
+        EPD_FrameUpload<Panel, Remaining - 1>::Send(Image);
+    }
+
+    // Every line of every strip set to the same row
+    static void Fill(const UBYTE *Row)
+    {
+        Panel::Select(C);
+        Panel::SendCommand(Panel::DataCommand);
+        DEV_SPI_Write_Rows(Row, Panel::ControllerBytes, 0, Panel::Height);
+        Panel::DeselectAll();
+        EPD_FrameUpload<Panel, Remaining - 1>::Fill(Row);
+    }
+
+    // A packed window of `Bytes` x `Rows` placed at byte column `X0`, row `Y0`;
+    // everything outside it is sent as FillByte.
+    static void Window(const UBYTE *Image, UDOUBLE X0, UDOUBLE Y0, UDOUBLE Bytes, UDOUBLE Rows,
+                       const UBYTE *FillRow)
+    {
+        const UDOUBLE stripStart = C * Panel::ControllerBytes;
+        const UDOUBLE stripEnd = stripStart + Panel::ControllerBytes;
+        const UDOUBLE from = X0 > stripStart ? X0 : stripStart;
+        const UDOUBLE to = X0 + Bytes < stripEnd ? X0 + Bytes : stripEnd;
+
+        Panel::Select(C);
+        Panel::SendCommand(Panel::DataCommand);
+        if (from >= to) {
+            DEV_SPI_Write_Rows(FillRow, Panel::ControllerBytes, 0, Panel::Height);
+        } else {
+            UBYTE row[Panel::ControllerBytes];
+            memcpy(row, FillRow, Panel::ControllerBytes);
+            DEV_SPI_Write_Rows(FillRow, Panel::ControllerBytes, 0, Y0);
+            for (UDOUBLE y = 0; y < Rows; y++) {
+                memcpy(row + (from - stripStart), Image + y * Bytes + (from - X0), to - from);
+                DEV_SPI_Write_Rows(row, Panel::ControllerBytes, Panel::ControllerBytes, 1);
+            }
+            DEV_SPI_Write_Rows(FillRow, Panel::ControllerBytes, 0, Panel::Height - Y0 - Rows);
+        }
+        Panel::DeselectAll();
+        EPD_FrameUpload<Panel, Remaining - 1>::Window(Image, X0, Y0, Bytes, Rows, FillRow);
+    }
+};
+
+template <class Panel>
+struct EPD_FrameUpload<Panel, 0> {
+    static void Send(const UBYTE *) {}
+    static void Fill(const UBYTE *) {}
+    static void Window(const UBYTE *, UDOUBLE, UDOUBLE, UDOUBLE, UDOUBLE, const UBYTE *) {}
+};
+
+template <class Panel>
+void EPD_SendFrame(const UBYTE *Image)
+{
+    EPD_FrameUpload<Panel>::Send(Image);
+}
+
+template <class Panel>
+void EPD_SendFill(UBYTE Fill)
+{
+    UBYTE row[Panel::ControllerBytes];
+    memset(row, Fill, sizeof(row));
+    EPD_FrameUpload<Panel>::Fill(row);
+}
+
+// Window given in pixels; clipped to the panel. Image holds
+// ceil(Width / PixelsPerByte) bytes per row.
+template <class Panel>
+void EPD_SendWindow(const UBYTE *Image, UWORD X, UWORD Y, UWORD Width, UWORD Height)
+{
+    const UDOUBLE bytes = (Width + Panel::PixelsPerByte - 1) / Panel::PixelsPerByte;
+    const UDOUBLE x0 = X / Panel::PixelsPerByte;
+    if (x0 >= Panel::RowBytes || Y >= Panel::Height) {
+        EPD_SendFill<Panel>(Panel::FillByte);
+        return;
+    }
+    const UDOUBLE rows = Y + Height > Panel::Height ? Panel::Height - Y : Height;
+
+    UBYTE fill[Panel::ControllerBytes];
+    memset(fill, Panel::FillByte, sizeof(fill));
+    EPD_FrameUpload<Panel>::Window(Image, x0, Y, bytes, rows, fill);
+}
+
+#endif
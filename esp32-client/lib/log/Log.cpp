@@ -0,0 +1,110 @@
+#include "Log.h"
+#include <Arduino.h>
+#include <stdarg.h>
+
+static const char logLevelTags[] = "-EWIDV";
+
+void logPrintf(uint8_t level, const char *fmt, ...)
+{
+    char line[LOG_LINE_MAX];
+    int len = snprintf(line, sizeof(line), "[%c] ", logLevelTags[level < 6 ? level : 0]);
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line + len, sizeof(line) - len - 2, fmt, args);
+    va_end(args);
+    if (n < 0) return;
+
+    len += n;
+    if (len > (int)sizeof(line) - 3) len = sizeof(line) - 3;
+    line[len++] = '\r';
+    line[len++] = '\n';
+    Serial.write((const uint8_t *)line, len);
+}
+
+#if LOG_DEFERRED
+
+/******************************************************************************
+Record layout, in words:
+    0: 0xA5 << 24 | level << 16 | argument word count
+    1: format string address
+    2: millis()
+    3..: arguments (see LogArgs)
+Once the ring is full the oldest records are dropped to make room.
+******************************************************************************/
+#define LOG_RECORD_MARK 0xA5000000
+#define LOG_RECORD_HEADER 3
+
+RTC_DATA_ATTR static uint32_t logRing[LOG_RING_WORDS];
+RTC_DATA_ATTR static uint16_t logRingHead = 0;  // first word of the oldest record
+RTC_DATA_ATTR static uint16_t logRingUsed = 0;  // words in use
+static uint32_t logRingDropped = 0;   // words taken off the front this wake
+static uint32_t logRingReadStart = 0; // logRingDropped at the last logRingRead()
+static portMUX_TYPE logRingLock = portMUX_INITIALIZER_UNLOCKED;
+
+static void logRingDropOldest()
+{
+    size_t oldest = LOG_RECORD_HEADER + (logRing[logRingHead] & 0xFFFF);
+    logRingHead = (logRingHead + oldest) % LOG_RING_WORDS;
+    logRingUsed -= oldest;
+    logRingDropped += oldest;
+}
+
+static void logRingPut(uint32_t word)
+{
+    logRing[(logRingHead + logRingUsed) % LOG_RING_WORDS] = word;
+    logRingUsed++;
+}
+
+void logRingAppend(uint8_t level, const char *fmt, const uint32_t *args, size_t argWords)
+{
+    const size_t total = LOG_RECORD_HEADER + argWords;
+
+    portENTER_CRITICAL(&logRingLock);
+    // A ring left over from another firmware, or torn by a reset, starts over
+    if (logRingUsed > LOG_RING_WORDS ||
+        (logRingUsed > 0 && (logRing[logRingHead] & 0xFF000000) != LOG_RECORD_MARK)) {
+        logRingHead = 0;
+        logRingUsed = 0;
+    }
+    while (logRingUsed > 0 && logRingUsed + total > LOG_RING_WORDS) {
+        logRingDropOldest();
+    }
+    logRingPut(LOG_RECORD_MARK | ((uint32_t)level << 16) | argWords);
+    logRingPut((uint32_t)(uintptr_t)fmt);
+    logRingPut(millis());
+    for (size_t i = 0; i < argWords; i++) {
+        logRingPut(args[i]);
+    }
+    portEXIT_CRITICAL(&logRingLock);
+}
+
+size_t logRingRead(uint32_t *out, size_t maxWords)
+{
+    if (maxWords < 2) return 0;
+
+    portENTER_CRITICAL(&logRingLock);
+    size_t count = logRingUsed;
+    if (count > maxWords - 2) count = maxWords - 2;
+    out[0] = LOG_RING_MAGIC;
+    out[1] = count;
+    for (size_t i = 0; i < count; i++) {
+        out[2 + i] = logRing[(logRingHead + i) % LOG_RING_WORDS];
+    }
+    logRingReadStart = logRingDropped;
+    portEXIT_CRITICAL(&logRingLock);
+    return count + 2;
+}
+
+void logRingConsume(size_t words)
+{
+    portENTER_CRITICAL(&logRingLock);
+    // Records appended since the read may have pushed some of it out already
+    uint32_t end = logRingReadStart + words;
+    while (logRingUsed > 0 && (int32_t)(end - logRingDropped) > 0) {
+        logRingDropOldest();
+    }
+    portEXIT_CRITICAL(&logRingLock);
+}
+
+#endif
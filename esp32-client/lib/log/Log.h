@@ -0,0 +1,151 @@
+/*****************************************************************************
+* | File      	:   Log.h
+* | Function    :   Leveled printf-style logging without heap allocation
+* | Info        :
+*   LOG_E / LOG_W / LOG_I / LOG_D / LOG_V take a printf format and arguments.
+*   The compiler checks every format against its arguments, and statements
+*   above LOG_LEVEL compile to nothing (their arguments are never evaluated).
+*   A trailing newline is added.
+*
+*   LOG_DEFERRED=0: the line is formatted into a stack buffer and written
+*   to Serial.
+*   LOG_DEFERRED=1: nothing is formatted on the device. The address of the
+*   format string and the raw arguments go into a ring buffer in RTC memory
+*   that survives deep sleep; logRingRead() hands it out for upload and
+*   tools/logdecode.py turns it back into text using the firmware ELF.
+******************************************************************************/
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define LOG_LEVEL_NONE    0
+#define LOG_LEVEL_ERROR   1
+#define LOG_LEVEL_WARN    2
+#define LOG_LEVEL_INFO    3
+#define LOG_LEVEL_DEBUG   4
+#define LOG_LEVEL_VERBOSE 5
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#ifndef LOG_DEFERRED
+#define LOG_DEFERRED 0
+#endif
+
+#define LOG_LINE_MAX 192            // longest formatted line, longer ones are cut
+#define LOG_RING_WORDS 512          // RTC ring size in 32-bit words (2 KB)
+#define LOG_RING_MAGIC 0x31524C54   // "TLR1", first word of a logRingRead() dump
+#define LOG_MAX_ARG_WORDS 24        // argument words kept per deferred record
+#define LOG_MAX_STRING 32           // characters of a %s argument kept in deferred mode
+
+void logPrintf(uint8_t level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#if LOG_DEFERRED
+
+void logRingAppend(uint8_t level, const char *fmt, const uint32_t *args, size_t argWords);
+
+// Copy the ring out as LOG_RING_MAGIC, word count, records (oldest first).
+// Returns the number of words written to `out`. The records stay in the ring
+// until logRingConsume().
+size_t logRingRead(uint32_t *out, size_t maxWords);
+
+// Drop the `words` record words of the last logRingRead() (its word count),
+// once they are safely uploaded
+void logRingConsume(size_t words);
+
+/******************************************************************************
+Argument packing for deferred records. Each argument becomes whole 32-bit
+words so the decoder can walk them with the format string:
+    integers up to 32 bits, pointers  1 word
+    64-bit integers                   2 words, low first
+    float / double                    1 word, IEEE single
+    strings                           length word + bytes, padded
+******************************************************************************/
+struct LogArgs {
+    uint32_t words[LOG_MAX_ARG_WORDS];
+    size_t count;
+
+    LogArgs() : count(0) {}
+
+    void word(uint32_t w)
+    {
+        if (count < LOG_MAX_ARG_WORDS) words[count++] = w;
+    }
+    void add(int v)                { word((uint32_t)v); }
+    void add(unsigned v)           { word(v); }
+    void add(long v)               { word((uint32_t)v); }
+    void add(unsigned long v)      { word((uint32_t)v); }
+    void add(long long v)          { add((unsigned long long)v); }
+    void add(unsigned long long v) { word((uint32_t)v); word((uint32_t)(v >> 32)); }
+    void add(double v)
+    {
+        float f = (float)v;
+        uint32_t w;
+        memcpy(&w, &f, sizeof(w));
+        word(w);
+    }
+    void add(const void *p)        { word((uint32_t)(uintptr_t)p); }
+    void add(const char *s)
+    {
+        size_t len = s ? strnlen(s, LOG_MAX_STRING) : 0;
+        word(len);
+        for (size_t i = 0; i < len; i += 4) {
+            uint32_t w = 0;
+            memcpy(&w, s + i, len - i < 4 ? len - i : 4);
+            word(w);
+        }
+    }
+    void add(char *s)              { add((const char *)s); }
+    // Narrow types go through the usual promotions, like they would for printf
+    void add(char v)               { add((int)v); }
+    void add(signed char v)        { add((int)v); }
+    void add(unsigned char v)      { add((int)v); }
+    void add(short v)              { add((int)v); }
+    void add(unsigned short v)     { add((int)v); }
+    void add(bool v)               { add((int)v); }
+    void add(float v)              { add((double)v); }
+
+    void pack() {}
+    template <typename T, typename... Rest>
+    void pack(T first, Rest... rest)
+    {
+        add(first);
+        pack(rest...);
+    }
+};
+
+template <typename... Args>
+inline void logDeferred(uint8_t level, const char *fmt, Args... args)
+{
+    LogArgs packed;
+    packed.pack(args...);
+    logRingAppend(level, fmt, packed.words, packed.count);
+}
+
+// `if (0) logPrintf` keeps the compile-time format check without emitting code
+#define LOG_AT(level, fmt, ...) do { \
+        if ((level) <= LOG_LEVEL) { \
+            if (0) logPrintf(level, fmt, ##__VA_ARGS__); \
+            logDeferred(level, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#else
+
+#define LOG_AT(level, fmt, ...) do { \
+        if ((level) <= LOG_LEVEL) logPrintf(level, fmt, ##__VA_ARGS__); \
+    } while (0)
+
+#endif
+
+#define LOG_E(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_W(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_I(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_D(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_V(fmt, ...) LOG_AT(LOG_LEVEL_VERBOSE, fmt, ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <stdint.h>
+
+// Blue-noise pattern dithering of RGB streams (DITHER_BLUE_NOISE builds), the
+// same as blue_noise_dither() in taulu-api/prepare.py. Written by
+// taulu-api/bench/dither.py header; do not edit.
+
+#define BLUE_NOISE_SIZE 64
+#define BLUE_NOISE_CANDIDATES 4 // palette colours mixed per pixel
+
+// Measured palette entries from darkest to lightest
+static const uint8_t BlueNoiseLuminanceOrder[] = { 0, 3, 4, 5, 2, 1 };
+
+// Void-and-cluster threshold matrix, tiled over the frame
+static const uint8_t BlueNoiseMatrix[BLUE_NOISE_SIZE * BLUE_NOISE_SIZE] = {
+    104, 223,  81, 157,  97, 199,  77,  11, 214, 120,  89,  29, 239, 115,  98, 249,
+    146,  53, 109, 128, 168, 223,  18,  55, 215, 162, 237,  21, 221, 194,  71, 207,
+     47, 236,  58,   5,  35, 177,  84, 244, 198,  34,  57, 188, 167,   4, 123, 196,
+     97, 237,  43, 151,  14, 165,  79, 113, 191, 247, 101,  89, 202, 254,  51, 137,
+    209, 165, 195,   1, 237, 125, 169, 103, 243,  17, 188, 224, 132,  44, 171,   4,
+    199,  29, 229,   9, 205,  80, 121, 247,  32,  75, 141,  93,  45, 178,   0, 166,
+    123, 107, 171, 139, 212,  96,  21, 133, 109, 221,  92,  23, 136,  74, 217, 156,
+     15, 171, 187,  87,  63,  30, 243, 155,  12,  24, 176,  34, 164,  10, 153, 181,
+     15,  35, 120,  70, 179,  29,  49, 204, 149,  40, 161,  58, 203,  81, 213,  60,
+    134,  85, 175,  71,  40, 156, 196,  91, 173, 106, 188,  61, 131, 234, 146,  83,
+    245,  16, 198,  76, 119, 226, 192,  45,  73, 159, 240, 204, 106, 233,  37,  56,
+    248,  72, 135, 229, 111, 195,  95, 216,  66, 205, 229,  57, 120, 216,  74,  94,
+     59, 246, 148, 108, 219, 139, 255,  87,  67, 231, 111,  96,  22, 242, 154, 105,
+    188, 245, 149, 117, 239,  23, 139,  47, 232,   5, 214, 254,  16, 112,  98,  37,
+     63, 216,  91,  28,  53, 162, 238,  10, 143, 182,  14,  63, 149, 179,  85, 117,
+    208, 102,   3, 205,  52, 137, 172,  44, 130, 105, 150,  83, 190,  42, 234, 129,
+    184,  88, 228,  43,  62,  10, 159, 183, 127,   3, 196, 172, 143,  10, 122,  36,
+    225,  13,  48, 209, 100, 187, 222,  67, 127, 150,  40, 158,  72, 202, 228, 190,
+    153, 128, 176, 255, 147, 104,  66, 124, 211,  83, 116,  47, 254,   8, 192,  28,
+    142, 177,  35, 123, 250,  10, 226,  27, 185, 238,   0, 136, 248,  18, 109, 201,
+    140,   7, 170, 205, 191,  95, 115,  20, 220,  81, 250,  47, 216,  75, 183, 165,
+     68,  93, 130, 164,  60,   3, 111, 179,  19,  81, 198, 119, 175,  51,  25, 168,
+      7, 231,  43, 205,   2, 185,  36, 168, 247,  29, 223, 172, 130,  96, 163, 220,
+     66, 242, 159,  79, 181, 149,  70,  88, 117,  52, 169,  68,  98, 173, 156,  28,
+    213,  53, 122,  25,  79, 234, 211,  37, 148,  59, 135,  29, 116, 230,  54, 252,
+     23, 195, 221,  31, 244,  88, 154, 251, 210,  99, 239,  12,  89, 218, 136,  77,
+    102,  57, 113,  73, 132, 234,  89, 200,  54, 101, 140, 196,  39,  75, 230, 125,
+     17,  46,  93, 216,  25, 104, 203, 162, 252, 212,  33, 198, 220,  47, 241,  80,
+    231, 101, 252, 151, 131, 165,  51, 246, 174, 102, 191, 161,  90, 202, 101, 133,
+    152, 110,  79, 177, 140, 203,  51,  27, 135,  57, 186, 143,  32, 248, 121, 207,
+    241, 144, 195,  24, 157, 218,  18, 115, 151,   4,  68, 242,  22, 206,  53, 108,
+    149, 235, 187, 115,  56, 231,  42, 142,  20,  78, 153, 124,   8, 143,  65, 117,
+     36, 159,  68, 188,  13, 107,  71, 199, 121,   7, 239,  65,  15, 176,  40,   3,
+    211, 238,  44, 120,  11, 228,  76, 170, 117, 225,  42, 165, 108,  65, 184,  41,
+     14, 163,  83, 247,  99,  49, 179,  78, 229, 188, 164,  90, 114, 154, 182,   0,
+    198,  71, 133,   8, 167, 192, 128,   4,  96, 188, 110, 227,  89, 180,  20, 193,
+     86,   2, 209,  47, 240,  31, 142,  88,  23, 227, 152, 210, 125, 247, 144,  86,
+    170,  61,  19, 188, 160, 103,  37, 191,  92,   9,  71, 205, 234,   2, 156,  93,
+    225, 177,  34, 210, 122,  64, 142, 252,  43, 125, 212,  14, 233, 136, 249,  83,
+    169,  35, 211, 254,  89,  66, 243, 219, 175, 237,  58,  40, 244, 207, 133, 167,
+    217, 112, 138,  94, 172, 204, 230, 182,  57,  97,  45,  80,  31, 189,  71, 228,
+    122, 199,  92, 254,  69, 128, 240, 145, 214, 249, 152, 125,  84, 194, 133,  53,
+    116,  68, 138,   5, 189, 166,  11, 205,  28, 106,  60, 176,  48,  30, 100,  61,
+    222, 104, 144,  20, 156,  32, 118,  48,  72, 137,  12, 159,  76, 105,  55, 249,
+     73, 185,  21, 223,  62, 114,   9, 156, 129, 219, 170, 139, 108, 221,  21,  50,
+    157,  32, 219, 146,  48, 206,   0,  63,  24, 179, 104,  49,  19, 172, 250,  26,
+    201, 239, 106, 232,  40, 223,  92, 130, 160,  84, 226, 146,  77, 216, 161,  11,
+    240, 122,  53,  78, 183, 206,  99, 165, 210,  26, 196, 126, 172,  31,   9, 148,
+     38, 236, 161, 126,  82, 246,  41,  76, 193, 253,   1, 205,  59, 162, 241,  99,
+    184, 136, 109,  14, 181, 225, 114, 166,  81, 134,  34, 226, 209,  63, 100, 219,
+    150,  18,  88,  56, 152, 111, 243,  70, 194, 238,   3, 185, 116, 201, 130, 189,
+     43, 176, 202, 236, 131, 227,  17, 147,  85, 114, 249, 215,  94, 190, 224, 124,
+    202,  99,  52,  11, 194, 140, 168, 103,  26, 116,  37,  90, 180,  12, 118,  81,
+      4, 248,  74, 171,  86,  30,  99, 200,  53, 235, 192, 159, 113, 140,  39,  76,
+    126, 184, 169, 198,  77,  21, 178,  52,  18, 138,  96,  39, 255,  21,  67,  85,
+    149,  27,  94,   3, 109,  42,  61, 190, 234,  39,  65, 143,  49, 242, 110,  63,
+     24, 173, 255, 151,  32, 215,  56, 233, 208,  68, 149, 244, 130, 196, 146, 213,
+    231,  39, 204,  56, 238, 135, 153, 247, 121,  16,  91,  74,   9, 231, 188, 163,
+      7,  46, 252, 122, 218, 142, 204,  36, 119, 173, 217,  57, 166, 103, 233, 209,
+    111, 249, 160,  69, 142, 170, 251,   9, 157, 104, 179,   1,  80,  18, 157, 182,
+    140,  78, 207, 109,  90, 180,   7, 133, 160, 187,  50, 228,  75,  34,  49, 167,
+     65, 129, 156, 120, 193,  19,  68,  41, 183, 219, 147, 255, 177,  29,  85, 241,
+    212,  97,  66,  33,   1,  99, 231, 157, 248,  72, 200, 127,  15, 155,  50, 137,
+      8, 223,  56, 197, 217,  81, 121, 202, 133,  22, 230, 164, 207, 128, 237,  88,
+     10, 120,  41, 227,  65, 241, 118,  84,  24,  95, 174, 105,  19, 220, 112,  94,
+    191,  26, 103,   7, 216,  94, 229, 171,   4, 106,  58,  42, 120, 203, 134,  55,
+    111, 144, 226, 159, 190, 133,  58,  88, 107,   7, 149,  84, 241, 195, 179,  31,
+     78, 185, 119,  36,  13, 177,  96,  52,  74, 220,  90, 114, 191,  54,  35, 214,
+    224,  56, 185, 130,  21, 155, 198,  45, 251, 213,   4, 138, 201, 158, 254,  15,
+    178, 209, 243,  75, 164,  51, 141, 206,  79, 130, 212, 165,  67, 102, 154,  17,
+    196,  24, 177,  84,  44, 245,  17, 181, 211,  47, 230,  33, 113,  64,  93, 228,
+    127, 168, 100, 245, 154, 230,  27, 242, 184, 146,  41, 254,  69, 151, 103, 167,
+     71, 146, 246,   0, 100, 173,  73, 225, 146,  62, 119, 238,  87,  69, 125,  56,
+    137,  84, 148,  43, 186, 253, 113,  32, 157, 246,  25, 190, 235,   2, 223, 247,
+     74, 129, 234, 117, 215,  71, 165, 125,  26, 139, 187, 170, 218,   1, 145, 251,
+     44, 215,  19,  86, 132,  47, 112, 209,   6,  61, 172,  27, 136,   5, 244, 195,
+     16,  94, 161, 201, 217, 138,  36, 107,  12, 192, 164,  28,  40, 172, 232,   1,
+    218,  32, 227, 107,  21, 128,  87,  62, 198,  12,  95, 137,  81, 180,  48,  93,
+    168,  37,  57,  15, 101, 147, 199, 225,  65, 253, 100,  76,  53, 122, 203,  22,
+     72, 150,  60, 205, 186,  70, 141, 164, 103, 126, 215, 199,  98, 229,  45, 116,
+    176, 234,  49,  82,  28,  58, 235, 181, 127,  80, 224,  52, 185, 143,  96, 194,
+    160, 117,  60, 171, 204,   6, 222, 181, 237, 119,  51, 220,  36, 143, 116, 210,
+    189, 150, 254, 207, 182,   5,  36, 112,  85, 157,  10, 133, 242, 160, 103, 175,
+    191, 114, 238, 166,   2, 222,  34, 194,  82, 246,  15,  76, 162, 182,  85, 131,
+    211,  34, 109, 125, 251, 165,  92, 205,  18, 153,  99, 249, 114, 208,  25,  76,
+     45, 250, 134,  72, 236, 153, 101,  44,  73, 147, 174, 109, 242, 161,  28,  66,
+      8, 108,  81, 160, 124,  91, 241,  54, 173, 207,  41, 193,  20, 213,  36,  86,
+    138,  13,  39, 106, 124, 252,  94,  18, 225, 153,  53, 119,  33, 220,  62,  22,
+    139, 193,  67, 152, 187,   6, 117,  50, 240,  67, 199, 133,   6,  59, 241, 105,
+    177, 200,  18,  93, 191,  29, 137, 168, 217,  26, 195,  61,  16, 204, 127, 233,
+    221, 137,  23,  46,  64, 231, 141, 189,  21, 122, 230,  89, 177,  69, 232,  55,
+    247, 201, 224,  77,  54, 147, 173,  64,  43, 134, 177, 240, 107, 202, 155, 253,
+     91, 166, 230,  20, 212,  74, 147, 221, 170,  25,  37, 178,  89, 155, 220, 123,
+    148,   8, 215, 114,  41,  58, 251,  84,   1, 129, 248,  92,  78, 182, 101,  54,
+     87, 175, 242, 191, 219, 167,  29,  78, 246, 151, 105,  49, 140, 115, 152,   5,
+    126,  92, 157, 181,  27, 214, 200, 115, 233, 189,  89,   1, 144,  48,  13,  77,
+    121,   3,  44, 100, 134, 244,  39,  85, 137, 107, 217,  75, 235,  16, 169,  35,
+     86,  53, 244, 141, 174, 225, 121, 206, 105, 158,  38, 227, 151,   6, 246, 164,
+     36, 201,  70, 115,  14, 130, 100, 213,   2,  69, 218,  14, 251, 197,  30, 219,
+    171,  65,  17, 236, 132,  83,   6, 160, 102,  20, 210,  68, 224, 127, 188, 236,
+     55, 221, 200, 176,  60, 111, 197,  11, 183, 255, 160, 119,  45, 138, 191,  68,
+    229, 185, 103,  76, 156,   9, 182,  67,  51, 186, 210, 114, 135,  45, 191, 120,
+    146,   0,  98, 154,  42, 203,  58, 113, 162, 135, 181,  61, 164,  96,  76, 186,
+    107, 145,  48, 193,  98,  42, 246, 140,  74,  36, 250, 154,  97,  27, 174, 105,
+     32, 142, 250,  83,  29, 165, 236,  55,  96,  17,  62, 210, 198, 101, 250,  24,
+    131, 163, 206,  27, 235,  90,  21, 146, 238,  14,  74,  28, 174, 217,  69,  22,
+    212, 251, 134, 224,  85, 175, 253, 187,  32,  91, 203,  38, 228, 131,  18, 243,
+     37, 208, 255, 115, 166, 221,  59, 184, 204, 126, 167,  57, 196, 243,  72, 158,
+    190,  65, 126, 155,   9, 208, 121, 150, 191, 129,  32, 146,   4,  82,  55, 212,
+    113,   1,  44,  63, 127, 216, 111, 201, 134, 169,  98, 254,  57,  90, 230, 108,
+     80,  57, 184,  28, 234,  10, 146,  47, 221, 238, 124,   6, 111, 211, 156,  59,
+     86, 124,   0,  72, 150,  14, 106,  26, 238,  88,  10, 112,  42, 138,   7, 213,
+     95,  16, 109, 185, 230,  71,  37, 219,  80, 245, 226, 167, 110, 234, 174, 153,
+     89, 247, 140, 197, 168,  35, 250,  45,  83, 227, 119, 199, 142,  10, 155, 196,
+    172, 124,  47, 161,  67,  97, 121,  78,  16, 154,  71, 175,  84,  47, 236, 173,
+    139, 226, 179,  33, 232, 210, 174, 119,  48, 145, 228, 180, 208,  85, 117, 232,
+     38, 242, 216,  49,  91, 139, 105,   0, 176,  46,  92,  70, 186,  37, 126,  15,
+     72, 181, 223,  99,  80, 151, 179,  60,  25, 158,   3,  42, 183, 126, 245,  35,
+     13, 237, 104, 215, 141, 192, 208, 171, 106,  54, 194, 252, 147, 189,  12, 102,
+     26, 199,  54,  94, 133,  82,  66, 158, 193, 215,  76,  23, 255, 151,  51, 166,
+    179,  79, 147,  25, 169, 252, 199,  62, 158, 115, 203,  23, 135, 218,  49, 199,
+    237,  31, 120,  20, 241,  12, 105, 125, 190, 214,  68, 239,  82, 165,  52,  95,
+    148, 200,  77,   4, 243,  25,  39, 226, 241, 137,  22, 100,  33,  64, 119, 206,
+     77, 154, 111, 248, 186,  43, 239,   3,  97,  34, 135, 107,  63,  14, 200, 127,
+      3, 204, 115,  59, 190,  15, 124, 235,  29, 141, 239,  11, 155, 253,  95, 107,
+    161,  61, 147,  50, 193,  71, 207, 233,  91, 144, 110, 222,  16, 206, 114,  67,
+    213, 135,  42, 118, 167,  59, 131,  85,   5, 162, 205, 218, 129, 229, 163, 241,
+     39, 220,   9, 164,  20, 144, 203, 128, 248,  55, 177, 162, 192,  93, 225,  68,
+    101, 159, 246, 133, 222,  41,  81, 180,  98, 211,  55, 192,  83,  63, 179,   5,
+    136, 212,  88, 170, 220, 136, 162,   5,  34, 173,  49, 136,  99,  30, 188, 228,
+     19, 174, 255, 187,  90, 110, 202, 178,  66, 118,  90,  44,  76, 179,   3,  93,
+    141,  67, 125, 196,  60, 103,  30, 170,  84, 222,   8, 236, 123,  36, 241, 140,
+    219,  46,  12,  75,  97, 163, 149, 227,   9,  73, 169, 108, 123,  30, 205, 232,
+     42, 187, 249,   8, 110,  38,  57, 252,  78, 198, 245,  62, 178, 152, 248, 127,
+     87,  57,  29, 153, 219,  16, 246, 149,  31, 185, 248,  17, 145, 200, 109,  51,
+    253, 177,  87, 234, 213, 118, 229,  68, 151, 113, 198,  46,  80, 157, 183,  28,
+     87, 173, 196, 236,  32, 206, 117,  50, 251, 128,  38, 224, 245, 147, 165,  78,
+    116,  23,  69, 127, 230,  95, 184, 119, 154,  19, 124,   9, 212,  76,  46,   2,
+    163, 103, 231,  69,  46, 142,  76, 228,  52, 106, 224, 169,  58, 237,  25, 158,
+    193,  17,  34, 149,  48,  79, 185,  14, 209,  26,  99, 143, 215,  18, 111,  58,
+    253, 121, 145, 107, 182,  66,  17,  87, 197, 139, 186,   2,  91,  49,  17, 131,
+    218, 102, 157, 176, 203,  15, 147, 211, 102, 226, 168,  90, 237, 110, 142, 221,
+    184, 117, 204, 128, 193, 101,   1, 123, 209, 156,  10, 133,  86, 215, 122,  73,
+    133, 207, 108, 171,   1, 247, 162,  42, 132, 252,  59, 172,  71, 244, 132, 207,
+      9,  70,  25,  54, 132, 247, 212, 175,  30, 102, 158,  68, 213, 176, 241,  59,
+    196, 235,  50,  33,  81,  64, 242,  44,  26,  69, 186,  38, 160,  22, 197,  64,
+     37, 240,  10,  23, 159, 235, 171,  39, 191,  94,  71, 198,  31, 101, 185,  41,
+    228,  95,  61, 238, 139, 124,  97, 195,  88, 180, 230, 121,   0, 194,  41, 165,
+    152, 190, 231, 217,   2, 155,  96, 144,  58, 218, 235,  24, 112, 193,  99, 143,
+      4,  87, 150, 255, 189, 138, 165,  86, 235, 112, 140, 206,  56, 132, 250,  94,
+    149,  78, 174,  91, 214,  56,  81, 249,  25, 141, 230,  46, 251, 153,   5, 244,
+    166,  12, 214, 188,  73,  24, 222,  54, 148,  11,  35, 155,  93, 225,  81, 103,
+    238,  44,  91, 169,  78, 122,  43, 238,   7, 121,  82,  45, 152, 126,  73,  31,
+    170, 210, 106,  20, 115, 208,   0, 128, 195,  51,   6, 222,  80, 104,  12, 168,
+    216,  53, 136, 252,  31, 115, 134, 181, 108,  60, 166, 124, 176, 112,  66, 144,
+     82,  51, 116, 155,  38, 203, 107, 243,  67, 214, 111, 202,  53, 141, 182,  30,
+    211, 138, 112, 203,  33, 188, 222,  73, 162, 200, 173, 252, 207,  13, 226, 246,
+     43, 183, 132, 225,  56,  40,  97, 218, 171, 148, 253, 120, 175, 232, 191,  28,
+    123, 200, 106, 185,  66, 206, 153,  13, 219, 239,   6,  83, 212,  19, 223, 201,
+    127, 180,  21, 254,  88, 174,   7, 163, 128,  82, 240, 167,  23, 247,  63, 124,
+     75,   6,  58, 158, 245, 102,  13, 180, 110,  21, 135,  65,  36, 185,  83, 160,
+    118,  65,  12,  77, 162, 239, 180,  63,  32,  74,  16,  92,  34, 143,  48,  74,
+    242,   5,  41, 145,  17, 232,  45,  90,  70, 202, 148,  39, 189,  56,  93,  30,
+    239, 104, 220, 131,  64, 233, 141,  33, 191,  17,  45, 134, 104, 217,  14, 172,
+    250, 184, 223,  17, 143,  65, 132, 249,  88,  53, 223,  97, 146, 108,  55, 136,
+    219,  96, 244, 201, 148, 123,  15, 108, 243, 157, 202, 184,  63, 211, 154, 112,
+    225, 161,  85, 216, 169, 100, 195, 163, 129,  30, 116, 100, 232, 157, 137, 192,
+     43,  74,   8, 150, 197,  46, 114, 211,  98, 227, 181,  72, 193,  87, 150, 109,
+     29,  97, 126,  86, 197,  49, 208,  29, 148, 193, 240,   4, 170, 234, 199,   8,
+     25, 192, 171,  35,  89, 227, 190, 137,  84, 228, 127, 101, 245,   3, 131, 180,
+     95,  60, 128, 246,  75, 120,   7, 244,  55, 183, 254, 171,  73,   1, 248, 117,
+    172, 159, 209,  96,  26, 184,  75, 247,  54, 153, 118,   7, 230,  38, 206,  51,
+    233, 166,  41, 240, 173, 114, 231, 163,  40, 118,  77, 129, 212,  30,  90, 251,
+    151, 111,  49, 139,   6,  70,  52,  24, 208,  38,  50,  21, 163,  83, 234,  38,
+     13, 208,  21, 187,  54,  35, 220, 141,  79, 213,  15,  49, 130, 209,  85,  62,
+     19, 232,  50, 245, 122, 161,   2,  89, 170,  28, 139, 255,  58, 160, 130, 188,
+    141, 212,  68, 151,  23,  79,   0,  97, 217, 177,  19, 158,  48,  68, 123, 179,
+     78,  62, 233, 204, 105, 253, 214, 159, 174, 113, 145, 198, 217, 109,  70, 193,
+    255, 172, 102, 138, 237, 155, 178, 110,  25,  95, 147, 226, 108,  27, 184, 146,
+    203, 112,  80, 140,  62, 228, 204, 129, 222,  66, 208,  92, 175, 115,   2,  82,
+     21, 117,   9, 106, 221, 187, 128,  70, 202,  60, 255,  95, 186, 144, 223,  40,
+    165, 213, 126,  26, 182, 150, 120,  97,   2,  73, 250,  59, 176,  15, 142,  50,
+    118, 148,  30, 200,   0,  93,  67, 232, 197, 168,  63, 191, 240, 163,  38, 224,
+     98,   5, 190,  33, 178,  19, 105,  41, 188,  11, 108, 195,  34, 242, 219,  62,
+    158, 253, 204, 180,  57, 248, 145, 235,  26, 138, 112,   8, 236, 200, 102,  16,
+    238,   4,  93, 161,  79,  40,  60, 226, 195, 235,  92, 134,  35, 229, 159, 210,
+     87,  63, 224,  79, 125, 211,  45,  12, 134, 118,  39,  10,  70,  92, 122,  54,
+    253, 130, 166, 221,  91, 151, 251,  80, 144, 238,  47, 156,  73,  16, 102, 197,
+     88,  46, 135,  93,  29,  41, 161, 103,  51, 192, 227,  80, 167,  26,  60, 139,
+    114, 190,  46, 248, 218,  11, 178, 130,  31, 166,  13, 188,  80, 124,  98,  24,
+    242, 168,  41, 109, 184, 252, 162,  86, 242, 206, 221, 157, 138, 204, 175,  13,
+    153,  67,  44, 240, 118,  52, 198,  15, 166, 117,  85, 215, 125, 145, 233, 178,
+     27,  74, 225, 168, 123, 209,  84,   7, 172, 150,  34, 130,  45, 119, 250,  86,
+    207, 149,  71, 135, 194, 111, 244,  86,  50, 153, 116, 221,  48, 240, 201,   3,
+    181, 131, 232, 153,  22,  59, 143, 175,  28,  52, 103,  83, 250,  24, 233,  79,
+    215, 194, 106,  23, 210,  72, 131, 234,  61, 183,  23, 249, 169,  55,  37, 132,
+    243, 192, 152,   4,  66, 194, 113, 244, 224,  73,  92, 213, 178, 154, 218, 183,
+     19,  55, 174,  30,  96,  20, 143, 204,  70, 214, 101,  26, 149, 171,  70, 113,
+     56,  27,  74, 195,  10, 100, 226, 114,  75, 187, 129,   2, 181,  47, 113, 135,
+     32, 179,  85, 139, 161,  11, 177,  96,  35, 227, 137,   3, 192,  95, 208, 112,
+     60,  18, 101, 248, 231, 142,  19, 182, 124,  13, 202, 246,  65,   5,  76,  36,
+    106, 241, 222, 123, 231,  64, 169, 237,   5, 177, 254,  64, 196,  11, 139, 249,
+    220, 144,  95, 209, 243, 129,  38, 200,  19, 247, 152, 228,  65, 199, 100, 169,
+     59, 232,   0, 200, 249,  43, 219, 113, 158, 202, 103,  45,  67, 229,   9, 163,
+    216, 120, 183,  36,  53,  78, 214,  42,  61, 163, 110,  22, 144,  99, 233, 167,
+    132, 157,   0,  82, 209, 155,  35, 119,  93, 137,  40, 126, 235, 107,  90,  43,
+    186, 164, 120,  49, 173,  82, 158, 214,  62,  96, 167, 117,  33, 145, 243,  18,
+    218, 122, 150, 102,  61, 186,  84, 145,  25,  75, 214, 122, 152, 182,  80, 141,
+     46, 201,  86, 131, 172, 107, 157,  95, 137, 237,  52, 196, 127, 187,  48, 203,
+     89,  64, 196,  42, 182, 105,  56, 189,  17, 201, 162,  83, 180,  33, 156, 203,
+     81,   6, 238,  33,  66, 190,   4, 139, 236,  43,  14, 195,  88, 211,  73, 160,
+     93,  37, 237,  76,  28, 120, 239,   5,  56, 252, 167,  89, 245,  24, 105, 239,
+     72,  12, 147, 221,  24, 203, 251,  29, 217, 174,  87,  37, 225, 113,  15, 244,
+     27, 118, 254, 143,  12, 131, 248, 217,  75, 229,  52,  20, 209, 227,  59, 130,
+     23, 106, 226, 151,  92, 253, 107, 121, 176,  79, 223, 136,  55, 173,   6, 129,
+    190,  53, 207, 175, 135, 225, 163, 194, 129, 178,  38,  13, 135, 197,  34, 174,
+    226,  98, 160, 237,  67,   1, 118, 185,  72,  10, 150, 253,  77, 162,  59, 147,
+    218, 173, 102,  51, 235,  88,  27, 159, 110, 147, 245, 100, 119,   7, 172, 251,
+    212,  70, 195, 137,  16, 220,  30,  51, 149, 189, 104,  27, 255, 229,  44, 110,
+    247,  14, 155, 109,   8,  47,  94,  68, 207, 107, 234,  53, 222,  64, 155, 127,
+    255,  57, 113,  42, 192,  84, 145,  48, 234, 129, 106, 178,   2, 215, 134,  82,
+    184,   8,  72, 211, 152, 194,  64, 178,  44,   1, 134,  63, 192,  77, 142,  94,
+     46, 167, 125,  56, 181, 161, 197,  69, 246,   9, 206, 123, 154,  98, 181, 140,
+    222,  67,  88, 196, 253, 213, 149,  32,  18,  79, 144, 187,  95, 115, 205,   6,
+    186,  30, 213, 178, 125, 242, 168, 100, 198,  20, 210,  65,  33, 199,  97,  43,
+    231, 126,  32, 166, 112,  15, 227, 124,  96, 199, 169, 215, 154, 241,  35, 189,
+    115,   8, 245,  38, 102,  83, 131, 229,  94,  39, 164,  62,  75,  22, 201,  82,
+     31, 169, 128,  24,  62, 180, 116, 244, 224, 158, 123,   0, 165, 243,  44,  82,
+    167, 133,  17,  92,  61,  11, 222,  33,  58, 161,  89, 243, 143, 115, 237,  20,
+    156, 202,  91, 222,  41,  82, 140, 207, 253,  34,  84,  22,  48, 108,  13, 229,
+    156, 216,  77, 202, 233,   1, 210,  22, 116, 183, 134, 239, 216,   3, 121,  57,
+    211, 240, 104, 227, 142,  40,  86, 170, 100,  45, 199, 215,  74,  22, 142, 105,
+     62, 197, 247, 141, 156, 207,  78, 134, 112, 230, 186, 123,  52, 168, 189,  69,
+    110,  55, 250, 132, 186, 242,  55,  11,  72, 184, 235, 127, 223, 179, 136,  64,
+     87, 175,  20, 146, 118,  47, 153, 171,  57, 223,  84,  33, 187, 170, 248, 146,
+    159,  10,  49, 186,  77,  13, 132, 192,   8,  65, 252,  34,  91, 182, 236, 219,
+    119,  77, 227,  50, 104,  27, 180, 250, 148,   8,  40,  79,  24, 224,   9, 246,
+    177, 145,   2,  66,  22, 174, 104, 164, 148, 116,  58, 160,  98,  74, 200, 254,
+     28, 105, 133,  60, 178, 251,  75, 103, 243,   7, 143, 109,  50,  89, 101,  40,
+    193, 116,  91, 206, 162, 239, 212,  54, 228, 141, 176, 116, 135,  54, 152,  14,
+    161,   4,  37, 170, 236, 121, 201,  46,  71, 217, 171, 205, 152,  94, 136,  83,
+     31, 216, 101, 197, 154, 120, 229,  27, 217,  94,   4, 209,  18,  39, 148, 122,
+     52, 194, 240, 220,  91,  31, 193, 138,  42, 208, 160, 197, 236, 130, 225,  18,
+     72, 136, 231,  32, 148, 109,  23, 121, 155,  80, 104,  16, 230, 210,  39,  98,
+    206, 189,  90, 214,  66,   7,  87, 164,  21,  98, 128, 254, 108,  60, 208, 164,
+     47, 117, 236,  77, 210,  48,  86, 195,  39, 249, 138, 189, 240, 170, 226,   6,
+    213, 163,  40,  11, 158, 205,  16, 122, 180,  79,  26,  69,  12, 152,  63, 214,
+    179, 254,   1,  58, 175,  69, 250,  92, 201,  29, 241, 187, 159,  71, 125, 245,
+     28, 144, 114, 132, 183, 150, 245, 111, 194, 233,  50,   0, 197,  37, 232, 125,
+    190,  14, 159,  35, 140,   6, 239, 131,  69, 176,  50,  81, 104,  59, 113,  90,
+    183,  78,  99, 126,  69, 110, 231,  64, 216,  97, 252, 114, 176, 205,  31, 108,
+    164,  81, 198, 129,  99,  38, 183,   5, 218, 168,  43,  61,   3, 194,  85, 173,
+     64,  44, 251,  20,  54, 224,  36, 138,  61, 175, 145,  75, 181, 156,  19,  70,
+    220,  90, 182, 255,  61,  99, 185, 151, 110,  11, 204, 123, 154,  31, 249, 136,
+     23, 151, 224, 189, 249, 145,  50, 166,   2, 150, 128, 228,  46,  87, 244, 142,
+     52,  25, 118, 221, 208, 233, 140,  51, 126,  73, 144, 223, 132, 111,  22, 232
+};
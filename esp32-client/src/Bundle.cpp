@@ -0,0 +1,185 @@
+#include "Bundle.h"
+#include "FrameBuffer.h"
+#include "Log.h"
+#include "esp_task_wdt.h"
+#if CONFIG_IDF_TARGET_ESP32S3
+#include "esp32s3/rom/miniz.h"
+#else
+#include "esp32/rom/miniz.h"
+#endif
+
+#define BUNDLE_ID_LENGTH 64
+#define BUNDLE_READ_CHUNK 4096
+
+struct BundleHeader {
+    uint32_t magic;
+    uint32_t serverTime;
+    uint16_t count;
+    uint16_t reserved;
+} __attribute__((packed));
+
+struct BundleFrameHeader {
+    char imageId[BUNDLE_ID_LENGTH];
+    uint32_t displayAt;
+    uint32_t length;
+} __attribute__((packed));
+
+// Stream::readBytes gives up after one timeout; keep going until the
+// stream stops delivering.
+static bool readFully(Stream* stream, uint8_t* buffer, size_t length) {
+    size_t got = 0;
+    while (got < length) {
+        size_t n = stream->readBytes(buffer + got, length - got);
+        if (n == 0) return false;
+        got += n;
+    }
+    return true;
+}
+
+static bool skipBytes(Stream* stream, uint32_t length, uint8_t* chunk) {
+    while (length > 0) {
+        size_t n = min((uint32_t)BUNDLE_READ_CHUNK, length);
+        if (!readFully(stream, chunk, n)) return false;
+        length -= n;
+    }
+    return true;
+}
+
+// Inflate `length` bytes of zlib data from the stream into `frame`
+static bool inflateFrame(Stream* stream, uint32_t length, uint8_t* frame,
+                         tinfl_decompressor* inflator, uint8_t* chunk) {
+    tinfl_init(inflator);
+    size_t outPos = 0;
+    uint32_t remaining = length;
+    tinfl_status status = TINFL_STATUS_NEEDS_MORE_INPUT;
+
+    while (remaining > 0) {
+        size_t n = min((uint32_t)BUNDLE_READ_CHUNK, remaining);
+        if (!readFully(stream, chunk, n)) return false;
+        remaining -= n;
+
+        size_t inPos = 0;
+        while (inPos < n) {
+            size_t inBytes = n - inPos;
+            size_t outBytes = FRAME_STORE_FRAME_SIZE - outPos;
+            uint32_t flags = TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF;
+            if (remaining > 0) flags |= TINFL_FLAG_HAS_MORE_INPUT;
+            status = tinfl_decompress(inflator, chunk + inPos, &inBytes, frame, frame + outPos, &outBytes, flags);
+            inPos += inBytes;
+            outPos += outBytes;
+            if (status < TINFL_STATUS_DONE) return false;
+            if (status == TINFL_STATUS_DONE) {
+                return outPos == FRAME_STORE_FRAME_SIZE && skipBytes(stream, remaining, chunk);
+            }
+            if (inBytes == 0 && outBytes == 0) return false; // frame larger than the panel
+        }
+        esp_task_wdt_reset();
+    }
+    return false;
+}
+
+int bundleCapacity(int keepSlot) {
+    int count = 0;
+    for (int slot = FRAME_SLOT_BUNDLE_FIRST; slot < frameStoreSlotCount(); slot++) {
+        if (slot != keepSlot) count++;
+    }
+    return count;
+}
+
+int bundleReceive(Stream* stream, int keepSlot, uint32_t* serverTime) {
+    BundleHeader header;
+    if (!readFully(stream, (uint8_t*)&header, sizeof(header)) || header.magic != BUNDLE_MAGIC) {
+        LOG_E("Bundle: bad header");
+        return -1;
+    }
+    *serverTime = header.serverTime;
+    LOG_I("Bundle: %u frames", header.count);
+
+    FrameBuffer frame;
+    frame.allocate(FrameBuffer::Psram); // inflated frames fill every byte
+    uint8_t* chunk = (uint8_t*)malloc(BUNDLE_READ_CHUNK);
+    tinfl_decompressor* inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    if (!frame || !chunk || !inflator) {
+        LOG_E("Bundle: out of memory");
+        free(chunk);
+        free(inflator);
+        return 0;
+    }
+
+    int stored = 0;
+    int slot = FRAME_SLOT_BUNDLE_FIRST;
+    for (uint16_t i = 0; i < header.count; i++) {
+        BundleFrameHeader frameHeader;
+        if (!readFully(stream, (uint8_t*)&frameHeader, sizeof(frameHeader))) break;
+
+        char imageId[BUNDLE_ID_LENGTH + 1];
+        memcpy(imageId, frameHeader.imageId, BUNDLE_ID_LENGTH);
+        imageId[BUNDLE_ID_LENGTH] = '\0';
+
+        while (slot == keepSlot) slot++;
+        if (slot >= frameStoreSlotCount()) {
+            if (!skipBytes(stream, frameHeader.length, chunk)) break;
+            continue;
+        }
+        if (!inflateFrame(stream, frameHeader.length, frame.data(), inflator, chunk)) {
+            LOG_E("Bundle: inflate failed for %s", imageId);
+            break;
+        }
+        if (frameStoreSave(slot, imageId, frame.frame(), frameHeader.displayAt)) {
+            stored++;
+            slot++;
+        }
+    }
+
+    // Whatever is left over belongs to an older bundle
+    for (; slot < frameStoreSlotCount(); slot++) {
+        if (slot != keepSlot) frameStoreErase(slot);
+    }
+
+    free(chunk);
+    free(inflator);
+    return stored;
+}
+
+int bundleDueSlot(time_t now, const char* currentImageId) {
+    int best = -1;
+    uint32_t bestAt = 0;
+    FrameInfo info;
+    for (int slot = FRAME_SLOT_BUNDLE_FIRST; slot < frameStoreSlotCount(); slot++) {
+        if (!frameStoreInfo(slot, &info) || info.displayAt == 0) continue;
+        if ((time_t)info.displayAt > now || info.displayAt < bestAt) continue;
+        best = slot;
+        bestAt = info.displayAt;
+    }
+    if (best >= 0 && frameStoreInfo(best, &info) && strcmp(info.imageId, currentImageId) == 0) {
+        return -1;
+    }
+    return best;
+}
+
+int bundlePendingCount(time_t now) {
+    int count = 0;
+    FrameInfo info;
+    for (int slot = FRAME_SLOT_BUNDLE_FIRST; slot < frameStoreSlotCount(); slot++) {
+        if (frameStoreInfo(slot, &info) && (time_t)info.displayAt > now) count++;
+    }
+    return count;
+}
+
+time_t bundleNextDisplayAt(time_t now) {
+    time_t next = 0;
+    FrameInfo info;
+    for (int slot = FRAME_SLOT_BUNDLE_FIRST; slot < frameStoreSlotCount(); slot++) {
+        if (!frameStoreInfo(slot, &info) || (time_t)info.displayAt <= now) continue;
+        if (next == 0 || (time_t)info.displayAt < next) next = info.displayAt;
+    }
+    return next;
+}
+
+void bundleDiscardBefore(uint32_t displayAt, int keepSlot) {
+    FrameInfo info;
+    for (int slot = FRAME_SLOT_BUNDLE_FIRST; slot < frameStoreSlotCount(); slot++) {
+        if (slot == keepSlot) continue;
+        if (frameStoreInfo(slot, &info) && info.displayAt < displayAt) frameStoreErase(slot);
+    }
+}
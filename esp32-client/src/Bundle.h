@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+#include "FrameStore.h"
+
+// Offline slideshow. /api/bundle.bin returns the next few daily frames,
+// each zlib-compressed and tagged with the Unix time it should go up.
+// They are inflated into frame store slots FRAME_SLOT_BUNDLE_FIRST.. and
+// shown from flash on timer wakes, so the device only has to join WiFi
+// again once the bundle runs low.
+//
+// Wire format (little-endian):
+//   header:    'TBD1', u32 server time, u16 frame count, u16 reserved
+//   per frame: char[64] image id, u32 display time, u32 length, zlib data
+
+#define FRAME_SLOT_BUNDLE_FIRST 1
+#define BUNDLE_MAGIC 0x31444254 // "TBD1"
+
+// Number of slots a bundle can fill, leaving out `keepSlot` (the frame on
+// the panel, so KEY1 can still redraw it).
+int bundleCapacity(int keepSlot);
+
+// Store the frames of a bundle response. Returns the number stored, or -1
+// if the stream is not a bundle. serverTime is set once the header is read.
+int bundleReceive(Stream* stream, int keepSlot, uint32_t* serverTime);
+
+// Latest stored frame with a display time at or before `now` that is not
+// the frame already shown; -1 if none is due.
+int bundleDueSlot(time_t now, const char* currentImageId);
+
+// Frames still scheduled after `now`, and the earliest of their times (0 if none).
+int bundlePendingCount(time_t now);
+time_t bundleNextDisplayAt(time_t now);
+
+// Drop stored frames scheduled before `displayAt`, except `keepSlot`.
+void bundleDiscardBefore(uint32_t displayAt, int keepSlot);
@@ -0,0 +1,213 @@
+#include "Capture.h"
+
+#if CAPTURE_SESSION
+
+#include "DEV_Config.h"
+#include "Log.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+#define CAPTURE_HEADER_SIZE 16
+#define CAPTURE_RECORD_HEADER_SIZE 12
+
+// The network is recorded from the refresh window task while the main task
+// drives the panel, so space is claimed under a lock and filled outside it.
+static portMUX_TYPE captureLock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t* buffer = nullptr;
+static size_t used = CAPTURE_HEADER_SIZE;
+static size_t lastRecord = 0; // offset of the newest record, 0 if none
+static uint32_t dropped = 0;
+static int64_t startUs = 0;
+static bool recording = false;
+static uint8_t nextStream = 1;
+
+static size_t padded(size_t length) {
+    return (length + 3) & ~(size_t)3;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Room for `length` payload bytes of a record, or nullptr when full. Network
+// reads and writes continue the newest record if it is the same kind on
+// the same stream and started within CAPTURE_COALESCE_US; header lines are
+// read a byte at a time.
+static uint8_t* claim(uint8_t kind, uint8_t stream, size_t length, bool coalesce) {
+    if (!recording) return nullptr;
+    uint32_t now = (uint32_t)(esp_timer_get_time() - startUs);
+    uint8_t* payload = nullptr;
+
+    portENTER_CRITICAL(&captureLock);
+    if (coalesce && lastRecord != 0) {
+        uint8_t* record = buffer + lastRecord;
+        size_t oldLength = get32(record + 8);
+        size_t end = lastRecord + CAPTURE_RECORD_HEADER_SIZE + oldLength;
+        if (record[0] == kind && record[1] == stream && now - get32(record + 4) < CAPTURE_COALESCE_US &&
+            end + length <= CAPTURE_BUFFER_SIZE) {
+            put32(record + 8, oldLength + length);
+            used = lastRecord + CAPTURE_RECORD_HEADER_SIZE + padded(oldLength + length);
+            payload = buffer + end;
+        }
+    }
+    if (!payload) {
+        size_t size = CAPTURE_RECORD_HEADER_SIZE + padded(length);
+        if (used + size <= CAPTURE_BUFFER_SIZE) {
+            uint8_t* record = buffer + used;
+            record[0] = kind;
+            record[1] = stream;
+            record[2] = record[3] = 0;
+            put32(record + 4, now);
+            put32(record + 8, length);
+            lastRecord = used;
+            used += size;
+            payload = record + CAPTURE_RECORD_HEADER_SIZE;
+        } else {
+            dropped++;
+        }
+    }
+    portEXIT_CRITICAL(&captureLock);
+    return payload;
+}
+
+static void record(uint8_t kind, uint8_t stream, const void* data, size_t length, bool coalesce = false) {
+    uint8_t* payload = claim(kind, stream, length, coalesce);
+    if (payload && length) memcpy(payload, data, length);
+}
+
+// Panel writes: commands in full, frame data as length and CRC only
+static void traceSpi(UBYTE kind, UBYTE cs, const UBYTE* pData, UDOUBLE rowLen, UDOUBLE stride, UDOUBLE rows) {
+    if (kind == EPD_TRACE_BYTE) {
+        record(CAPTURE_SPI_BYTE, 0, pData, 1);
+    } else if (kind == EPD_TRACE_COMMAND) {
+        record(CAPTURE_SPI_COMMAND, cs, pData, rowLen);
+    } else {
+        uint32_t crc = 0;
+        for (UDOUBLE r = 0; r < rows; r++) {
+            crc = esp_rom_crc32_le(crc, pData + r * stride, rowLen);
+        }
+        uint8_t summary[8];
+        put32(summary, rowLen * rows);
+        put32(summary + 4, crc);
+        record(CAPTURE_SPI_DATA, 0, summary, sizeof(summary));
+    }
+}
+
+bool captureBegin() {
+    buffer = (uint8_t*)heap_caps_malloc(CAPTURE_BUFFER_SIZE, MALLOC_CAP_SPIRAM);
+    if (!buffer) {
+        LOG_E("Capture: cannot allocate %u bytes", (unsigned)CAPTURE_BUFFER_SIZE);
+        return false;
+    }
+    startUs = esp_timer_get_time();
+    recording = true;
+    DEV_SPI_SetTracer(traceSpi);
+    LOG_I("Capture: recording this wake");
+    return true;
+}
+
+void captureMark(const char* name, uint32_t ms) {
+    size_t nameLength = strlen(name);
+    uint8_t* payload = claim(CAPTURE_MARK, 0, 4 + nameLength, false);
+    if (!payload) return;
+    put32(payload, ms);
+    memcpy(payload + 4, name, nameLength);
+}
+
+const uint8_t* captureFinish(size_t* length) {
+    if (!recording) return nullptr;
+    DEV_SPI_SetTracer(nullptr);
+    portENTER_CRITICAL(&captureLock);
+    recording = false;
+    portEXIT_CRITICAL(&captureLock);
+
+    put32(buffer, CAPTURE_MAGIC);
+    put32(buffer + 4, used - CAPTURE_HEADER_SIZE);
+    put32(buffer + 8, dropped);
+    put32(buffer + 12, 0);
+    *length = used;
+    if (dropped) LOG_W("Capture: buffer full, %u records dropped", (unsigned)dropped);
+    LOG_I("Capture: %u bytes", (unsigned)used);
+    return buffer;
+}
+
+void CaptureClient::opened(const char* host, uint16_t port) {
+    if (!recording) return;
+    stream = nextStream++;
+    char name[72];
+    snprintf(name, sizeof(name), "%s:%u", host, (unsigned)port);
+    record(CAPTURE_CONNECT, stream, name, strnlen(name, sizeof(name)));
+}
+
+int CaptureClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip, port, 0);
+}
+
+int CaptureClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+    int ok = timeout ? transport.connect(ip, port, timeout) : transport.connect(ip, port);
+    if (ok) opened(ip.toString().c_str(), port);
+    return ok;
+}
+
+int CaptureClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, 0);
+}
+
+int CaptureClient::connect(const char* host, uint16_t port, int32_t timeout) {
+    int ok = timeout ? transport.connect(host, port, timeout) : transport.connect(host, port);
+    if (ok) opened(host, port);
+    return ok;
+}
+
+size_t CaptureClient::write(uint8_t data) {
+    return write(&data, 1);
+}
+
+size_t CaptureClient::write(const uint8_t* buf, size_t size) {
+    size_t sent = transport.write(buf, size);
+    if (sent) record(CAPTURE_SEND, stream, buf, sent, true);
+    return sent;
+}
+
+int CaptureClient::available() {
+    return transport.available();
+}
+
+int CaptureClient::read() {
+    uint8_t data;
+    return read(&data, 1) == 1 ? data : -1;
+}
+
+int CaptureClient::read(uint8_t* buf, size_t size) {
+    int got = transport.read(buf, size);
+    if (got > 0) record(CAPTURE_RECEIVE, stream, buf, got, true);
+    return got;
+}
+
+int CaptureClient::peek() {
+    return transport.peek();
+}
+
+void CaptureClient::flush() {
+    transport.flush();
+}
+
+// A shared TLS connection can stay open through stop(); its stream goes on
+void CaptureClient::stop() {
+    transport.stop();
+    if (stream && !transport.connected()) {
+        record(CAPTURE_CLOSE, stream, nullptr, 0);
+        stream = 0;
+    }
+}
+
+uint8_t CaptureClient::connected() {
+    return transport.connected();
+}
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Wake capture for reproducible benchmarks. A CAPTURE_SESSION=1 build
+// records, with microsecond timestamps, every byte HTTPClient sends and
+// receives through beginApiRequest(), the commands and data written to
+// the panel (DEV_SPI_SetTracer) and the phase timings, into a PSRAM
+// buffer. The capture is posted to /api/capture at the end of the wake.
+// taulu-api/bench/replay.py serves the recorded responses back with the
+// original or accelerated timing, so download and decode changes can be
+// compared on identical network input, and compares the panel data of two
+// captures.
+//
+// Capture builds keep WiFi up until the panel has finished so the whole
+// wake is in the upload; do not use them for power measurements. HTTPS
+// traffic is recorded as plaintext HTTP.
+//
+// Layout (little-endian):
+//   header:     'TCP1', u32 record bytes, u32 records dropped, u32 reserved
+//   per record: u8 kind, u8 stream, u16 reserved, u32 time (us since
+//               captureBegin), u32 length, payload padded to 4 bytes
+//
+//   CAPTURE_CONNECT      stream = connection, payload "host:port"
+//   CAPTURE_SEND         bytes written to the connection
+//   CAPTURE_RECEIVE      bytes read from it
+//   CAPTURE_CLOSE        no payload
+//   CAPTURE_SPI_BYTE     one byte written outside a command
+//   CAPTURE_SPI_COMMAND  stream = chip selects, payload command and parameters
+//   CAPTURE_SPI_DATA     payload u32 byte count, u32 CRC-32 of the bytes
+//   CAPTURE_MARK         payload u32 duration in ms, then the phase name
+
+#ifndef CAPTURE_SESSION
+#define CAPTURE_SESSION 0
+#endif
+
+#define CAPTURE_MAGIC 0x31504354 // "TCP1"
+#define CAPTURE_BUFFER_SIZE (4 * 1024 * 1024) // a wake with an RGB stream needs more than a packed one
+#define CAPTURE_COALESCE_US 1000 // back-to-back reads or writes within this are one record
+
+#define CAPTURE_CONNECT     1
+#define CAPTURE_SEND        2
+#define CAPTURE_RECEIVE     3
+#define CAPTURE_CLOSE       4
+#define CAPTURE_SPI_BYTE    5
+#define CAPTURE_SPI_COMMAND 6
+#define CAPTURE_SPI_DATA    7
+#define CAPTURE_MARK        8
+
+// Start recording: allocates the buffer and installs the SPI tracer.
+bool captureBegin();
+
+// Note the end of a wake phase that took `ms`.
+void captureMark(const char* name, uint32_t ms);
+
+// Stop recording and return the finished capture; nullptr if nothing was
+// recorded. Connections opened afterwards pass through unrecorded.
+const uint8_t* captureFinish(size_t* length);
+
+// HTTPClient transport that records the traffic of the transport it wraps.
+// Not thread-safe per instance, like the transports themselves.
+class CaptureClient : public WiFiClient {
+public:
+    explicit CaptureClient(WiFiClient& transport) : transport(transport), stream(0) {}
+
+    int connect(IPAddress ip, uint16_t port);
+    int connect(IPAddress ip, uint16_t port, int32_t timeout);
+    int connect(const char* host, uint16_t port);
+    int connect(const char* host, uint16_t port, int32_t timeout);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    int read(uint8_t* buf, size_t size);
+    int peek();
+    void flush();
+    void stop();
+    uint8_t connected();
+    operator bool() { return connected(); }
+
+private:
+    void opened(const char* host, uint16_t port);
+
+    WiFiClient& transport;
+    uint8_t stream;
+};
@@ -0,0 +1,251 @@
+#include "DisplayList.h"
+#include "Log.h"
+#include "EPD_13in3e.h"
+#include "GUI_Paint.h"
+#include "fonts.h"
+
+typedef EPD_13IN3E_Panel DisplayListPanel;
+
+static sFONT* const displayListFonts[DL_FONT_COUNT] = { &Font8, &Font12, &Font16, &Font20, &Font24 };
+
+// 16x16, one bit per pixel, MSB first
+static const uint8_t displayListIcons[DL_ICON_COUNT][32] = {
+    { // sun
+        0x01, 0x00, 0x11, 0x10, 0x09, 0x20, 0x07, 0xC0,
+        0x0F, 0xE0, 0x5F, 0xF4, 0x1F, 0xF0, 0xF7, 0xDE,
+        0x1F, 0xF0, 0x5F, 0xF4, 0x0F, 0xE0, 0x07, 0xC0,
+        0x09, 0x20, 0x11, 0x10, 0x01, 0x00, 0x00, 0x00,
+    },
+    { // cloud
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xC0,
+        0x0F, 0xF0, 0x1F, 0xF8, 0x3F, 0xFC, 0x7F, 0xFC,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F, 0xFE,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    },
+    { // rain
+        0x03, 0xC0, 0x0F, 0xF0, 0x1F, 0xF8, 0x3F, 0xFC,
+        0x7F, 0xFE, 0xFF, 0xFF, 0x7F, 0xFE, 0x00, 0x00,
+        0x22, 0x22, 0x44, 0x44, 0x00, 0x00, 0x11, 0x10,
+        0x22, 0x20, 0x00, 0x00, 0x44, 0x44, 0x88, 0x88,
+    },
+    { // snow
+        0x01, 0x00, 0x05, 0x40, 0x03, 0x80, 0x41, 0x04,
+        0x21, 0x08, 0x11, 0x10, 0x09, 0x20, 0xFE, 0xFE,
+        0x09, 0x20, 0x11, 0x10, 0x21, 0x08, 0x41, 0x04,
+        0x03, 0x80, 0x05, 0x40, 0x01, 0x00, 0x00, 0x00,
+    },
+    { // battery-low
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xFF, 0xF8, 0x80, 0x08, 0xB8, 0x0E, 0xB8, 0x0A,
+        0xB8, 0x0A, 0xB8, 0x0E, 0x80, 0x08, 0xFF, 0xF8,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    },
+};
+
+// Bounds-checked little-endian reader over the list
+struct DisplayListReader {
+    const uint8_t* data;
+    size_t length;
+    size_t pos;
+    bool ok;
+
+    uint8_t u8() {
+        if (pos + 1 > length) { ok = false; return 0; }
+        return data[pos++];
+    }
+    uint16_t u16() {
+        if (pos + 2 > length) { ok = false; return 0; }
+        uint16_t v = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+        return v;
+    }
+    const uint8_t* bytes(size_t n) {
+        if (pos + n > length) { ok = false; return nullptr; }
+        const uint8_t* p = data + pos;
+        pos += n;
+        return p;
+    }
+};
+
+static UWORD clampX(UWORD x) { return x < DisplayListPanel::Width ? x : DisplayListPanel::Width - 1; }
+static UWORD clampY(UWORD y) { return y < DisplayListPanel::Height ? y : DisplayListPanel::Height - 1; }
+
+static DOT_PIXEL lineWidth(uint8_t width) {
+    if (width < DOT_PIXEL_1X1) return DOT_PIXEL_1X1;
+    if (width > DOT_PIXEL_8X8) return DOT_PIXEL_8X8;
+    return (DOT_PIXEL)width;
+}
+
+// A `scale` x `scale` block, clipped to the panel
+static void fillBlock(int x, int y, uint8_t scale, uint8_t color) {
+    for (int dy = 0; dy < scale; dy++) {
+        if (y + dy < 0 || y + dy >= (int)DisplayListPanel::Height) continue;
+        for (int dx = 0; dx < scale; dx++) {
+            if (x + dx < 0 || x + dx >= (int)DisplayListPanel::Width) continue;
+            Paint_SetPixel(x + dx, y + dy, color);
+        }
+    }
+}
+
+// 1bpp MSB-first bitmap, `rowBytes` per row, scaled up by `scale`
+static void drawBitmap(const uint8_t* bits, UWORD width, UWORD height, UWORD rowBytes,
+                       int x, int y, uint8_t scale, uint8_t fg, uint8_t bg) {
+    for (UWORD row = 0; row < height; row++) {
+        const uint8_t* line = bits + row * rowBytes;
+        for (UWORD col = 0; col < width; col++) {
+            bool set = line[col / 8] & (0x80 >> (col % 8));
+            if (set) {
+                fillBlock(x + col * scale, y + row * scale, scale, fg);
+            } else if (bg != DL_TRANSPARENT) {
+                fillBlock(x + col * scale, y + row * scale, scale, bg);
+            }
+        }
+    }
+}
+
+static void drawText(UWORD x, UWORD y, uint8_t fontId, uint8_t fg, uint8_t bg, uint8_t scale,
+                     const char* text, uint8_t length) {
+    sFONT* font = displayListFonts[fontId];
+    const UWORD rowBytes = (font->Width + 7) / 8;
+    const UDOUBLE glyphBytes = (UDOUBLE)rowBytes * font->Height;
+    int cx = x;
+    int cy = y;
+    for (uint8_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c == '\n') {
+            cx = x;
+            cy += font->Height * scale;
+            continue;
+        }
+        if (c < ' ' || c > '~') c = '?';
+        drawBitmap(font->table + (c - ' ') * glyphBytes, font->Width, font->Height, rowBytes,
+                   cx, cy, scale, fg, bg);
+        cx += font->Width * scale;
+    }
+}
+
+static void drawImage(UWORD x, UWORD y, UWORD w, UWORD h, const uint8_t* pixels, uint8_t* frame) {
+    const UWORD stride = (w + 1) / 2;
+    for (UWORD row = 0; row < h && y + row < DisplayListPanel::Height; row++) {
+        const uint8_t* src = pixels + (UDOUBLE)row * stride;
+        if (x % 2 == 0 && x + w <= DisplayListPanel::Width && w % 2 == 0) {
+            // Byte aligned: copy the packed row as is
+            memcpy(frame + (UDOUBLE)(y + row) * DisplayListPanel::RowBytes + x / 2, src, stride);
+            continue;
+        }
+        for (UWORD col = 0; col < w && x + col < DisplayListPanel::Width; col++) {
+            uint8_t color = (col % 2 == 0) ? (src[col / 2] >> 4) : (src[col / 2] & 0x0F);
+            Paint_SetPixel(x + col, y + row, color);
+        }
+    }
+}
+
+bool displayListRender(const uint8_t* list, size_t length, uint8_t* frame) {
+    DisplayListReader in = { list, length, 0, true };
+
+    uint32_t magic = in.u16() | ((uint32_t)in.u16() << 16);
+    UWORD width = in.u16();
+    UWORD height = in.u16();
+    uint8_t background = in.u8();
+    in.u8();
+    in.u16();
+    if (!in.ok || magic != DISPLAY_LIST_MAGIC) {
+        LOG_E("Display list: bad header");
+        return false;
+    }
+    if (width != DisplayListPanel::Width || height != DisplayListPanel::Height) {
+        LOG_W("Display list: made for %ux%u", width, height);
+        return false;
+    }
+
+    Paint_NewImage(frame, DisplayListPanel::Width, DisplayListPanel::Height, ROTATE_0, background);
+    Paint_SetScale(6);
+    Paint_Clear(background);
+
+    int ops = 0;
+    for (;;) {
+        uint8_t op = in.u8();
+        if (!in.ok) break;
+        if (op == DL_OP_END) {
+            LOG_I("Display list: %d ops rendered", ops);
+            return true;
+        }
+
+        switch (op) {
+        case DL_OP_RECT:
+        case DL_OP_LINE: {
+            UWORD x0 = clampX(in.u16()), y0 = clampY(in.u16());
+            UWORD x1 = clampX(in.u16()), y1 = clampY(in.u16());
+            uint8_t color = in.u8();
+            uint8_t a = in.u8();
+            uint8_t b = in.u8();
+            if (!in.ok) break;
+            if (op == DL_OP_RECT) {
+                Paint_DrawRectangle(x0, y0, x1, y1, color, lineWidth(b), a ? DRAW_FILL_FULL : DRAW_FILL_EMPTY);
+            } else {
+                Paint_DrawLine(x0, y0, x1, y1, color, lineWidth(a), b ? LINE_STYLE_DOTTED : LINE_STYLE_SOLID);
+            }
+            break;
+        }
+        case DL_OP_CIRCLE: {
+            UWORD x = in.u16(), y = in.u16(), radius = in.u16();
+            uint8_t color = in.u8();
+            uint8_t fill = in.u8();
+            uint8_t width = in.u8();
+            if (!in.ok) break;
+            // GUI_Paint does not clip circles
+            if (x < radius || y < radius || x + radius >= DisplayListPanel::Width ||
+                y + radius >= DisplayListPanel::Height) {
+                break;
+            }
+            Paint_DrawCircle(x, y, radius, color, lineWidth(width), fill ? DRAW_FILL_FULL : DRAW_FILL_EMPTY);
+            break;
+        }
+        case DL_OP_TEXT: {
+            UWORD x = in.u16(), y = in.u16();
+            uint8_t font = in.u8();
+            uint8_t fg = in.u8();
+            uint8_t bg = in.u8();
+            uint8_t scale = in.u8();
+            uint8_t textLength = in.u8();
+            const uint8_t* text = in.bytes(textLength);
+            if (!in.ok) break;
+            if (font >= DL_FONT_COUNT || scale == 0) {
+                in.ok = false;
+                break;
+            }
+            drawText(x, y, font, fg, bg, scale, (const char*)text, textLength);
+            break;
+        }
+        case DL_OP_ICON: {
+            UWORD x = in.u16(), y = in.u16();
+            uint8_t icon = in.u8();
+            uint8_t color = in.u8();
+            uint8_t scale = in.u8();
+            if (!in.ok) break;
+            if (icon >= DL_ICON_COUNT || scale == 0) {
+                in.ok = false;
+                break;
+            }
+            drawBitmap(displayListIcons[icon], 16, 16, 2, x, y, scale, color, DL_TRANSPARENT);
+            break;
+        }
+        case DL_OP_IMAGE: {
+            UWORD x = in.u16(), y = in.u16(), w = in.u16(), h = in.u16();
+            const uint8_t* pixels = in.bytes((size_t)((w + 1) / 2) * h);
+            if (!in.ok) break;
+            drawImage(x, y, w, h, pixels, frame);
+            break;
+        }
+        default:
+            LOG_W("Display list: unknown op %u", op);
+            in.ok = false;
+            break;
+        }
+        if (!in.ok) break;
+        ops++;
+    }
+
+    LOG_E("Display list: truncated or malformed after %d ops", ops);
+    return false;
+}
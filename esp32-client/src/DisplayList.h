@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Compact display lists for text and graphics screens (calendar, weather,
+// captions). The server sends a few KB of drawing operations instead of a
+// 960 KB bitmap, and GUI_Paint rasterises them into a frame buffer here.
+// Encoder: taulu-api/displaylist.py.
+//
+// Wire format (little-endian):
+//   header: 'TDL1', u16 width, u16 height, u8 background, u8 reserved, u16 reserved
+//   then opcodes until DL_OP_END:
+//     DL_OP_RECT    u16 x0, y0, x1, y1, u8 color, u8 fill, u8 lineWidth
+//     DL_OP_LINE    u16 x0, y0, x1, y1, u8 color, u8 lineWidth, u8 dotted
+//     DL_OP_CIRCLE  u16 x, y, radius, u8 color, u8 fill, u8 lineWidth
+//     DL_OP_TEXT    u16 x, y, u8 font, u8 fg, u8 bg, u8 scale, u8 length, char[length]
+//     DL_OP_ICON    u16 x, y, u8 icon, u8 color, u8 scale
+//     DL_OP_IMAGE   u16 x, y, w, h, then ceil(w / 2) * h bytes of packed 4bpp pixels
+// Colors are panel color indexes; a text background of DL_TRANSPARENT is
+// left undrawn.
+
+#define DISPLAY_LIST_MAGIC 0x314C4454 // "TDL1"
+#define DISPLAY_LIST_MAX_SIZE (64 * 1024)
+
+#define DL_OP_END    0x00
+#define DL_OP_RECT   0x01
+#define DL_OP_LINE   0x02
+#define DL_OP_CIRCLE 0x03
+#define DL_OP_TEXT   0x04
+#define DL_OP_ICON   0x05
+#define DL_OP_IMAGE  0x06
+
+#define DL_TRANSPARENT 0xFF
+
+// Fonts by id: Font8, Font12, Font16, Font20, Font24
+#define DL_FONT_COUNT 5
+
+// Built-in 16x16 icons by id
+#define DL_ICON_SUN         0
+#define DL_ICON_CLOUD       1
+#define DL_ICON_RAIN        2
+#define DL_ICON_SNOW        3
+#define DL_ICON_BATTERY_LOW 4
+#define DL_ICON_COUNT       5
+
+// Rasterise `list` into `frame` (a full packed 4bpp panel frame). Returns
+// false if the list is malformed or made for a different panel size; the
+// frame contents are undefined in that case.
+bool displayListRender(const uint8_t* list, size_t length, uint8_t* frame);
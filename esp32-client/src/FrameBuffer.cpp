@@ -0,0 +1,66 @@
+#include "FrameBuffer.h"
+#include "Log.h"
+#include "esp_heap_caps.h"
+
+FrameBuffer::FrameBuffer(FrameBuffer&& other)
+    : writable(other.writable), mapping(other.mapping), placement(other.placement) {
+    other.writable = nullptr;
+    other.mapping = FrameMapping();
+    other.placement = None;
+}
+
+FrameBuffer& FrameBuffer::operator=(FrameBuffer&& other) {
+    if (this != &other) {
+        release();
+        writable = other.writable;
+        mapping = other.mapping;
+        placement = other.placement;
+        other.writable = nullptr;
+        other.mapping = FrameMapping();
+        other.placement = None;
+    }
+    return *this;
+}
+
+static uint8_t* heapFrame(uint32_t caps, bool zero) {
+    void* p = zero ? heap_caps_calloc(1, FrameBuffer::Size, caps) : heap_caps_malloc(FrameBuffer::Size, caps);
+    return (uint8_t*)p;
+}
+
+bool FrameBuffer::allocate(Placement where, bool zero) {
+    release();
+    if (where == Psram) {
+        writable = heapFrame(MALLOC_CAP_SPIRAM, zero);
+        if (writable) {
+            placement = Psram;
+            return true;
+        }
+        LOG_W("Frame buffer: no PSRAM, trying internal RAM");
+    } else if (where != Internal) {
+        return false;
+    }
+    writable = heapFrame(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, zero);
+    if (!writable) {
+        LOG_E("Frame buffer: cannot allocate %u bytes", (unsigned)Size);
+        return false;
+    }
+    placement = Internal;
+    return true;
+}
+
+bool FrameBuffer::map(int slot) {
+    release();
+    if (!frameStoreMap(slot, &mapping)) return false;
+    placement = Flash;
+    return true;
+}
+
+void FrameBuffer::release() {
+    if (placement == Flash) {
+        frameStoreUnmap(&mapping);
+    } else if (placement != None) {
+        heap_caps_free(writable); // both heaps are returned through heap_caps
+    }
+    writable = nullptr;
+    placement = None;
+}
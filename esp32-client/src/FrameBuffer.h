@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+#include <utility>
+#include "FrameStore.h"
+
+// One packed panel frame (FRAME_STORE_FRAME_SIZE bytes) that knows where it
+// lives and releases itself the same way when it goes out of scope.
+//
+// - Psram:    heap_caps PSRAM; allocate() falls back to internal RAM
+// - Internal: internal heap, only for panels small enough to fit
+// - Flash:    a read-only mapping of a frame store slot (data() is null)
+//
+// Memory is not cleared unless asked for: most producers write every byte.
+
+class FrameBuffer {
+public:
+    enum Placement { None, Psram, Internal, Flash };
+
+    static const size_t Size = FRAME_STORE_FRAME_SIZE;
+
+    FrameBuffer() {}
+    ~FrameBuffer() { release(); }
+    FrameBuffer(FrameBuffer&& other);
+    FrameBuffer& operator=(FrameBuffer&& other);
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    // Writable frame in `where` (Psram or Internal); `zero` clears it
+    bool allocate(Placement where = Psram, bool zero = false);
+
+    // Read-only frame straight from frame store `slot`; fails on a CRC mismatch
+    bool map(int slot);
+
+    void release();
+
+    uint8_t* data() { return writable; }
+    const uint8_t* frame() const { return placement == Flash ? mapping.data : writable; }
+    Placement where() const { return placement; }
+    explicit operator bool() const { return placement != None; }
+
+private:
+    uint8_t* writable = nullptr;
+    FrameMapping mapping;
+    Placement placement = None;
+};
@@ -0,0 +1,122 @@
+#include "FrameStore.h"
+#include "Log.h"
+#include "esp_rom_crc.h"
+#include "esp_task_wdt.h"
+
+#define FRAME_STORE_MAGIC 0x54465231 // "TFR1"
+
+// Written to the first sector of a slot only after the frame data is in
+// place, so an interrupted save leaves an erased (invalid) header behind.
+struct FrameSlotHeader {
+    uint32_t magic;
+    uint32_t length;
+    uint32_t crc;
+    uint32_t displayAt;
+    char imageId[65];
+};
+
+static const esp_partition_t* framePartition = nullptr;
+
+bool frameStoreBegin() {
+    if (framePartition) return true;
+    framePartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                              (esp_partition_subtype_t)0x40, "frames");
+    if (!framePartition) {
+        LOG_W("Frame store: no 'frames' partition");
+        return false;
+    }
+    return true;
+}
+
+int frameStoreSlotCount() {
+    if (!frameStoreBegin()) return 0;
+    return framePartition->size / FRAME_STORE_SLOT_SIZE;
+}
+
+static bool readHeader(int slot, FrameSlotHeader* header) {
+    if (slot < 0 || slot >= frameStoreSlotCount()) return false;
+    if (esp_partition_read(framePartition, slot * FRAME_STORE_SLOT_SIZE, header, sizeof(*header)) != ESP_OK) {
+        return false;
+    }
+    return header->magic == FRAME_STORE_MAGIC && header->length == FRAME_STORE_FRAME_SIZE;
+}
+
+bool frameStoreSave(int slot, const char* imageId, const uint8_t* frame, uint32_t displayAt) {
+    if (slot < 0 || slot >= frameStoreSlotCount()) return false;
+    const size_t base = slot * FRAME_STORE_SLOT_SIZE;
+
+    if (esp_partition_erase_range(framePartition, base, FRAME_STORE_SLOT_SIZE) != ESP_OK) {
+        LOG_E("Frame store: erase failed");
+        return false;
+    }
+    esp_task_wdt_reset();
+
+    const size_t WRITE_CHUNK = 64 * 1024;
+    for (size_t off = 0; off < FRAME_STORE_FRAME_SIZE; off += WRITE_CHUNK) {
+        size_t n = min(WRITE_CHUNK, (size_t)FRAME_STORE_FRAME_SIZE - off);
+        if (esp_partition_write(framePartition, base + FRAME_STORE_HEADER_SIZE + off, frame + off, n) != ESP_OK) {
+            LOG_E("Frame store: write failed");
+            return false;
+        }
+        esp_task_wdt_reset();
+    }
+
+    FrameSlotHeader header = {};
+    header.magic = FRAME_STORE_MAGIC;
+    header.length = FRAME_STORE_FRAME_SIZE;
+    header.crc = esp_rom_crc32_le(0, frame, FRAME_STORE_FRAME_SIZE);
+    header.displayAt = displayAt;
+    strncpy(header.imageId, imageId ? imageId : "", sizeof(header.imageId) - 1);
+    if (esp_partition_write(framePartition, base, &header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    LOG_I("Frame store: saved slot %d (%s)", slot, header.imageId);
+    return true;
+}
+
+bool frameStoreInfo(int slot, FrameInfo* info) {
+    FrameSlotHeader header;
+    if (!readHeader(slot, &header)) return false;
+    memcpy(info->imageId, header.imageId, sizeof(info->imageId));
+    info->imageId[sizeof(info->imageId) - 1] = '\0';
+    info->displayAt = header.displayAt;
+    return true;
+}
+
+void frameStoreErase(int slot) {
+    if (slot < 0 || slot >= frameStoreSlotCount()) return;
+    // Invalidating the header sector is enough; data is erased on next save
+    esp_partition_erase_range(framePartition, slot * FRAME_STORE_SLOT_SIZE, FRAME_STORE_HEADER_SIZE);
+}
+
+// Maps a stored frame into the data address space. The returned pointer is
+// read through the flash cache and stays valid until frameStoreUnmap().
+const uint8_t* frameStoreMap(int slot, FrameMapping* mapping) {
+    FrameSlotHeader header;
+    if (!readHeader(slot, &header)) return nullptr;
+
+    const void* ptr = nullptr;
+    if (esp_partition_mmap(framePartition, slot * FRAME_STORE_SLOT_SIZE + FRAME_STORE_HEADER_SIZE,
+                           FRAME_STORE_FRAME_SIZE, SPI_FLASH_MMAP_DATA, &ptr, &mapping->handle) != ESP_OK) {
+        LOG_E("Frame store: mmap failed");
+        return nullptr;
+    }
+
+    const uint8_t* data = (const uint8_t*)ptr;
+    if (esp_rom_crc32_le(0, data, FRAME_STORE_FRAME_SIZE) != header.crc) {
+        LOG_E("Frame store: CRC mismatch in slot %d", slot);
+        spi_flash_munmap(mapping->handle);
+        mapping->handle = 0;
+        return nullptr;
+    }
+    mapping->data = data;
+    return data;
+}
+
+void frameStoreUnmap(FrameMapping* mapping) {
+    if (mapping->data) {
+        spi_flash_munmap(mapping->handle);
+        mapping->data = nullptr;
+        mapping->handle = 0;
+    }
+}
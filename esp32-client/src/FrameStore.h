@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include "esp_partition.h"
+#include "EPD_13in3e.h"
+
+// Raw flash frame store on the "frames" data partition (see partitions.csv).
+// Each slot holds one packed 4-bit frame exactly as it is sent to the panel,
+// so a stored frame can be memory-mapped and handed to EPD_13IN3E_Display
+// without touching PSRAM.
+
+#define FRAME_STORE_FRAME_SIZE  EPD_13IN3E_Panel::FrameBytes
+#define FRAME_STORE_SLOT_SIZE   0xF0000  // header sector + frame, 64 KB aligned
+#define FRAME_STORE_HEADER_SIZE 0x1000
+
+#define FRAME_SLOT_LAST 0 // Last frame rendered on the panel
+
+struct FrameInfo {
+    char imageId[65];
+    uint32_t displayAt; // Unix time the frame is scheduled for, 0 = unscheduled
+};
+
+struct FrameMapping {
+    const uint8_t* data = nullptr;
+    spi_flash_mmap_handle_t handle = 0;
+};
+
+bool frameStoreBegin();
+int frameStoreSlotCount();
+bool frameStoreSave(int slot, const char* imageId, const uint8_t* frame, uint32_t displayAt = 0);
+bool frameStoreInfo(int slot, FrameInfo* info);
+void frameStoreErase(int slot);
+const uint8_t* frameStoreMap(int slot, FrameMapping* mapping);
+void frameStoreUnmap(FrameMapping* mapping);
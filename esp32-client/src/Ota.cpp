@@ -0,0 +1,472 @@
+#include "Ota.h"
+#include "Log.h"
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "esp_task_wdt.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/pk.h"
+#if CONFIG_IDF_TARGET_ESP32S3
+#include "esp32s3/rom/miniz.h"
+#else
+#include "esp32/rom/miniz.h"
+#endif
+
+#define OTA_PARTITION_SUBTYPE 0x41
+#define OTA_CHUNK 4096 // one flash sector, so each downloaded chunk erases exactly one
+#define OTA_SIGNATURE_MAX 512 // RSA-4096; an ECDSA P-256 signature is at most 72
+#define OTA_TRIAL_BOOTS 3 // resets a new image gets to reach the server before it is rolled back
+
+struct OtaPatchHeader {
+    uint32_t magic;
+    uint32_t targetSize;
+    uint32_t sourceSize;
+    uint32_t reserved;
+    uint8_t targetSha[32];
+    uint8_t sourceSha[32];
+} __attribute__((packed));
+
+// Download state, kept in NVS so a patch is fetched across several wakes:
+//   id     sha256 of the patch (hex), as announced by the server
+//   to     version the patch produces
+//   size   patch length
+//   got    bytes stored so far
+//   sig    signature of the target image (hex), as announced by the server
+//   ready  complete and verified, waiting for otaApply()
+//   failed id of a patch that did not apply, did not fit or was rolled
+//          back; it is not fetched again
+// and, from an install until the new image confirms itself:
+//   trial  id of the installed patch
+//   prev   label of the slot it replaced
+//   boots  resets (not deep sleep wakes) of the new image so far
+static const char* OTA_PREFS = "ota";
+
+static const char* signingKeyPem = nullptr;
+
+static const esp_partition_t* patchPartition() {
+    return esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                    (esp_partition_subtype_t)OTA_PARTITION_SUBTYPE, "otapatch");
+}
+
+static bool readFully(Stream* stream, uint8_t* buffer, size_t length) {
+    size_t got = 0;
+    while (got < length) {
+        size_t n = stream->readBytes(buffer + got, length - got);
+        if (n == 0) return false;
+        got += n;
+    }
+    return true;
+}
+
+static bool hashPartition(const esp_partition_t* partition, uint32_t length, uint8_t digest[32], uint8_t* buffer) {
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    bool ok = true;
+    for (uint32_t offset = 0; offset < length; offset += OTA_CHUNK) {
+        size_t n = min((uint32_t)OTA_CHUNK, length - offset);
+        if (esp_partition_read(partition, offset, buffer, n) != ESP_OK) {
+            ok = false;
+            break;
+        }
+        mbedtls_sha256_update_ret(&sha, buffer, n);
+        esp_task_wdt_reset();
+    }
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    return ok;
+}
+
+static bool digestMatchesHex(const uint8_t digest[32], const String& hex) {
+    if (hex.length() != 64) return false;
+    char expected[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(expected + i * 2, 3, "%02x", digest[i]);
+    }
+    return hex.equalsIgnoreCase(expected);
+}
+
+void otaSetSigningKey(const char* pem) {
+    signingKeyPem = pem;
+}
+
+// Whether `hex` is a signature of the target image digest by the signing
+// key; anything goes when no key is set
+static bool signatureValid(const uint8_t targetSha[32], const String& hex) {
+    if (!signingKeyPem) return true;
+    uint8_t signature[OTA_SIGNATURE_MAX];
+    size_t length = hex.length() / 2;
+    if (length == 0 || length > sizeof(signature) || hex.length() % 2) return false;
+    for (size_t i = 0; i < length; i++) {
+        char digits[3] = { hex[i * 2], hex[i * 2 + 1], '\0' };
+        char* end;
+        signature[i] = (uint8_t)strtoul(digits, &end, 16);
+        if (*end != '\0') return false;
+    }
+
+    mbedtls_pk_context key;
+    mbedtls_pk_init(&key);
+    bool ok = mbedtls_pk_parse_public_key(&key, (const unsigned char*)signingKeyPem, strlen(signingKeyPem) + 1) == 0 &&
+              mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, targetSha, 32, signature, length) == 0;
+    mbedtls_pk_free(&key);
+    return ok;
+}
+
+bool otaDownload(const char* firmwareVersion, const String& apiBase, OtaBeginRequest begin, size_t budget) {
+    const esp_partition_t* partition = patchPartition();
+    if (!partition || !esp_ota_get_next_update_partition(NULL)) return false; // old partition table
+
+    Preferences prefs;
+    prefs.begin(OTA_PREFS, false);
+    if (prefs.getBool("ready", false)) {
+        prefs.end();
+        return true;
+    }
+
+    // What does the server have for us?
+    HTTPClient http;
+    http.useHTTP10(true);
+    begin(http, apiBase + "ota.json?from=" + firmwareVersion);
+    http.setTimeout(10000);
+    int httpCode = http.GET();
+    StaticJsonDocument<1536> manifest;
+    if (httpCode != HTTP_CODE_OK || deserializeJson(manifest, http.getStream())) {
+        http.end();
+        prefs.end();
+        return false;
+    }
+    http.end();
+
+    String id = manifest["patchId"] | "";
+    String to = manifest["version"] | "";
+    String signature = manifest["signature"] | "";
+    uint32_t size = manifest["size"] | 0;
+    const char* usbUpdate = manifest["usbUpdateNeeded"] | "";
+    if (usbUpdate[0]) {
+        LOG_W("OTA: the patch to %s does not fit, it needs a USB update", usbUpdate);
+    }
+    if (id.length() == 0 || to == firmwareVersion) {
+        // Up to date; forget any half-fetched patch
+        if (prefs.isKey("id")) prefs.clear();
+        prefs.end();
+        return false;
+    }
+    if (id == prefs.getString("failed")) {
+        prefs.end();
+        return false;
+    }
+    if (signingKeyPem && signature.length() == 0) {
+        LOG_W("OTA: update to %s is not signed, ignoring it", to.c_str());
+        prefs.end();
+        return false;
+    }
+    if (size < sizeof(OtaPatchHeader) || size > partition->size) {
+        LOG_W("OTA: patch to %s is %u bytes, does not fit; needs a USB update", to.c_str(), (unsigned)size);
+        prefs.putString("failed", id);
+        prefs.end();
+        return false;
+    }
+    if (id != prefs.getString("id")) {
+        LOG_I("OTA: update to %s available, patch is %u bytes", to.c_str(), (unsigned)size);
+        prefs.putString("id", id);
+        prefs.putString("to", to);
+        prefs.putString("sig", signature);
+        prefs.putUInt("size", size);
+        prefs.putUInt("got", 0);
+    }
+
+    // Continue from the start of the last sector written; it may be partial
+    uint32_t got = prefs.getUInt("got", 0) & ~(uint32_t)(OTA_CHUNK - 1);
+    uint32_t end = min(size, got + (uint32_t)budget);
+    if (got < end) {
+        begin(http, apiBase + "ota/patch.bin?from=" + firmwareVersion + "&to=" + to);
+        http.setTimeout(30000);
+        http.addHeader("Range", "bytes=" + String(got) + "-" + String(end - 1));
+        httpCode = http.GET();
+        uint8_t* chunk = (uint8_t*)malloc(OTA_CHUNK);
+        if (chunk && (httpCode == HTTP_CODE_PARTIAL_CONTENT || (httpCode == HTTP_CODE_OK && got == 0))) {
+            Stream* stream = http.getStreamPtr();
+            while (got < end) {
+                size_t n = min((uint32_t)OTA_CHUNK, end - got);
+                if (!readFully(stream, chunk, n) ||
+                    esp_partition_erase_range(partition, got, OTA_CHUNK) != ESP_OK ||
+                    esp_partition_write(partition, got, chunk, n) != ESP_OK) {
+                    break;
+                }
+                got += n;
+                esp_task_wdt_reset();
+            }
+            prefs.putUInt("got", got);
+        } else {
+            LOG_W("OTA: patch download failed: %d", httpCode);
+        }
+        free(chunk);
+        http.end();
+    }
+
+    if (got < size) {
+        LOG_I("OTA: %u of %u patch bytes stored", (unsigned)got, (unsigned)size);
+        prefs.end();
+        return false;
+    }
+
+    uint8_t digest[32];
+    uint8_t* buffer = (uint8_t*)malloc(OTA_CHUNK);
+    bool verified = buffer && hashPartition(partition, size, digest, buffer) && digestMatchesHex(digest, id);
+    free(buffer);
+    if (verified) {
+        LOG_I("OTA: patch to %s downloaded and verified", to.c_str());
+        prefs.putBool("ready", true);
+    } else {
+        LOG_W("OTA: patch checksum mismatch, fetching it again");
+        prefs.putUInt("got", 0);
+    }
+    prefs.end();
+    return verified;
+}
+
+// The zlib op stream, inflated from the patch partition through tinfl's
+// 32 KB dictionary
+struct PatchStream {
+    const esp_partition_t* partition;
+    uint32_t inPos;   // next partition offset to read
+    uint32_t inEnd;
+    uint8_t* in;
+    size_t inOff;
+    size_t inLen;
+    tinfl_decompressor* inflator;
+    uint8_t* dict;
+    size_t dictPos;   // where tinfl writes next
+    size_t outOff;    // unread output is dict[outOff, outOff + outLen)
+    size_t outLen;
+    bool finished;
+};
+
+static bool patchRead(PatchStream* ps, uint8_t* dst, size_t n) {
+    while (n > 0) {
+        if (ps->outLen == 0) {
+            if (ps->finished) return false;
+            if (ps->inOff == ps->inLen && ps->inPos < ps->inEnd) {
+                size_t chunk = min((uint32_t)OTA_CHUNK, ps->inEnd - ps->inPos);
+                if (esp_partition_read(ps->partition, ps->inPos, ps->in, chunk) != ESP_OK) return false;
+                ps->inPos += chunk;
+                ps->inOff = 0;
+                ps->inLen = chunk;
+            }
+            size_t inBytes = ps->inLen - ps->inOff;
+            size_t outBytes = TINFL_LZ_DICT_SIZE - ps->dictPos;
+            uint32_t flags = TINFL_FLAG_PARSE_ZLIB_HEADER;
+            if (ps->inPos < ps->inEnd) flags |= TINFL_FLAG_HAS_MORE_INPUT;
+            tinfl_status status = tinfl_decompress(ps->inflator, ps->in + ps->inOff, &inBytes,
+                                                   ps->dict, ps->dict + ps->dictPos, &outBytes, flags);
+            ps->inOff += inBytes;
+            ps->outOff = ps->dictPos;
+            ps->outLen = outBytes;
+            ps->dictPos = (ps->dictPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+            if (status < TINFL_STATUS_DONE) return false;
+            if (status == TINFL_STATUS_DONE) ps->finished = true;
+            continue;
+        }
+        size_t take = min(n, ps->outLen);
+        memcpy(dst, ps->dict + ps->outOff, take);
+        dst += take;
+        n -= take;
+        ps->outOff += take;
+        ps->outLen -= take;
+    }
+    return true;
+}
+
+static bool patchReadU32(PatchStream* ps, uint32_t* value) {
+    return patchRead(ps, (uint8_t*)value, sizeof(*value));
+}
+
+// Rebuild the target image from the running one and the op stream
+static bool applyOps(PatchStream* ps, const OtaPatchHeader& header, const esp_partition_t* running,
+                     esp_ota_handle_t handle, uint8_t* work, uint8_t* source) {
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    uint32_t written = 0;
+    bool ok = false;
+
+    for (;;) {
+        uint8_t op;
+        uint32_t offset = 0, length;
+        if (!patchRead(ps, &op, 1)) break;
+        if (op == OTA_OP_END) {
+            ok = true;
+            break;
+        }
+        if (op == OTA_OP_ADD) {
+            if (!patchReadU32(ps, &offset)) break;
+        } else if (op != OTA_OP_INSERT) {
+            break;
+        }
+        if (!patchReadU32(ps, &length) || length > header.targetSize - written) break;
+        if (op == OTA_OP_ADD && (offset > header.sourceSize || length > header.sourceSize - offset)) break;
+
+        while (length > 0) {
+            size_t n = min((uint32_t)OTA_CHUNK, length);
+            if (!patchRead(ps, work, n)) break;
+            if (op == OTA_OP_ADD) {
+                if (esp_partition_read(running, offset, source, n) != ESP_OK) break;
+                for (size_t i = 0; i < n; i++) work[i] += source[i];
+                offset += n;
+            }
+            if (esp_ota_write(handle, work, n) != ESP_OK) break;
+            mbedtls_sha256_update_ret(&sha, work, n);
+            written += n;
+            length -= n;
+        }
+        if (length > 0) break;
+        esp_task_wdt_reset();
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    if (ok && written == header.targetSize && memcmp(digest, header.targetSha, 32) == 0) return true;
+    LOG_E("OTA: rebuilt image does not match (%u of %u bytes)", (unsigned)written, (unsigned)header.targetSize);
+    return false;
+}
+
+bool otaApply() {
+    Preferences prefs;
+    prefs.begin(OTA_PREFS, false);
+    if (!prefs.getBool("ready", false)) {
+        prefs.end();
+        return false;
+    }
+    // If this is cut short the patch is verified again and reapplied
+    prefs.putBool("ready", false);
+    uint32_t size = prefs.getUInt("size", 0);
+    String to = prefs.getString("to");
+    String id = prefs.getString("id");
+    String signature = prefs.getString("sig");
+
+    const esp_partition_t* partition = patchPartition();
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* target = esp_ota_get_next_update_partition(NULL);
+
+    OtaPatchHeader header;
+    bool ok = partition && running && target &&
+              esp_partition_read(partition, 0, &header, sizeof(header)) == ESP_OK &&
+              header.magic == OTA_PATCH_MAGIC &&
+              header.sourceSize <= running->size && header.targetSize <= target->size;
+
+    PatchStream ps;
+    memset(&ps, 0, sizeof(ps));
+    uint8_t* work = (uint8_t*)malloc(OTA_CHUNK);
+    uint8_t* source = (uint8_t*)malloc(OTA_CHUNK);
+    ps.in = (uint8_t*)malloc(OTA_CHUNK);
+    ps.dict = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+    ps.inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    ok = ok && work && source && ps.in && ps.dict && ps.inflator;
+
+    if (ok) {
+        // The patch only makes sense against the exact image it was made from
+        uint8_t digest[32];
+        ok = hashPartition(running, header.sourceSize, digest, work) &&
+             memcmp(digest, header.sourceSha, 32) == 0;
+        if (!ok) LOG_E("OTA: patch was not made for the running image");
+    }
+
+    if (ok) {
+        // applyOps() checks the rebuilt image against the signed digest
+        ok = signatureValid(header.targetSha, signature);
+        if (!ok) LOG_E("OTA: update to %s is not signed with our key", to.c_str());
+    }
+
+    if (ok) {
+        LOG_I("OTA: applying update to %s", to.c_str());
+        uint32_t start = millis();
+        esp_ota_handle_t handle;
+        ok = esp_ota_begin(target, header.targetSize, &handle) == ESP_OK;
+        if (ok) {
+            ps.partition = partition;
+            ps.inPos = sizeof(header);
+            ps.inEnd = size;
+            tinfl_init(ps.inflator);
+            if (applyOps(&ps, header, running, handle, work, source)) {
+                ok = esp_ota_end(handle) == ESP_OK && esp_ota_set_boot_partition(target) == ESP_OK;
+            } else {
+                esp_ota_abort(handle);
+                ok = false;
+            }
+        }
+        if (ok) {
+            LOG_I("OTA: %s installed in %u ms", to.c_str(), (unsigned)(millis() - start));
+        }
+    }
+
+    free(work);
+    free(source);
+    free(ps.in);
+    free(ps.dict);
+    free(ps.inflator);
+
+    if (ok) {
+        prefs.clear();
+        prefs.putString("trial", id);
+        prefs.putString("prev", running->label);
+    } else {
+        LOG_E("OTA: update to %s failed", to.c_str());
+        prefs.putString("failed", id);
+    }
+    prefs.end();
+    return ok;
+}
+
+void otaCheckBoot() {
+    // Deep sleep wakes don't count, or an image that merely cannot reach the
+    // server for a while would be rolled back
+    if (esp_reset_reason() == ESP_RST_DEEPSLEEP) return;
+
+    Preferences prefs;
+    prefs.begin(OTA_PREFS, false);
+    if (!prefs.isKey("trial")) {
+        prefs.end();
+        return;
+    }
+    String id = prefs.getString("trial");
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* previous = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY,
+                                                               prefs.getString("prev").c_str());
+    if (previous == running) {
+        // The bootloader would not start the new image
+        LOG_E("OTA: installed image did not boot");
+        prefs.clear();
+        prefs.putString("failed", id);
+        prefs.end();
+        return;
+    }
+    uint8_t boots = prefs.getUChar("boots", 0) + 1;
+    prefs.putUChar("boots", boots);
+    if (boots <= OTA_TRIAL_BOOTS || !previous) {
+        prefs.end();
+        return;
+    }
+
+    LOG_E("OTA: new image reset %u times without reaching the server, going back to %s",
+          (unsigned)(boots - 1), previous->label);
+    bool switched = esp_ota_set_boot_partition(previous) == ESP_OK;
+    prefs.clear();
+    prefs.putString("failed", id);
+    prefs.end();
+    if (switched) esp_restart();
+}
+
+void otaConfirmRunning() {
+    esp_ota_mark_app_valid_cancel_rollback();
+    Preferences prefs;
+    prefs.begin(OTA_PREFS, false);
+    if (prefs.isKey("trial")) {
+        prefs.remove("trial");
+        prefs.remove("prev");
+        prefs.remove("boots");
+    }
+    prefs.end();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+
+// Delta firmware updates. The server (taulu-api/ota.py) offers a patch
+// from the running FIRMWARE_VERSION to its latest image. The patch is
+// downloaded a piece per wake into the raw "otapatch" partition, resuming
+// where the last wake stopped. Once complete and its SHA-256 checks out, it
+// is applied into the inactive app slot and the device restarts into it.
+//
+// With a signing key set, an update is only installed if the server passes
+// on a signature of the target image's SHA-256 (made by whoever uploaded
+// it) that verifies against the key.
+//
+// Patch layout (little-endian):
+//   header: 'TOP1', u32 target size, u32 source size, u32 reserved,
+//           sha256(target), sha256(source)
+//   zlib stream of ops:
+//     OTA_OP_ADD     u32 source offset, u32 length, then length bytes added
+//                    (mod 256) to the running image from that offset
+//     OTA_OP_INSERT  u32 length, then length literal bytes
+//     OTA_OP_END
+
+#define OTA_PATCH_MAGIC 0x31504F54 // "TOP1"
+#define OTA_OP_END    0x00
+#define OTA_OP_ADD    0x01
+#define OTA_OP_INSERT 0x02
+
+// Set up the request for a server URL (http or https); the caller's
+// transport choice is kept this way.
+typedef bool (*OtaBeginRequest)(HTTPClient& http, const String& url);
+
+// PEM public key (EC or RSA) updates must be signed with; call before
+// otaDownload(). Without one, any update the server offers is installed.
+void otaSetSigningKey(const char* pem);
+
+// Check for an update and download up to `budget` bytes of its patch.
+// Needs WiFi. Returns true once a complete, verified patch is waiting.
+bool otaDownload(const char* firmwareVersion, const String& apiBase, OtaBeginRequest begin, size_t budget);
+
+// Apply a waiting patch into the inactive slot and make it the boot slot.
+// Needs no network; takes a few seconds of flash writes. After it returns
+// true, restart (esp_restart()) instead of deep sleeping: a reset makes the
+// new image initialize RTC memory, where a deep sleep wake would have it
+// read this image's RTC variables at whatever addresses it expects its own.
+bool otaApply();
+
+// Call first thing in setup(). After an install, counts resets of the new
+// image; one that resets OTA_TRIAL_BOOTS times (crash, watchdog, power
+// cycle) without otaConfirmRunning() is rolled back to the previous slot and
+// the device restarts. The bootloader's own rollback is not needed for this.
+void otaCheckBoot();
+
+// The running image reached the server: end its trial and, where the
+// bootloader has rollback enabled, tell it so too
+void otaConfirmRunning();
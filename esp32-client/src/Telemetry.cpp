@@ -0,0 +1,187 @@
+#include "Telemetry.h"
+
+#define CBOR_UNSIGNED 0
+#define CBOR_NEGATIVE 1
+#define CBOR_TEXT     3
+#define CBOR_ARRAY    4
+#define CBOR_MAP      5
+#define CBOR_FALSE    0xF4
+#define CBOR_TRUE     0xF5
+#define CBOR_FLOAT32  0xFA
+
+// Just the CBOR subset the telemetry bodies need, written big-endian into
+// a fixed buffer. Running out of room sets `overflow` instead of writing.
+class CborWriter {
+public:
+    CborWriter(uint8_t* out, size_t capacity) : out(out), capacity(capacity), length(0), overflow(false) {}
+
+    void map(size_t pairs) { head(CBOR_MAP, pairs); }
+    void array(size_t items) { head(CBOR_ARRAY, items); }
+    void key(uint8_t id) { head(CBOR_UNSIGNED, id); }
+
+    void integer(int64_t value) {
+        if (value < 0) {
+            head(CBOR_NEGATIVE, (uint64_t)(-1 - value));
+        } else {
+            head(CBOR_UNSIGNED, (uint64_t)value);
+        }
+    }
+
+    void text(const char* s, size_t maxLength = SIZE_MAX) {
+        size_t n = strnlen(s, maxLength);
+        head(CBOR_TEXT, n);
+        bytes((const uint8_t*)s, n);
+    }
+
+    void boolean(bool value) { byte(value ? CBOR_TRUE : CBOR_FALSE); }
+
+    void float32(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        byte(CBOR_FLOAT32);
+        bigEndian(bits, 4);
+    }
+
+    size_t finish() const { return overflow ? 0 : length; }
+
+private:
+    uint8_t* out;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+
+    void byte(uint8_t b) {
+        if (length < capacity) {
+            out[length++] = b;
+        } else {
+            overflow = true;
+        }
+    }
+
+    void bytes(const uint8_t* data, size_t n) {
+        if (length + n > capacity) {
+            overflow = true;
+            return;
+        }
+        memcpy(out + length, data, n);
+        length += n;
+    }
+
+    void bigEndian(uint64_t value, int width) {
+        for (int shift = (width - 1) * 8; shift >= 0; shift -= 8) {
+            byte((uint8_t)(value >> shift));
+        }
+    }
+
+    // Major type plus the shortest argument encoding for `value`
+    void head(uint8_t major, uint64_t value) {
+        major <<= 5;
+        if (value < 24) {
+            byte(major | value);
+        } else if (value <= 0xFF) {
+            byte(major | 24);
+            bigEndian(value, 1);
+        } else if (value <= 0xFFFF) {
+            byte(major | 25);
+            bigEndian(value, 2);
+        } else if (value <= 0xFFFFFFFF) {
+            byte(major | 26);
+            bigEndian(value, 4);
+        } else {
+            byte(major | 27);
+            bigEndian(value, 8);
+        }
+    }
+};
+
+static void writeStatus(CborWriter& cbor, const DeviceStatus& status) {
+    cbor.map(11);
+    cbor.key(TM_STATUS_NAME);      cbor.text(status.status);
+    cbor.key(TM_BATTERY_VOLTAGE);  cbor.float32(status.batteryVoltage);
+    cbor.key(TM_BATTERY_PERCENT);  cbor.integer(status.batteryPercent);
+    cbor.key(TM_IS_CHARGING);      cbor.boolean(status.isCharging);
+    cbor.key(TM_SIGNAL_STRENGTH);  cbor.integer(status.signalStrength);
+    cbor.key(TM_FIRMWARE_VERSION); cbor.text(status.firmwareVersion);
+    cbor.key(TM_FREE_HEAP);        cbor.integer(status.freeHeap);
+    cbor.key(TM_PSRAM_FREE);       cbor.integer(status.psramFree);
+    cbor.key(TM_UPTIME);           cbor.integer(status.uptime);
+    cbor.key(TM_BOOT_COUNT);       cbor.integer(status.bootCount);
+    cbor.key(TM_USED_FALLBACK);    cbor.boolean(status.usedFallback);
+}
+
+size_t telemetryEncodeStatus(uint8_t* out, size_t capacity, const DeviceStatus& status) {
+    CborWriter cbor(out, capacity);
+    cbor.map(2);
+    cbor.key(TM_DEVICE_ID);
+    cbor.text(status.deviceId);
+    cbor.key(TM_STATUS);
+    writeStatus(cbor, status);
+    return cbor.finish();
+}
+
+size_t telemetryEncodeLog(uint8_t* out, size_t capacity, const char* deviceId, const char* message, const char* level, uint32_t deviceTime) {
+    CborWriter cbor(out, capacity);
+    cbor.map(4);
+    cbor.key(TM_DEVICE_ID);   cbor.text(deviceId);
+    cbor.key(TM_LOG_MESSAGE); cbor.text(message, TELEMETRY_MAX_MESSAGE);
+    cbor.key(TM_LOG_LEVEL);   cbor.text(level);
+    cbor.key(TM_DEVICE_TIME); cbor.integer(deviceTime);
+    return cbor.finish();
+}
+
+void telemetryRecordStatus(WakeSummary* summary, const DeviceStatus& status) {
+    summary->status = status;
+    if (summary->transitions < TELEMETRY_MAX_TRANSITIONS) {
+        summary->transitionName[summary->transitions] = status.status;
+        summary->transitionAt[summary->transitions] = status.uptime;
+        summary->transitions++;
+    }
+}
+
+void telemetryRecordPhase(WakeSummary* summary, const char* name, uint32_t ms) {
+    if (summary->phases < TELEMETRY_MAX_PHASES) {
+        summary->phaseName[summary->phases] = name;
+        summary->phaseMs[summary->phases] = ms;
+        summary->phases++;
+    }
+}
+
+size_t telemetryEncodeWake(uint8_t* out, size_t capacity, const WakeSummary& summary,
+                           const char* const* logLevels, const char* const* logMessages,
+                           size_t logCount, uint32_t dropped) {
+    // Drop the oldest logs one at a time until the datagram fits
+    for (size_t skip = 0; skip <= logCount; skip++) {
+        CborWriter cbor(out, capacity);
+        cbor.map(6);
+        cbor.key(TM_DEVICE_ID);
+        cbor.text(summary.status.deviceId);
+        cbor.key(TM_STATUS);
+        writeStatus(cbor, summary.status);
+        cbor.key(TM_TRANSITIONS);
+        cbor.array(summary.transitions);
+        for (uint8_t i = 0; i < summary.transitions; i++) {
+            cbor.array(2);
+            cbor.text(summary.transitionName[i]);
+            cbor.integer(summary.transitionAt[i]);
+        }
+        cbor.key(TM_PHASES);
+        cbor.map(summary.phases);
+        for (uint8_t i = 0; i < summary.phases; i++) {
+            cbor.text(summary.phaseName[i]);
+            cbor.integer(summary.phaseMs[i]);
+        }
+        cbor.key(TM_LOGS);
+        cbor.array(logCount - skip);
+        for (size_t i = skip; i < logCount; i++) {
+            cbor.array(2);
+            cbor.text(logLevels[i]);
+            cbor.text(logMessages[i], TELEMETRY_DATAGRAM_MESSAGE);
+        }
+        cbor.key(TM_DROPPED_LOGS);
+        cbor.integer(dropped + skip);
+
+        size_t length = cbor.finish();
+        if (length > 0) return length;
+    }
+    return 0;
+}
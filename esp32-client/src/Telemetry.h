@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Compact CBOR (RFC 8949) bodies for /api/device-status and /api/logs.
+// Maps are keyed by small integer field ids instead of names, and are
+// written into a caller-supplied buffer with no allocation. The server
+// decoder is taulu-api/telemetry.py; field ids must stay in sync with it.
+//
+// device-status: {TM_DEVICE_ID: text, TM_STATUS: {TM_STATUS_NAME .. TM_USED_FALLBACK}}
+// logs:          {TM_DEVICE_ID: text, TM_LOG_MESSAGE, TM_LOG_LEVEL, TM_DEVICE_TIME}
+// wake summary:  {TM_DEVICE_ID, TM_STATUS (latest), TM_TRANSITIONS: [[status, ms], ..],
+//                 TM_PHASES: {name: ms, ..}, TM_LOGS: [[level, message], ..], TM_DROPPED_LOGS}
+//                 sent as one UDP datagram (TELEMETRY_UDP_PORT in main.cpp)
+
+#define TELEMETRY_CONTENT_TYPE "application/cbor"
+#define TELEMETRY_MAX_SIZE 256
+#define TELEMETRY_MAX_MESSAGE 192 // longer log messages are cut
+#define TELEMETRY_DATAGRAM_SIZE 1400 // one Ethernet frame, so no IP fragmentation
+#define TELEMETRY_DATAGRAM_MESSAGE 96 // log messages are cut shorter in a datagram
+#define TELEMETRY_MAX_TRANSITIONS 8
+#define TELEMETRY_MAX_PHASES 8
+
+#define TM_DEVICE_ID        1
+#define TM_STATUS           2
+#define TM_STATUS_NAME      3
+#define TM_BATTERY_VOLTAGE  4
+#define TM_BATTERY_PERCENT  5
+#define TM_IS_CHARGING      6
+#define TM_SIGNAL_STRENGTH  7
+#define TM_FIRMWARE_VERSION 8
+#define TM_FREE_HEAP        9
+#define TM_PSRAM_FREE       10
+#define TM_UPTIME           11
+#define TM_BOOT_COUNT       12
+#define TM_USED_FALLBACK    13
+#define TM_LOG_MESSAGE      14
+#define TM_LOG_LEVEL        15
+#define TM_DEVICE_TIME      16
+#define TM_TRANSITIONS      17
+#define TM_PHASES           18
+#define TM_LOGS             19
+#define TM_DROPPED_LOGS     20
+
+struct DeviceStatus {
+    const char* deviceId;
+    const char* status;
+    float batteryVoltage;
+    int batteryPercent;
+    bool isCharging;
+    int signalStrength;
+    const char* firmwareVersion;
+    uint32_t freeHeap;
+    uint32_t psramFree;
+    uint32_t uptime;
+    uint32_t bootCount;
+    bool usedFallback;
+};
+
+// Everything a wake reports, collected for a single datagram. Names must be
+// string literals; only the pointers are kept.
+struct WakeSummary {
+    DeviceStatus status;  // latest report
+    uint8_t transitions;
+    const char* transitionName[TELEMETRY_MAX_TRANSITIONS];
+    uint32_t transitionAt[TELEMETRY_MAX_TRANSITIONS]; // millis()
+    uint8_t phases;
+    const char* phaseName[TELEMETRY_MAX_PHASES];
+    uint32_t phaseMs[TELEMETRY_MAX_PHASES];
+};
+
+// All encoders return the encoded length, or 0 if it does not fit in `capacity`
+size_t telemetryEncodeStatus(uint8_t* out, size_t capacity, const DeviceStatus& status);
+size_t telemetryEncodeLog(uint8_t* out, size_t capacity, const char* deviceId, const char* message, const char* level, uint32_t deviceTime);
+
+void telemetryRecordStatus(WakeSummary* summary, const DeviceStatus& status);
+void telemetryRecordPhase(WakeSummary* summary, const char* name, uint32_t ms);
+
+// Needs at least one recorded status. Logs are given oldest first; the oldest are left out (and counted as
+// dropped, on top of `dropped`) until the rest fits.
+size_t telemetryEncodeWake(uint8_t* out, size_t capacity, const WakeSummary& summary,
+                           const char* const* logLevels, const char* const* logMessages,
+                           size_t logCount, uint32_t dropped);
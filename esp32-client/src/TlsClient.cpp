@@ -0,0 +1,375 @@
+#include "TlsClient.h"
+#include "Log.h"
+#include <time.h>
+#include <errno.h>
+#include "lwip/sockets.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/platform.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define TLS_HOST_MAX 64
+#define TLS_HANDSHAKE_TIMEOUT 10000 // ms
+#define TLS_CONNECTIONS 2
+
+// Session from the last full handshake, offered back after deep sleep
+RTC_DATA_ATTR static uint8_t savedSession[TLS_SESSION_CACHE_SIZE];
+RTC_DATA_ATTR static uint16_t savedSessionLength = 0;
+RTC_DATA_ATTR static char savedSessionHost[TLS_HOST_MAX] = "";
+
+static const char* caCertPem = nullptr;
+
+// Settings shared by every connection
+static struct {
+    bool initialized;
+    mbedtls_ssl_config conf;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_x509_crt ca;
+} tls;
+
+// One connection per task: the main task and the refresh window task can
+// each have a request in flight
+struct TlsConnection {
+    TaskHandle_t owner;
+    bool open;
+    bool peerClosed;
+    char host[TLS_HOST_MAX];
+    uint16_t port;
+    int peeked; // byte read ahead by peek(), -1 if none
+    mbedtls_net_context net;
+    mbedtls_ssl_context ssl;
+};
+static TlsConnection connections[TLS_CONNECTIONS];
+
+// Held through every call into mbedtls, so tlsClose() can't pull a
+// connection out from under another task
+static SemaphoreHandle_t tlsMutex = xSemaphoreCreateRecursiveMutex();
+
+struct TlsLock {
+    TlsLock() { xSemaphoreTakeRecursive(tlsMutex, portMAX_DELAY); }
+    ~TlsLock() { xSemaphoreGiveRecursive(tlsMutex); }
+};
+
+// The calling task's connection, or nullptr if it has none
+static TlsConnection* ownConnection() {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < TLS_CONNECTIONS; i++) {
+        if (connections[i].open && connections[i].owner == task) return &connections[i];
+    }
+    return nullptr;
+}
+
+// Until the clock is set (it starts at 1970 after a cold boot) certificate
+// dates cannot be judged; don't fail on them.
+static int verifyCertificate(void*, mbedtls_x509_crt*, int, uint32_t* flags) {
+    if (time(nullptr) < 1600000000) {
+        *flags &= ~(MBEDTLS_X509_BADCERT_FUTURE | MBEDTLS_X509_BADCERT_EXPIRED);
+    }
+    return 0;
+}
+
+static void tlsFree() {
+    mbedtls_x509_crt_free(&tls.ca);
+    mbedtls_ssl_config_free(&tls.conf);
+    mbedtls_ctr_drbg_free(&tls.drbg);
+    mbedtls_entropy_free(&tls.entropy);
+}
+
+static bool tlsInit() {
+    if (tls.initialized) return true;
+
+    mbedtls_entropy_init(&tls.entropy);
+    mbedtls_ctr_drbg_init(&tls.drbg);
+    mbedtls_ssl_config_init(&tls.conf);
+    mbedtls_x509_crt_init(&tls.ca);
+
+    static const char personalization[] = "taulu-tls";
+    if (mbedtls_ctr_drbg_seed(&tls.drbg, mbedtls_entropy_func, &tls.entropy,
+                              (const unsigned char*)personalization, sizeof(personalization)) != 0 ||
+        mbedtls_ssl_config_defaults(&tls.conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+        LOG_E("TLS: init failed");
+        tlsFree();
+        return false;
+    }
+    mbedtls_ssl_conf_rng(&tls.conf, mbedtls_ctr_drbg_random, &tls.drbg);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&tls.conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    if (caCertPem) {
+        // A CA that doesn't parse must not turn verification off
+        if (mbedtls_x509_crt_parse(&tls.ca, (const unsigned char*)caCertPem, strlen(caCertPem) + 1) != 0) {
+            LOG_E("TLS: bad CA certificate, not connecting");
+            tlsFree();
+            return false;
+        }
+        mbedtls_ssl_conf_ca_chain(&tls.conf, &tls.ca, nullptr);
+        mbedtls_ssl_conf_authmode(&tls.conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        mbedtls_ssl_conf_verify(&tls.conf, verifyCertificate, nullptr);
+    } else {
+        mbedtls_ssl_conf_authmode(&tls.conf, MBEDTLS_SSL_VERIFY_NONE);
+    }
+
+    tls.initialized = true;
+    return true;
+}
+
+void tlsSetCACert(const char* pem) {
+    caCertPem = pem;
+}
+
+static void closeConnection(TlsConnection* c) {
+    if (!c->open) return;
+    if (!c->peerClosed) mbedtls_ssl_close_notify(&c->ssl);
+    mbedtls_ssl_free(&c->ssl);
+    mbedtls_net_free(&c->net);
+    c->open = false;
+}
+
+void tlsClose() {
+    TlsLock lock;
+    for (int i = 0; i < TLS_CONNECTIONS; i++) {
+        closeConnection(&connections[i]);
+    }
+}
+
+static void saveSession(TlsConnection* c) {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    size_t length = 0;
+    int ret = mbedtls_ssl_get_session(&c->ssl, &session);
+#if defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+    // Resumption skips the certificate, and it is most of the serialized
+    // session: keep only the ticket, session id and keys
+    if (ret == 0 && session.peer_cert) {
+        mbedtls_x509_crt_free(session.peer_cert);
+        mbedtls_free(session.peer_cert);
+        session.peer_cert = nullptr;
+    }
+#endif
+    if (ret == 0) {
+        ret = mbedtls_ssl_session_save(&session, savedSession, sizeof(savedSession), &length);
+    }
+    if (ret == 0) {
+        savedSessionLength = length;
+        strlcpy(savedSessionHost, c->host, sizeof(savedSessionHost));
+    } else {
+        // length is what the session would have needed
+        LOG_W("TLS: session not saved (-0x%04x, %u bytes)", (unsigned)-ret, (unsigned)length);
+        savedSessionLength = 0;
+    }
+    mbedtls_ssl_session_free(&session);
+}
+
+// Offer the saved session, if it was made with this server
+static void offerSavedSession(TlsConnection* c, const char* host) {
+    if (savedSessionLength == 0 || strcmp(savedSessionHost, host) != 0) return;
+
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_session_load(&session, savedSession, savedSessionLength) != 0 ||
+        mbedtls_ssl_set_session(&c->ssl, &session) != 0) {
+        savedSessionLength = 0;
+    }
+    mbedtls_ssl_session_free(&session);
+}
+
+// An open connection can be picked up again if the server hasn't closed it
+// and no stale data from an earlier exchange is waiting on it
+static bool reusable(TlsConnection* c, const char* host, uint16_t port) {
+    if (c->peerClosed || c->port != port || strcmp(c->host, host) != 0) return false;
+    if (c->peeked >= 0 || mbedtls_ssl_get_bytes_avail(&c->ssl) > 0) return false;
+
+    uint8_t probe;
+    int n = lwip_recv(c->net.fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+static int openConnection(const char* host, uint16_t port, int32_t timeout) {
+    TlsLock lock;
+    TlsConnection* c = ownConnection();
+    if (c) {
+        if (reusable(c, host, port)) return 1;
+        closeConnection(c);
+    } else {
+        for (int i = 0; i < TLS_CONNECTIONS && !c; i++) {
+            if (!connections[i].open) c = &connections[i];
+        }
+        if (!c) {
+            LOG_E("TLS: no free connection for %s", host);
+            return 0;
+        }
+    }
+    if (!tlsInit()) return 0;
+
+    uint32_t start = millis();
+    char portString[6];
+    snprintf(portString, sizeof(portString), "%u", port);
+    mbedtls_net_init(&c->net);
+    mbedtls_ssl_init(&c->ssl);
+    c->owner = xTaskGetCurrentTaskHandle();
+    c->open = true;
+    c->peerClosed = false;
+    c->peeked = -1;
+    strlcpy(c->host, host, sizeof(c->host));
+    c->port = port;
+
+    if (mbedtls_net_connect(&c->net, host, portString, MBEDTLS_NET_PROTO_TCP) != 0 ||
+        mbedtls_net_set_nonblock(&c->net) != 0 ||
+        mbedtls_ssl_setup(&c->ssl, &tls.conf) != 0 ||
+        mbedtls_ssl_set_hostname(&c->ssl, host) != 0) {
+        LOG_E("TLS: connect to %s:%u failed", host, port);
+        closeConnection(c);
+        return 0;
+    }
+    mbedtls_ssl_set_bio(&c->ssl, &c->net, mbedtls_net_send, mbedtls_net_recv, nullptr);
+    offerSavedSession(c, host);
+
+    uint32_t limit = timeout > 0 ? (uint32_t)timeout + TLS_HANDSHAKE_TIMEOUT : TLS_HANDSHAKE_TIMEOUT;
+    int ret;
+    while ((ret = mbedtls_ssl_handshake(&c->ssl)) != 0) {
+        if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) || millis() - start > limit) {
+            LOG_E("TLS: handshake with %s failed: -0x%04x", host, -ret);
+            if (ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) savedSessionLength = 0;
+            closeConnection(c);
+            return 0;
+        }
+        delay(1);
+    }
+
+    saveSession(c);
+    LOG_D("TLS: connected to %s in %u ms", host, (unsigned)(millis() - start));
+    return 1;
+}
+
+// Bytes read, or 0; end of stream and errors other than "try again" mark
+// the connection closed
+static int checkRead(TlsConnection* c, int ret) {
+    if (ret > 0) return ret;
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        c->peerClosed = true;
+    }
+    return 0;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip, port, 0);
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+    return openConnection(ip.toString().c_str(), port, timeout);
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+    return openConnection(host, port, 0);
+}
+
+int TlsClient::connect(const char* host, uint16_t port, int32_t timeout) {
+    return openConnection(host, port, timeout);
+}
+
+size_t TlsClient::write(uint8_t data) {
+    return write(&data, 1);
+}
+
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+    TlsLock lock;
+    TlsConnection* c = ownConnection();
+    if (!c || c->peerClosed) return 0;
+
+    size_t sent = 0;
+    uint32_t start = millis();
+    while (sent < size) {
+        int ret = mbedtls_ssl_write(&c->ssl, buf + sent, size - sent);
+        if (ret > 0) {
+            sent += ret;
+            start = millis();
+        } else if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+                   millis() - start > _timeout) {
+            closeConnection(c);
+            break;
+        } else {
+            delay(1);
+        }
+    }
+    return sent;
+}
+
+int TlsClient::available() {
+    TlsLock lock;
+    TlsConnection* c = ownConnection();
+    if (!c) return 0;
+    int buffered = (int)mbedtls_ssl_get_bytes_avail(&c->ssl);
+    if (buffered == 0 && !c->peerClosed) {
+        // Pull in the next record, if one has arrived. A zero-length read
+        // returns 0 on success, not end of stream.
+        int ret = mbedtls_ssl_read(&c->ssl, nullptr, 0);
+        if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            c->peerClosed = true;
+        }
+        buffered = (int)mbedtls_ssl_get_bytes_avail(&c->ssl);
+    }
+    return buffered + (c->peeked >= 0 ? 1 : 0);
+}
+
+int TlsClient::read() {
+    uint8_t data;
+    return read(&data, 1) == 1 ? data : -1;
+}
+
+int TlsClient::read(uint8_t* buf, size_t size) {
+    TlsLock lock;
+    TlsConnection* c = ownConnection();
+    if (!c || size == 0) return -1;
+
+    size_t got = 0;
+    if (c->peeked >= 0) {
+        buf[got++] = (uint8_t)c->peeked;
+        c->peeked = -1;
+        if (got == size) return got;
+    }
+    if (!c->peerClosed) {
+        got += checkRead(c, mbedtls_ssl_read(&c->ssl, buf + got, size - got));
+    }
+    return got > 0 ? (int)got : -1;
+}
+
+int TlsClient::peek() {
+    TlsLock lock;
+    TlsConnection* c = ownConnection();
+    if (!c) return -1;
+    if (c->peeked < 0) {
+        uint8_t data;
+        if (read(&data, 1) != 1) return -1;
+        c->peeked = data;
+    }
+    return c->peeked;
+}
+
+void TlsClient::flush() {
+}
+
+// Releases the connection for the next request. It is only closed if part
+// of a response is still unread, so it can't be picked up mid-stream.
+void TlsClient::stop() {
+    TlsLock lock;
+    TlsConnection* c = ownConnection();
+    if (c && (c->peerClosed || c->peeked >= 0 || mbedtls_ssl_get_bytes_avail(&c->ssl) > 0)) {
+        closeConnection(c);
+    }
+}
+
+uint8_t TlsClient::connected() {
+    TlsLock lock;
+    TlsConnection* c = ownConnection();
+    if (!c) return 0;
+    if (!c->peerClosed) return 1;
+    return c->peeked >= 0 || mbedtls_ssl_get_bytes_avail(&c->ssl) > 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// HTTPS transport for HTTPClient, built directly on mbedtls so the TLS
+// session can outlive deep sleep.
+//
+// - Every TlsClient shares one connection per task and wake. stop() only
+//   lets go of it; the next connect() from that task to the same server
+//   picks it up again if the server kept it open and nothing is left unread
+//   on it.
+// - After each full handshake the session is saved in RTC memory, and the
+//   first connection after waking offers it back. A server that still knows
+//   the session (ticket or session id cache) does an abbreviated handshake:
+//   no key exchange and no certificate chain, one round trip.
+//
+// Thread-safe: each task gets its own connection, and every call is
+// serialized by one mutex.
+//
+// The server certificate is checked against the CA given to tlsSetCACert();
+// if that CA can't be parsed, nothing connects. Without one the connection
+// is encrypted but the server is not authenticated.
+
+#define TLS_SESSION_CACHE_SIZE 768 // serialized session without the peer certificate: ~130 bytes plus the server's ticket
+
+class TlsClient : public WiFiClient {
+public:
+    int connect(IPAddress ip, uint16_t port);
+    int connect(IPAddress ip, uint16_t port, int32_t timeout);
+    int connect(const char* host, uint16_t port);
+    int connect(const char* host, uint16_t port, int32_t timeout);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    int read(uint8_t* buf, size_t size);
+    int peek();
+    void flush();
+    void stop();
+    uint8_t connected();
+    operator bool() { return connected(); }
+};
+
+// PEM CA certificate to verify the server with; call before the first connect
+void tlsSetCACert(const char* pem);
+
+// Close every task's connection (before WiFi goes down). The saved session
+// stays in RTC memory for the next wake.
+void tlsClose();
@@ -1,11 +1,28 @@
 #include "EPD_13in3e.h"
 #include "GUI_Paint.h"
 #include "fonts.h"
+#include "FrameStore.h"
+#include "FrameBuffer.h"
+#include "Bundle.h"
+#include "DisplayList.h"
+#include "Telemetry.h"
+#include "TlsClient.h"
+#include "Ota.h"
+#include "Capture.h"
+#include "BlueNoise.h"
+#include "Log.h"
 #include <WiFi.h>
+#include <WiFiUdp.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <Preferences.h>
+#include <time.h>
+#include <sys/time.h>
+#include <stdarg.h>
 #include "esp_sleep.h"
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include "soc/soc_memory_layout.h"
 #include "driver/rtc_io.h"
 #include "driver/gpio.h"
 #include "esp_wifi.h"
@@ -17,13 +34,86 @@
 #define SERVER_HOST "192.168.1.124:3000"
 #endif
 
+// Talk to the server over HTTPS (TlsClient.h). Define SERVER_CA_CERT as the
+// PEM of the CA that signed the server certificate to authenticate it.
+#ifndef SERVER_TLS
+#define SERVER_TLS 0
+#endif
+
 #define DEFAULT_SLEEP_TIME 3600000000ULL // 1 hour
+#define FAILURE_SLEEP_TIME (15 * 60 * 1000000ULL) // after a failed image download
 #define LOW_BATTERY_THRESHOLD 3.3
 #ifndef DEVICE_ID
 #define DEVICE_ID "esp32-001"
 #endif
 #define FIRMWARE_VERSION "v3-ee02-1.0"
 
+// Clear the panel to white before drawing on a KEY1 refresh. Costs a second
+// full refresh; only useful if a panel shows ghosting.
+#ifndef REFRESH_CLEAR_FIRST
+#define REFRESH_CLEAR_FIRST 0
+#endif
+#define MIN_SLEEP_TIME 60000000ULL // 1 minute
+
+// Keep the panel controller powered, with its registers, through deep sleep
+// instead of sending DSLP and cutting its rail, so the next update skips the
+// reset and init sequence. 0 = never, 1 = always, 2 = when charging or when
+// the coming sleep is shorter than the break-even point: the measured cold
+// init time at PANEL_INIT_MA against PANEL_STANDBY_UA of standby current.
+#ifndef PANEL_RETAIN
+#define PANEL_RETAIN 0
+#endif
+// Neither current has been measured on a board yet. Both are rough
+// placeholders, and they put the break-even at about an hour (4.3 s at 45 mA
+// against 50 uA). PANEL_STANDBY_UA is the extra deep sleep current of a
+// retained panel: battery current in deep sleep with PANEL_RETAIN=1 minus
+// the same with PANEL_RETAIN=0. PANEL_INIT_MA is the average battery
+// current over the panelInit phase of a cold wake.
+#ifndef PANEL_STANDBY_UA
+#define PANEL_STANDBY_UA 50 // controller and load switch with the rail on
+#endif
+#ifndef PANEL_INIT_MA
+#define PANEL_INIT_MA 45    // board current during the power-up and init waits
+#endif
+#define PANEL_INIT_ESTIMATE_MS 4300 // until a cold init has been timed
+
+// Stay offline and rotate through the stored bundle while at least this many
+// bundled frames are still scheduled; 0 disables bundles.
+#ifndef BUNDLE_LOW_WATER
+#define BUNDLE_LOW_WATER 1
+#endif
+#define MAX_OFFLINE_SLEEP (24 * 3600000000ULL) // longest sleep taken on a bundle schedule
+
+// Collect status reports, phase timings and server logs over the wake and
+// send them as one UDP datagram to this port on the server just before the
+// radios go off, instead of an HTTP request each. A lost datagram loses
+// that wake's telemetry. 0 keeps the HTTP reports.
+#ifndef TELEMETRY_UDP_PORT
+#define TELEMETRY_UDP_PORT 0
+#endif
+
+// Firmware update patch bytes fetched per online wake; the update is
+// installed once the whole patch is in. 0 disables updates. Define
+// OTA_SIGNING_KEY as a PEM public key to install only updates signed with
+// its private key (Ota.h).
+#ifndef OTA_BYTES_PER_WAKE
+#define OTA_BYTES_PER_WAKE (64 * 1024)
+#endif
+
+// Define DEBUG_UPLOAD_TOKEN for CAPTURE_SESSION and LOG_DEFERRED builds: their
+// captures and log rings are sent with it as a bearer token, and the server
+// stores them only if its own DEBUG_UPLOAD_TOKEN matches.
+
+// Ask the server for blue-noise dithered frames (?dither=blue-noise) and
+// dither RGB streams the same way on the device, instead of Floyd-Steinberg
+// frames and nearest-colour mapping.
+#ifndef DITHER_BLUE_NOISE
+#define DITHER_BLUE_NOISE 0
+#endif
+#if DITHER_BLUE_NOISE
+#define DITHER_PARAM "dither=blue-noise"
+#endif
+
 // Board-specific battery and button pins
 #ifdef BOARD_XIAO_EE02
 #define BATTERY_PIN     1   // GPIO1 (A0) - battery voltage ADC
@@ -36,28 +126,51 @@
 #define BATTERY_PIN A13
 #endif
 
-// Display dimensions
-#define DISPLAY_WIDTH 1200
-#define DISPLAY_HEIGHT 1600
-#define IMAGE_BUFFER_SIZE ((DISPLAY_WIDTH * DISPLAY_HEIGHT) / 2) // 960KB for 4-bit packed
+// Attached panel; geometry and palette come from its traits (EPD_Panel.h)
+typedef EPD_13IN3E_Panel Panel;
+#define DISPLAY_WIDTH Panel::Width
+#define DISPLAY_HEIGHT Panel::Height
+#define IMAGE_BUFFER_SIZE Panel::FrameBytes // 960KB for 4-bit packed
 
 // Function declarations
 void setupPowerManagement();
 void teardownRadios();
-void powerDownDisplay();
+void powerDownDisplay(uint64_t sleepTime);
+void panelUpdateDone();
+bool panelPowerUp();
+void holdPanelPins();
+void releasePanelPins();
+bool panelRetainFor(uint64_t sleepTime);
+void tunePanelSpiClock(bool calibrate);
+bool displayStoredFrame(int slot, bool clearFirst);
+void fetchBundle();
+bool fetchFirmwareUpdate();
+uint64_t sleepUntil(time_t wakeAt);
+uint64_t remainingSleepTime();
 bool connectToWiFi();
 bool downloadAndDisplayImage();
-bool downloadImageToPSRAM(bool displayNow = true, uint8_t** outBuffer = nullptr);
+bool downloadImageToPSRAM(bool displayNow = true, FrameBuffer* outBuffer = nullptr);
+bool downloadDisplayList(FrameBuffer* outBuffer);
 void reportDeviceStatus(const char *status, float batteryVoltage, int signalStrength, int batteryPercent, bool isCharging);
 void sendLogToServer(const char *message, const char *level = "INFO");
+void sendLogToServerf(const char *level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void flushLogs();
 void sendActionToServer(const char *action);
 float readBatteryVoltage();
 int calculateBatteryPercentage(float voltage);
 bool detectCharging(float currentVoltage, float previousVoltage);
 void enterDeepSleep(uint64_t sleepTime);
+void restartIntoUpdate();
 uint8_t mapRGBToEink(uint8_t r, uint8_t g, uint8_t b);
+uint8_t ditherRGBToEink(uint8_t r, uint8_t g, uint8_t b, int x, int y);
 uint64_t getSleepDurationFromServer();
+// current.json, parsed straight off the socket; only the fields below are kept
+typedef StaticJsonDocument<384> CurrentJsonDocument;
+bool fetchCurrentJson(CurrentJsonDocument &doc, uint32_t timeoutMs, int *httpCode);
+uint64_t chooseSleepInterval(bool downloadFailed, bool lowBattery);
+void reportSleep(uint64_t sleepInterval, float batteryVoltage, int signalStrength, int batteryPercent, bool isCharging);
 String buildApiUrl(const char* endpoint, const String& serverHost);
+bool beginApiRequest(HTTPClient &http, const String &url);
 void setEinkPixel(uint8_t* buffer, int x, int y, uint8_t color);
 void drawBatteryLowIcon(uint8_t* buffer);
 
@@ -73,15 +186,64 @@ const uint8_t EINK_GREEN = 0x6;
 RTC_DATA_ATTR char lastDisplayedImageId[65] = ""; // Stores imageId (64 chars + null terminator)
 RTC_DATA_ATTR float lastBatteryVoltage = 0.0f; // Previous voltage reading for charging detection
 RTC_DATA_ATTR uint32_t bootCount = 0; // Track number of wake cycles
+RTC_DATA_ATTR time_t scheduledWakeTime = 0; // RTC-clock time the sleep timer was set to fire
+RTC_DATA_ATTR int8_t lastDisplayedSlot = FRAME_SLOT_LAST; // frame store slot holding what is on the panel
+RTC_DATA_ATTR bool clockSynced = false; // system time set from a bundle's server time
+RTC_DATA_ATTR uint32_t lastRefreshMs = 0; // duration of the previous panel refresh
+RTC_DATA_ATTR bool panelRetained = false; // controller kept powered through the last sleep (PANEL_RETAIN)
+RTC_DATA_ATTR uint32_t panelColdInitMs = 0; // last measured power-up + init of an unpowered panel
 
 // Dev mode tracking (not stored in RTC, resets each wake)
 String devServerHost = ""; // e.g. "192.168.1.26:3000"
 bool usedFallback = false; // true if we tried dev server but it failed
+bool externalPower = false; // charging this wake; PANEL_RETAIN=2 keeps the panel up then
+bool panelPowered = false; // bus up to a powered controller this wake
+
+// Server logs queued while deferLogs is set, posted later by flushLogs()
+#define LOG_QUEUE_LENGTH 12
+#define LOG_QUEUE_MESSAGE 160
+struct PendingLog {
+    char level[8];
+    char message[LOG_QUEUE_MESSAGE];
+};
+PendingLog pendingLogs[LOG_QUEUE_LENGTH];
+uint8_t pendingLogHead = 0;
+uint8_t pendingLogCount = 0;
+uint32_t pendingLogDropped = 0;
+bool deferLogs = false;
+portMUX_TYPE pendingLogLock = portMUX_INITIALIZER_UNLOCKED;
+
+// This wake's telemetry, sent by sendWakeSummary() when TELEMETRY_UDP_PORT is set
+WakeSummary wakeSummary;
+void recordPhase(const char *name, uint32_t startMs);
+void sendWakeSummary();
+#if CAPTURE_SESSION
+void uploadCapture();
+#endif
+
+// Network work done while the panel refreshes (BUSY is low for 30-45 s)
+struct RefreshWindowWork {
+    float batteryVoltage;
+    int signalStrength;
+    int batteryPercent;
+    bool isCharging;
+    bool lowBattery;
+    volatile bool stop;         // set by the main task: no more requests
+    uint64_t sleepInterval;     // filled in by the task, 0 if stopped first
+    bool updateInstalled;       // filled in by the task
+    SemaphoreHandle_t done;
+};
+void refreshWindowTask(void *arg);
+void joinRefreshWindow(RefreshWindowWork *work);
+#define REFRESH_WINDOW_TIMEOUT_MS 120000
+#define REFRESH_WINDOW_STACK (SERVER_TLS ? 12288 : 8192) // a TLS handshake needs the extra room
 
 void setup() {
     Serial.begin(115200);
     delay(1000);
 
+    otaCheckBoot();
+
     // Increment boot counter
     bootCount++;
 
@@ -96,63 +258,115 @@ void setup() {
         if (wakeStatus & (1ULL << BUTTON_KEY0))      wakeButton = 0; // previous
         else if (wakeStatus & (1ULL << BUTTON_KEY1)) wakeButton = 1; // refresh
         else if (wakeStatus & (1ULL << BUTTON_KEY2)) wakeButton = 2; // next
-        Debug("Button wake: KEY" + String(wakeButton) + "\r\n");
+        LOG_I("Button wake: KEY%d", wakeButton);
     }
 #endif
 
     // FULL WAKE: Normal operation with WiFi and display
-    Debug("=== XIAO EE02 E-ink Display ===\r\n");
-    Debug("Device ID: " DEVICE_ID "\r\n");
-    Debug("Firmware: " FIRMWARE_VERSION "\r\n");
-    Debug("Display: 13.3\" Spectra 6\r\n");
-    Debug("===============================\r\n");
+    LOG_I("=== XIAO EE02 E-ink Display ===");
+    LOG_I("Device ID: " DEVICE_ID);
+    LOG_I("Firmware: " FIRMWARE_VERSION);
+    LOG_I("Display: 13.3\" Spectra 6");
+    LOG_I("===============================");
 
     // Check PSRAM availability
-    Debug("Regular heap: " + String(ESP.getFreeHeap()) + " bytes\r\n");
+    LOG_D("Regular heap: %u bytes", (unsigned)ESP.getFreeHeap());
 
     if (psramInit()) {
-        Debug("PSRAM initialized successfully\r\n");
-        Debug("PSRAM size: " + String(ESP.getPsramSize()) + " bytes\r\n");
-        Debug("PSRAM free: " + String(ESP.getFreePsram()) + " bytes\r\n");
+        LOG_D("PSRAM initialized successfully");
+        LOG_D("PSRAM size: %u bytes", (unsigned)ESP.getPsramSize());
+        LOG_D("PSRAM free: %u bytes", (unsigned)ESP.getFreePsram());
     } else {
-        Debug("PSRAM initialization failed or not available\r\n");
-        Debug("PSRAM via heap_caps: " + String(heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) + " bytes\r\n");
+        LOG_W("PSRAM initialization failed or not available");
+        LOG_D("PSRAM via heap_caps: %u bytes", (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
     }
 
+#if CAPTURE_SESSION
+    captureBegin();
+#endif
+
     // Setup power management
     setupPowerManagement();
 
-    Debug("Boot count: " + String(bootCount) + "\r\n");
+    // Keep a panel left in standby selected off and out of reset, in case
+    // the pad hold did not last through the wake
+    if (panelRetained) holdPanelPins();
+
+#if SERVER_TLS && defined(SERVER_CA_CERT)
+    tlsSetCACert(SERVER_CA_CERT);
+#endif
+#ifdef OTA_SIGNING_KEY
+    otaSetSigningKey(OTA_SIGNING_KEY);
+#endif
+
+    LOG_I("Boot count: %u", (unsigned)bootCount);
+    if (lastRefreshMs > 0) {
+        telemetryRecordPhase(&wakeSummary, "previousRefresh", lastRefreshMs);
+    }
+
+#ifdef BOARD_XIAO_EE02
+    // KEY1 redraws the frame already kept in flash; the server has nothing
+    // to do for a refresh, so WiFi stays off.
+    if (wakeButton == 1 && displayStoredFrame(lastDisplayedSlot, REFRESH_CLEAR_FIRST)) {
+        enterDeepSleep(remainingSleepTime());
+        return;
+    }
+#endif
 
     // Read battery voltage and calculate metrics
     float batteryVoltage = readBatteryVoltage();
     int batteryPercent = calculateBatteryPercentage(batteryVoltage);
     bool isCharging = detectCharging(batteryVoltage, lastBatteryVoltage);
 
-    Debug("Battery Voltage: " + String(batteryVoltage, 2) + "V (" + String(batteryPercent) + "%)\r\n");
+    LOG_I("Battery Voltage: %.2fV (%d%%)", batteryVoltage, batteryPercent);
     if (isCharging) {
-        Debug("Battery is charging\r\n");
+        LOG_I("Battery is charging");
     }
+    externalPower = isCharging;
 
     // Store current voltage for next wake cycle
     lastBatteryVoltage = batteryVoltage;
 
     bool lowBattery = (batteryVoltage < LOW_BATTERY_THRESHOLD);
     if (lowBattery) {
-        Debug("Low battery detected, will display with warning icon\r\n");
+        LOG_W("Low battery detected, will display with warning icon");
         sendLogToServer("Low battery detected, displaying with warning icon", "WARNING");
     }
 
+#if BUNDLE_LOW_WATER > 0
+    // Offline slideshow: put up a bundled frame that has come due and stay
+    // off WiFi while enough of the bundle is left.
+    if (!buttonWake && clockSynced) {
+        time_t now = time(nullptr);
+        int dueSlot = bundleDueSlot(now, lastDisplayedImageId);
+        FrameInfo info;
+        if (dueSlot >= 0 && frameStoreInfo(dueSlot, &info) && displayStoredFrame(dueSlot, false)) {
+            LOG_I("Displayed bundled frame %s", info.imageId);
+            strncpy(lastDisplayedImageId, info.imageId, 64);
+            lastDisplayedImageId[64] = '\0';
+            lastDisplayedSlot = dueSlot;
+            bundleDiscardBefore(info.displayAt, dueSlot);
+        }
+        if (bundlePendingCount(now) >= BUNDLE_LOW_WATER) {
+            LOG_I("Bundle has frames left, staying offline");
+            enterDeepSleep(sleepUntil(bundleNextDisplayAt(now)));
+            return;
+        }
+    }
+#endif
+
     // Connect to WiFi
-    if (!connectToWiFi()) {
-        Debug("WiFi connection failed, entering sleep\r\n");
+    uint32_t phaseStart = millis();
+    bool wifiConnected = connectToWiFi();
+    recordPhase("wifi", phaseStart);
+    if (!wifiConnected) {
+        LOG_W("WiFi connection failed, entering sleep");
         enterDeepSleep(DEFAULT_SLEEP_TIME);
         return;
     }
 
     // Log successful WiFi connection
-    String wifiMsg = "WiFi connected, signal: " + String(WiFi.RSSI()) + " dBm";
-    sendLogToServer(wifiMsg.c_str());
+    sendLogToServerf("INFO", "WiFi connected, signal: %d dBm", WiFi.RSSI());
 
     // Report device status
     int signalStrength = WiFi.RSSI();
@@ -168,166 +382,282 @@ void setup() {
     }
 
     // Check if image has changed by comparing imageId
-    Debug("Last displayed imageId: " + String(lastDisplayedImageId) + "\r\n");
+    LOG_I("Last displayed imageId: %s", lastDisplayedImageId);
 
-    HTTPClient http;
-    String url = buildApiUrl("current.json", SERVER_HOST);
-    http.begin(url);
-    http.setTimeout(30000);
-    http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
-
-    int httpResponseCode = http.GET();
-    String currentImageId = "";
+    int httpResponseCode = 0;
+    char currentImageId[65] = "";
+    bool isDisplayList = false;
     bool imageChanged = true;
     bool metadataFetched = false;
 
-    if (httpResponseCode == 200) {
-        String payload = http.getString();
-        DynamicJsonDocument doc(1024);
-        DeserializationError error = deserializeJson(doc, payload);
-
-        if (!error && doc.containsKey("imageId")) {
-            currentImageId = doc["imageId"].as<String>();
+    CurrentJsonDocument doc;
+    phaseStart = millis();
+    bool metadataParsed = fetchCurrentJson(doc, 30000, &httpResponseCode);
+    recordPhase("metadata", phaseStart);
+    if (metadataParsed) {
+        if (doc["imageId"].is<const char*>()) {
+            strlcpy(currentImageId, doc["imageId"], sizeof(currentImageId));
             metadataFetched = true;
-            Debug("Current server imageId: " + currentImageId + "\r\n");
+            otaConfirmRunning();
+            LOG_I("Current server imageId: %s", currentImageId);
+            isDisplayList = doc["displayList"] | false;
 
             // Read dev server host if present
             if (doc.containsKey("devServerHost") && !doc["devServerHost"].isNull()) {
                 devServerHost = doc["devServerHost"].as<String>();
-                Debug("Dev mode enabled, will try dev server: " + devServerHost + "\r\n");
+                LOG_I("Dev mode enabled, will try dev server: %s", devServerHost.c_str());
             }
 
             // Compare with last displayed imageId
             // Always refresh on button wake since server may have changed the image
             if (buttonWake) {
-                Debug("Button wake - forcing display update\r\n");
-            } else if (strlen(lastDisplayedImageId) > 0 && currentImageId.equals(lastDisplayedImageId)) {
+                LOG_I("Button wake - forcing display update");
+            } else if (strlen(lastDisplayedImageId) > 0 && strcmp(currentImageId, lastDisplayedImageId) == 0) {
                 imageChanged = false;
-                Debug("Image unchanged - skipping display update\r\n");
+                LOG_I("Image unchanged - skipping display update");
                 sendLogToServer("Image unchanged, skipping update to save power");
             } else if (strlen(lastDisplayedImageId) > 0) {
-                Debug("Image changed: '" + String(lastDisplayedImageId) + "' -> '" + currentImageId + "'\r\n");
+                LOG_I("Image changed: '%s' -> '%s'", lastDisplayedImageId, currentImageId);
                 sendLogToServer("Image changed, will update display");
             } else {
-                Debug("First boot - will display image\r\n");
+                LOG_I("First boot - will display image");
                 sendLogToServer("First boot, displaying initial image");
             }
         } else {
-            Debug("Failed to parse metadata or imageId missing\r\n");
+            LOG_W("Failed to parse metadata or imageId missing");
             sendLogToServer("Error: Failed to parse metadata from server");
         }
+    } else if (httpResponseCode != HTTP_CODE_OK) {
+        LOG_W("HTTP request failed: %d", httpResponseCode);
+        sendLogToServerf("INFO", "Error: HTTP request failed with code %d", httpResponseCode);
     } else {
-        Debug("HTTP request failed: " + String(httpResponseCode) + "\r\n");
-        String errorMsg = "Error: HTTP request failed with code " + String(httpResponseCode);
-        sendLogToServer(errorMsg.c_str());
+        sendLogToServer("Error: Failed to parse metadata from server");
     }
-    http.end();
 
-    // Track if download failed for sleep duration adjustment
+    // Track if download (or panel init) failed for sleep duration adjustment
     bool downloadFailed = false;
+    static RefreshWindowWork refreshWork;
+    bool refreshWindowStarted = false;
 
     // Only proceed with display update if we successfully fetched metadata and image changed
     if (!metadataFetched) {
-        Debug("Skipping display update due to metadata fetch failure\r\n");
+        LOG_I("Skipping display update due to metadata fetch failure");
         sendLogToServer("Metadata fetch failed, skipping display update", "ERROR");
         reportDeviceStatus("metadata_fetch_failed", batteryVoltage, signalStrength, batteryPercent, isCharging);
     } else if (!imageChanged) {
         reportDeviceStatus("display_unchanged", batteryVoltage, signalStrength, batteryPercent, isCharging);
     } else {
-        Debug("Proceeding with display update\r\n");
+        LOG_I("Proceeding with display update");
         sendLogToServer("Starting display update for new image");
 
         // Download image to PSRAM first (before clearing display)
-        Debug("Downloading image to PSRAM...\r\n");
+        LOG_D("Downloading image to PSRAM...");
         sendLogToServer("Downloading new image");
 
-        uint8_t* imageBuffer = nullptr;
-        bool downloadSuccess = downloadImageToPSRAM(false, &imageBuffer);
-
-        if (downloadSuccess && imageBuffer != nullptr) {
-            Debug("Download successful, initializing display...\r\n");
+        FrameBuffer imageBuffer;
+        phaseStart = millis();
+        bool downloadSuccess = isDisplayList ? downloadDisplayList(&imageBuffer)
+                                             : downloadImageToPSRAM(false, &imageBuffer);
+        recordPhase("download", phaseStart);
+
+        if (downloadSuccess && imageBuffer) {
+            LOG_I("Download successful, initializing display...");
+            // Nothing below needs the server until the refresh is running;
+            // queue logs and send them from the refresh window instead.
+            deferLogs = true;
             sendLogToServer("Download successful, initializing display");
 
-            DEV_Module_Init();
-            delay(2000);
-            EPD_13IN3E_Init();
-            delay(2000);
-
-            if (buttonWake && wakeButton == 1) {
-                Debug("Refresh requested, clearing display...\r\n");
-                sendLogToServer("Refresh requested, clearing display (30-45s)");
-                EPD_13IN3E_Clear(EINK_WHITE);
-                Debug("Display cleared\r\n");
-                sendLogToServer("Display cleared, rendering new image");
-                delay(1000);
-            }
+            if (!panelPowerUp()) {
+                deferLogs = false;
+                sendLogToServer("Panel init failed, keeping previous image on display", "ERROR");
+                flushLogs();
+                reportDeviceStatus("display_failed", batteryVoltage, signalStrength, batteryPercent, isCharging);
+                downloadFailed = true; // retry soon, like a failed download
+            } else {
+#ifdef EPD_SPI_BENCHMARK
+                DEV_SPI_Benchmark();
+#endif
 
-            Debug("Displaying downloaded image...\r\n");
-            sendLogToServer("Rendering image to display (30-45s)");
-            delay(2000);
-            esp_task_wdt_reset();
+#if REFRESH_CLEAR_FIRST
+                if (buttonWake && wakeButton == 1) {
+                    LOG_I("Refresh requested, clearing display...");
+                    sendLogToServer("Refresh requested, clearing display (30-45s)");
+                    EPD_13IN3E_Clear(EINK_WHITE);
+                    LOG_I("Display cleared");
+                    sendLogToServer("Display cleared, rendering new image");
+                    delay(1000);
+                }
+#endif
 
-            // Overlay battery low icon in corner if needed
-            if (lowBattery) {
-                drawBatteryLowIcon(imageBuffer);
-            }
+                LOG_I("Displaying downloaded image...");
+                sendLogToServer("Rendering image to display (30-45s)");
+                delay(2000);
+                esp_task_wdt_reset();
 
-            EPD_13IN3E_Display(imageBuffer);
-            Debug("SUCCESS: Image displayed!\r\n");
-            sendLogToServer("Image successfully displayed");
+                // Overlay battery low icon in corner if needed
+                if (lowBattery) {
+                    drawBatteryLowIcon(imageBuffer.data());
+                }
 
-            // Free the image buffer
-            if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
-                heap_caps_free(imageBuffer);
-            } else {
-                free(imageBuffer);
-            }
+                uint32_t refreshStart = millis();
+                EPD_13IN3E_DisplayStart(imageBuffer.frame());
+                lastDisplayedSlot = FRAME_SLOT_LAST;
+
+                // While the panel refreshes: flush logs, report status, top up the
+                // bundle and fetch the next sleep interval. The radios go down as
+                // soon as that is done.
+                refreshWork.batteryVoltage = batteryVoltage;
+                refreshWork.signalStrength = signalStrength;
+                refreshWork.batteryPercent = batteryPercent;
+                refreshWork.isCharging = isCharging;
+                refreshWork.lowBattery = lowBattery;
+                refreshWork.stop = false;
+                refreshWork.sleepInterval = 0;
+                refreshWork.updateInstalled = false;
+                refreshWork.done = xSemaphoreCreateBinary();
+                if (refreshWork.done != NULL &&
+                    xTaskCreatePinnedToCore(refreshWindowTask, "refreshWindow", REFRESH_WINDOW_STACK, &refreshWork, 1, NULL, 0) == pdPASS) {
+                    refreshWindowStarted = true;
+                } else {
+                    LOG_W("Could not start refresh window task, doing network work afterwards");
+                }
 
-            // Store the new imageId in RTC memory
-            if (currentImageId.length() > 0 && currentImageId.length() < 65) {
-                strncpy(lastDisplayedImageId, currentImageId.c_str(), 64);
-                lastDisplayedImageId[64] = '\0';
-                Debug("Stored imageId in RTC memory: " + String(lastDisplayedImageId) + "\r\n");
-            }
+                // Keep a copy in flash so the frame can be redisplayed without PSRAM
+                frameStoreSave(FRAME_SLOT_LAST, currentImageId, imageBuffer.frame());
+                imageBuffer.release();
+
+                // Store the new imageId in RTC memory
+                if (currentImageId[0] != '\0') {
+                    strlcpy(lastDisplayedImageId, currentImageId, sizeof(lastDisplayedImageId));
+                    LOG_I("Stored imageId in RTC memory: %s", lastDisplayedImageId);
+                }
 
-            reportDeviceStatus("display_updated", batteryVoltage, signalStrength, batteryPercent, isCharging);
+                if (refreshWindowStarted) joinRefreshWindow(&refreshWork);
 
-            // Power down display after update
-            powerDownDisplay();
+                EPD_13IN3E_DisplayFinish();
+                lastRefreshMs = millis() - refreshStart;
+                LOG_I("SUCCESS: Image displayed!");
+
+                panelUpdateDone();
+
+                if (!refreshWindowStarted) {
+                    deferLogs = false;
+                    flushLogs();
+                    reportDeviceStatus("display_updated", batteryVoltage, signalStrength, batteryPercent, isCharging);
+                }
+            }
         } else {
-            Debug("Download failed, keeping previous image\r\n");
+            LOG_W("Download failed, keeping previous image");
             sendLogToServer("Download failed, keeping previous image on display", "ERROR");
             reportDeviceStatus("download_failed", batteryVoltage, signalStrength, batteryPercent, isCharging);
             downloadFailed = true;
         }
     }
 
-    // Get sleep interval
+    uint64_t sleepInterval;
+    bool updateInstalled = false;
+    if (refreshWindowStarted) {
+        sleepInterval = refreshWork.sleepInterval ? refreshWork.sleepInterval : DEFAULT_SLEEP_TIME;
+        updateInstalled = refreshWork.updateInstalled;
+    } else {
+        bool updateReady = false;
+        if (!downloadFailed) {
+            fetchBundle();
+            updateReady = fetchFirmwareUpdate();
+        }
+        sleepInterval = chooseSleepInterval(downloadFailed, lowBattery);
+        reportSleep(sleepInterval, batteryVoltage, signalStrength, batteryPercent, isCharging);
+#if !CAPTURE_SESSION
+        teardownRadios();
+#endif
+        updateInstalled = updateReady && otaApply();
+    }
+
+    if (updateInstalled) restartIntoUpdate();
+    enterDeepSleep(sleepInterval);
+}
+
+// Runs on core 0 while the main task waits out the panel refresh. Leaves
+// the radios up; joinRefreshWindow() takes them down.
+void refreshWindowTask(void *arg) {
+    RefreshWindowWork *work = (RefreshWindowWork*)arg;
+
+    deferLogs = false;
+    flushLogs();
+    reportDeviceStatus("display_updated", work->batteryVoltage, work->signalStrength, work->batteryPercent, work->isCharging);
+    if (!work->stop) fetchBundle();
+    bool updateReady = !work->stop && fetchFirmwareUpdate();
+
+    if (!work->stop) {
+        uint64_t sleepInterval = chooseSleepInterval(false, work->lowBattery);
+        reportSleep(sleepInterval, work->batteryVoltage, work->signalStrength, work->batteryPercent, work->isCharging);
+        work->sleepInterval = sleepInterval;
+    }
+    // Needs no network, while the panel is still refreshing; the restart
+    // waits for the main task
+    work->updateInstalled = updateReady && !work->stop && otaApply();
+
+    xSemaphoreGive(work->done);
+    vTaskDelete(NULL);
+}
+
+// Wait for the refresh window task (usually done well before the refresh
+// is), then take the radios down. Past the timeout the task is told to
+// stop after its current request and waited for again: the radios must not
+// go down under a request, nor the device sleep under otaApply().
+void joinRefreshWindow(RefreshWindowWork *work) {
+    if (xSemaphoreTake(work->done, pdMS_TO_TICKS(REFRESH_WINDOW_TIMEOUT_MS)) != pdTRUE) {
+        LOG_W("Refresh window task timed out, stopping it");
+        work->stop = true;
+        xSemaphoreTake(work->done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(work->done);
+#if !CAPTURE_SESSION
+    teardownRadios();
+#endif
+}
+
+uint64_t chooseSleepInterval(bool downloadFailed, bool lowBattery) {
     uint64_t sleepInterval;
     if (downloadFailed) {
-        sleepInterval = 15 * 60 * 1000000ULL; // 15 minutes on download failure
-        Debug("Download failed, using short sleep interval: 15 minutes\r\n");
+        sleepInterval = FAILURE_SLEEP_TIME;
+        LOG_W("Download failed, using short sleep interval: 15 minutes");
         sendLogToServer("Using 15-minute sleep due to download failure");
     } else if (lowBattery) {
         sleepInterval = DEFAULT_SLEEP_TIME * 2; // Double sleep time for low battery
-        Debug("Low battery, using extended sleep interval\r\n");
+        LOG_I("Low battery, using extended sleep interval");
         sendLogToServer("Using extended sleep due to low battery");
     } else {
         sleepInterval = getSleepDurationFromServer();
         if (sleepInterval == 0) {
-            Debug("Using default sleep interval\r\n");
+            LOG_I("Using default sleep interval");
             sleepInterval = DEFAULT_SLEEP_TIME;
         }
     }
 
-    Debug("Sleep interval: " + String(sleepInterval / 1000000) + " seconds (" + String(sleepInterval / 1000000 / 60) + " minutes)\r\n");
+#if BUNDLE_LOW_WATER > 0
+    // Don't sleep through the next bundled frame
+    if (clockSynced) {
+        time_t nextFrame = bundleNextDisplayAt(time(nullptr));
+        if (nextFrame != 0) {
+            uint64_t untilFrame = sleepUntil(nextFrame);
+            if (untilFrame < sleepInterval) sleepInterval = untilFrame;
+        }
+    }
+#endif
 
-    reportDeviceStatus("sleeping", batteryVoltage, signalStrength, batteryPercent, isCharging);
-    String sleepMsg = "Entering deep sleep for " + String(sleepInterval / 1000000 / 60) + " minutes";
-    sendLogToServer(sleepMsg.c_str());
+    LOG_I("Sleep interval: %llu seconds (%llu minutes)", (unsigned long long)(sleepInterval / 1000000), (unsigned long long)(sleepInterval / 1000000 / 60));
+    return sleepInterval;
+}
 
-    teardownRadios();
-    enterDeepSleep(sleepInterval);
+// Last server contact of a wake: announce the sleep. The caller drops
+// WiFi/BT afterwards (capture builds leave them up for uploadCapture()).
+void reportSleep(uint64_t sleepInterval, float batteryVoltage, int signalStrength, int batteryPercent, bool isCharging) {
+    reportDeviceStatus("sleeping", batteryVoltage, signalStrength, batteryPercent, isCharging);
+    sendLogToServerf("INFO", "Entering deep sleep for %llu minutes", (unsigned long long)(sleepInterval / 1000000 / 60));
+#if TELEMETRY_UDP_PORT
+    sendWakeSummary();
+#endif
 }
 
 void loop() {
@@ -336,7 +666,7 @@ void loop() {
 }
 
 void setupPowerManagement() {
-    Debug("Setting up power management...\r\n");
+    LOG_I("Setting up power management...");
 
     // Configure watchdog timer
     esp_task_wdt_init(300, true);
@@ -358,7 +688,7 @@ void setupPowerManagement() {
 }
 
 bool connectToWiFi() {
-    Debug("Connecting to WiFi: " + String(WIFI_SSID) + "\r\n");
+    LOG_I("Connecting to WiFi: %s", WIFI_SSID);
 
     WiFi.mode(WIFI_STA);
     WiFi.setSleep(true);
@@ -367,86 +697,168 @@ bool connectToWiFi() {
     int attempts = 0;
     while (WiFi.status() != WL_CONNECTED && attempts < 20) {
         delay(500);
-        Debug(".");
         attempts++;
         esp_task_wdt_reset();
     }
 
     if (WiFi.status() == WL_CONNECTED) {
-        Debug("\r\nWiFi connected!\r\n");
-        Debug("IP address: " + WiFi.localIP().toString() + "\r\n");
-        Debug("Signal strength: " + String(WiFi.RSSI()) + " dBm\r\n");
+        LOG_I("WiFi connected after %d attempts", attempts);
+        LOG_I("IP address: %s", WiFi.localIP().toString().c_str());
+        LOG_I("Signal strength: %d dBm", (int)WiFi.RSSI());
         return true;
     }
 
-    Debug("\r\nWiFi connection failed!\r\n");
+    LOG_W("WiFi connection failed!");
     return false;
 }
 
 bool downloadAndDisplayImage() {
-    Debug("=== DOWNLOADING IMAGE FROM SERVER ===\r\n");
+    LOG_I("=== DOWNLOADING IMAGE FROM SERVER ===");
 
     if (downloadImageToPSRAM(true, nullptr)) {
         return true;
     }
 
     // If PSRAM download fails, try server's processed image endpoint
-    Debug("PSRAM download failed, trying processed image from server\r\n");
+    LOG_W("PSRAM download failed, trying processed image from server");
 
-    HTTPClient http;
-    String url = buildApiUrl("current.json", SERVER_HOST);
-    http.begin(url);
-    http.setTimeout(60000);
-    http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
+    CurrentJsonDocument doc;
+    int httpResponseCode = 0;
+    bool fetched = fetchCurrentJson(doc, 60000, &httpResponseCode);
+    LOG_D("HTTP response: %d", httpResponseCode);
 
-    int httpResponseCode = http.GET();
-    Debug("HTTP response: " + String(httpResponseCode) + "\r\n");
+    if (fetched && (doc["hasImage"] | false)) {
+        LOG_I("Server has image available");
+        return downloadImageToPSRAM(true, nullptr);
+    }
+    return false;
+}
 
-    if (httpResponseCode == 200) {
-        String payload = http.getString();
-        http.end();
+// Packs an RGB888 stream into panel pixels. Each row is assembled in an
+// internal SRAM buffer and copied to the frame (PSRAM) in one memcpy, so
+// PSRAM only sees sequential burst writes instead of a read-modify-write
+// per pixel. Triplets split across reads are carried over.
+struct RgbRowPacker {
+    static const int RowBytes = DISPLAY_WIDTH / 2;
+
+    uint8_t* frame;
+    int pixel = 0; // pixels packed so far
+    uint8_t row[RowBytes];
+    uint8_t carry[3];
+    int carryLength = 0;
+
+    explicit RgbRowPacker(uint8_t* frame) : frame(frame) {}
+
+    void put(uint8_t r, uint8_t g, uint8_t b) {
+        int x = pixel % DISPLAY_WIDTH;
+#if DITHER_BLUE_NOISE
+        uint8_t color = ditherRGBToEink(r, g, b, x, pixel / DISPLAY_WIDTH);
+#else
+        uint8_t color = mapRGBToEink(r, g, b);
+#endif
+        if (x & 1) {
+            row[x / 2] |= color;
+        } else {
+            row[x / 2] = color << 4;
+        }
+        pixel++;
+        if (x == DISPLAY_WIDTH - 1) {
+            memcpy(frame + (pixel / DISPLAY_WIDTH - 1) * RowBytes, row, RowBytes);
+        }
+    }
 
-        DynamicJsonDocument doc(1024);
-        DeserializationError error = deserializeJson(doc, payload);
+    void push(const uint8_t* rgb, size_t length) {
+        const int total = DISPLAY_WIDTH * DISPLAY_HEIGHT;
+        while (carryLength > 0 && length > 0) {
+            carry[carryLength++] = *rgb++;
+            length--;
+            if (carryLength == 3) {
+                if (pixel < total) put(carry[0], carry[1], carry[2]);
+                carryLength = 0;
+            }
+        }
+        for (; length >= 3 && pixel < total; rgb += 3, length -= 3) {
+            put(rgb[0], rgb[1], rgb[2]);
+        }
+        if (pixel < total) {
+            while (length > 0) carry[carryLength++] = *rgb++, length--;
+        }
+    }
 
-        if (!error && doc.containsKey("hasImage") && doc["hasImage"]) {
-            Debug("Server has image available\r\n");
-            return downloadImageToPSRAM(true, nullptr);
+    // Copy out a partly filled last row
+    void finish() {
+        int x = pixel % DISPLAY_WIDTH;
+        if (x > 0) {
+            memcpy(frame + (pixel / DISPLAY_WIDTH) * RowBytes, row, (x + 1) / 2);
         }
     }
+};
 
-    http.end();
-    return false;
+#ifdef PSRAM_WRITE_BENCHMARK
+// Frame write throughput of the old per-pixel nibble writes straight into
+// PSRAM against rows staged in SRAM, colour mapping left out
+void benchmarkFrameWrites(uint8_t* frame) {
+    const int total = DISPLAY_WIDTH * DISPLAY_HEIGHT;
+    uint8_t row[RgbRowPacker::RowBytes];
+
+    int64_t t0 = esp_timer_get_time();
+    for (int p = 0; p < total; p++) {
+        uint8_t color = p & 0x7;
+        if (p & 1) {
+            frame[p / 2] |= color;
+        } else {
+            frame[p / 2] = color << 4;
+        }
+    }
+    int64_t direct = esp_timer_get_time() - t0;
+    esp_task_wdt_reset();
+
+    t0 = esp_timer_get_time();
+    for (int p = 0; p < total; p++) {
+        int x = p % DISPLAY_WIDTH;
+        uint8_t color = p & 0x7;
+        if (x & 1) {
+            row[x / 2] |= color;
+        } else {
+            row[x / 2] = color << 4;
+        }
+        if (x == DISPLAY_WIDTH - 1) {
+            memcpy(frame + (p / DISPLAY_WIDTH) * RgbRowPacker::RowBytes, row, sizeof(row));
+        }
+    }
+    int64_t staged = esp_timer_get_time() - t0;
+    esp_task_wdt_reset();
+
+    // bytes per microsecond == MB/s. The frame falls back to internal RAM
+    // without PSRAM, which makes the figures meaningless for this comparison.
+    LOG_I("Frame writes to %s: direct %.2f MB/s (%u ms), SRAM-staged rows %.2f MB/s (%u ms), %.1fx",
+          esp_ptr_external_ram(frame) ? "PSRAM" : "internal RAM",
+          (double)IMAGE_BUFFER_SIZE / direct, (unsigned)(direct / 1000),
+          (double)IMAGE_BUFFER_SIZE / staged, (unsigned)(staged / 1000), (double)direct / staged);
 }
+#endif
 
-bool downloadImageToPSRAM(bool displayNow, uint8_t** outBuffer) {
-    Debug("=== DOWNLOADING IMAGE (STREAMING) ===\r\n");
-    Debug("Regular heap: " + String(ESP.getFreeHeap()) + " bytes\r\n");
-    Debug("PSRAM free: " + String(ESP.getFreePsram()) + " bytes\r\n");
-    Debug("Heap caps PSRAM: " + String(heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) + " bytes\r\n");
+bool downloadImageToPSRAM(bool displayNow, FrameBuffer* outBuffer) {
+    LOG_I("=== DOWNLOADING IMAGE (STREAMING) ===");
+    LOG_D("Regular heap: %u bytes", (unsigned)ESP.getFreeHeap());
+    LOG_D("PSRAM free: %u bytes", (unsigned)ESP.getFreePsram());
+    LOG_D("Heap caps PSRAM: %u bytes", (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
 
     const int EINK_BUFFER_SIZE = IMAGE_BUFFER_SIZE; // 960KB
     const int CHUNK_SIZE = 4096; // 4KB chunks for streaming
 
-    uint8_t* einkBuffer = nullptr;
+    FrameBuffer frame;
     uint8_t* rgbChunk = nullptr;
 
-    // Allocate e-ink buffer in PSRAM
-    if (ESP.getFreePsram() > EINK_BUFFER_SIZE) {
-        einkBuffer = (uint8_t*)ps_malloc(EINK_BUFFER_SIZE);
-    }
-    if (!einkBuffer && heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > EINK_BUFFER_SIZE) {
-        einkBuffer = (uint8_t*)heap_caps_malloc(EINK_BUFFER_SIZE, MALLOC_CAP_SPIRAM);
-    }
-    if (!einkBuffer) {
-        einkBuffer = (uint8_t*)malloc(EINK_BUFFER_SIZE);
-    }
-
-    if (!einkBuffer) {
-        Debug("ERROR: Cannot allocate e-ink buffer!\r\n");
+    // Both download formats write every byte, so the buffer is not cleared
+    if (!frame.allocate(FrameBuffer::Psram)) {
+        LOG_E("Cannot allocate e-ink buffer!");
         sendLogToServer("ERROR: Memory allocation failed for e-ink buffer", "ERROR");
         return false;
     }
+#ifdef PSRAM_WRITE_BENCHMARK
+    benchmarkFrameWrites(frame.data());
+#endif
 
     // Download raw binary image data
     HTTPClient http;
@@ -455,67 +867,62 @@ bool downloadImageToPSRAM(bool displayNow, uint8_t** outBuffer) {
     // Try dev server first if dev mode is enabled
     if (devServerHost.length() > 0) {
         serverToUse = devServerHost;
-        Debug("Trying dev server: " + serverToUse + "\r\n");
+        LOG_I("Trying dev server: %s", serverToUse.c_str());
     }
 
     String url = buildApiUrl("image.bin", serverToUse);
-    http.begin(url);
+#if DITHER_BLUE_NOISE
+    url += "?" DITHER_PARAM;
+#endif
+    beginApiRequest(http, url);
     http.setTimeout(60000);
     http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
 
     int httpCode = http.GET();
-    Debug("Image download response: " + String(httpCode) + "\r\n");
+    LOG_D("Image download response: %d", httpCode);
 
     // If dev server failed, try production fallback
     if (httpCode != HTTP_CODE_OK && devServerHost.length() > 0) {
-        Debug("Dev server failed, falling back to production\r\n");
+        LOG_W("Dev server failed, falling back to production");
         http.end();
         usedFallback = true;
 
         serverToUse = SERVER_HOST;
         url = buildApiUrl("image.bin", serverToUse);
-        http.begin(url);
+#if DITHER_BLUE_NOISE
+        url += "?" DITHER_PARAM;
+#endif
+        beginApiRequest(http, url);
         http.setTimeout(60000);
         http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
         httpCode = http.GET();
-        Debug("Production server response: " + String(httpCode) + "\r\n");
+        LOG_D("Production server response: %d", httpCode);
     }
 
     if (httpCode != HTTP_CODE_OK) {
-        Debug("Download failed with code: " + String(httpCode) + "\r\n");
-        String errMsg = "ERROR: Image download failed with HTTP code " + String(httpCode);
-        sendLogToServer(errMsg.c_str(), "ERROR");
-        if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
-            heap_caps_free(einkBuffer);
-        } else {
-            free(einkBuffer);
-        }
+        LOG_W("Download failed with code: %d", httpCode);
+        sendLogToServerf("ERROR", "ERROR: Image download failed with HTTP code %d", httpCode);
         http.end();
         return false;
     }
 
     int contentLength = http.getSize();
-    Debug("Content length: " + String(contentLength) + " bytes\r\n");
+    LOG_D("Content length: %d bytes", contentLength);
 
     // Check if this is a packed E-ink binary (960KB) or RGB stream (5.7MB)
     bool isPackedBinary = (contentLength == EINK_BUFFER_SIZE);
 
     if (isPackedBinary) {
-        Debug("Detected PACKED E-INK binary (960KB). Downloading directly...\r\n");
+        LOG_D("Detected PACKED E-INK binary (960KB). Downloading directly...");
         sendLogToServer("Downloading packed e-ink binary directly");
     } else {
-        Debug("Detected RGB stream. Allocating RGB chunk buffer...\r\n");
+        LOG_D("Detected RGB stream. Allocating RGB chunk buffer...");
         sendLogToServer("Downloading and converting RGB stream");
 
-        rgbChunk = (uint8_t*)malloc(CHUNK_SIZE);
+        rgbChunk = (uint8_t*)heap_caps_malloc(CHUNK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
         if (!rgbChunk) {
-            Debug("ERROR: Cannot allocate RGB chunk buffer!\r\n");
+            LOG_E("Cannot allocate RGB chunk buffer!");
             sendLogToServer("ERROR: RGB chunk allocation failed", "ERROR");
-            if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
-                heap_caps_free(einkBuffer);
-            } else {
-                free(einkBuffer);
-            }
             http.end();
             return false;
         }
@@ -523,11 +930,9 @@ bool downloadImageToPSRAM(bool displayNow, uint8_t** outBuffer) {
 
     // Stream data
     WiFiClient* stream = http.getStreamPtr();
+    uint8_t* einkBuffer = frame.data();
+    RgbRowPacker packer(einkBuffer);
     int totalBytesRead = 0;
-    int pixelIndex = 0;
-
-    // Clear e-ink buffer
-    memset(einkBuffer, 0, EINK_BUFFER_SIZE);
 
     while (http.connected() && (totalBytesRead < contentLength || contentLength == -1)) {
         size_t available = stream->available();
@@ -544,34 +949,13 @@ bool downloadImageToPSRAM(bool displayNow, uint8_t** outBuffer) {
                 }
             } else {
                 int readSize = min((int)available, CHUNK_SIZE);
-                readSize = (readSize / 3) * 3; // Align to RGB triplets
-                if (readSize < 3) readSize = 3;
-
                 int bytesRead = stream->readBytes(rgbChunk, readSize);
                 totalBytesRead += bytesRead;
-
-                for (int i = 0; i < bytesRead && pixelIndex < (DISPLAY_WIDTH * DISPLAY_HEIGHT); i += 3) {
-                    if (i + 2 < bytesRead) {
-                        uint8_t r = rgbChunk[i];
-                        uint8_t g = rgbChunk[i + 1];
-                        uint8_t b = rgbChunk[i + 2];
-                        uint8_t einkColor = mapRGBToEink(r, g, b);
-
-                        int einkByteIndex = pixelIndex / 2;
-                        bool isEvenPixel = (pixelIndex % 2) == 0;
-
-                        if (isEvenPixel) {
-                            einkBuffer[einkByteIndex] = (einkColor << 4);
-                        } else {
-                            einkBuffer[einkByteIndex] |= einkColor;
-                        }
-                        pixelIndex++;
-                    }
-                }
+                packer.push(rgbChunk, bytesRead);
             }
 
             if (totalBytesRead % 200000 == 0) {
-                Debug("Streamed: " + String(totalBytesRead / 1024) + "KB\r\n");
+                LOG_D("Streamed: %dKB", totalBytesRead / 1024);
                 esp_task_wdt_reset();
             }
         } else {
@@ -581,7 +965,7 @@ bool downloadImageToPSRAM(bool displayNow, uint8_t** outBuffer) {
     }
 
     http.end();
-    Debug("Download complete. Total read: " + String(totalBytesRead) + " bytes\r\n");
+    LOG_I("Download complete. Total read: %d bytes", totalBytesRead);
 
     bool success = false;
     if (isPackedBinary) {
@@ -589,65 +973,326 @@ bool downloadImageToPSRAM(bool displayNow, uint8_t** outBuffer) {
             success = true;
         }
     } else {
-        if (pixelIndex >= (DISPLAY_WIDTH * DISPLAY_HEIGHT * 0.9)) {
+        packer.finish();
+        if (packer.pixel >= (DISPLAY_WIDTH * DISPLAY_HEIGHT * 0.9)) {
             success = true;
+            // Pixels the stream came up short on show as black
+            int written = (packer.pixel + 1) / 2;
+            memset(einkBuffer + written, 0, EINK_BUFFER_SIZE - written);
         }
     }
 
     if (!success) {
-        Debug("ERROR: Incomplete download\r\n");
-        if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
-            heap_caps_free(einkBuffer);
-        } else {
-            free(einkBuffer);
-        }
-        if (rgbChunk) free(rgbChunk);
+        LOG_E("Incomplete download");
+        heap_caps_free(rgbChunk);
         return false;
     }
 
     if (displayNow) {
-        Debug("Displaying image...\r\n");
+        LOG_I("Displaying image...");
         sendLogToServer("Rendering image to display (30-45s)");
 
         delay(2000);
         esp_task_wdt_reset();
 
-        EPD_13IN3E_Display(einkBuffer);
-        Debug("SUCCESS: Image displayed!\r\n");
+        EPD_13IN3E_Display(frame.frame());
+        LOG_I("SUCCESS: Image displayed!");
         sendLogToServer("Image successfully displayed");
-
-        if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
-            heap_caps_free(einkBuffer);
-        } else {
-            free(einkBuffer);
-        }
     } else if (outBuffer != nullptr) {
-        *outBuffer = einkBuffer;
-        Debug("Image downloaded to buffer, not displaying yet\r\n");
-    } else {
-        if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
-            heap_caps_free(einkBuffer);
-        } else {
-            free(einkBuffer);
-        }
+        *outBuffer = std::move(frame);
+        LOG_I("Image downloaded to buffer, not displaying yet");
     }
 
-    if (rgbChunk) free(rgbChunk);
+    heap_caps_free(rgbChunk);
     return success;
 }
 
-// Cleanly power down the e-paper panel and cut its power rail
-void powerDownDisplay() {
-    Debug("Powering down e-Paper panel...\r\n");
+// Fetch the current display list (see DisplayList.h) and render it into a
+// newly allocated frame buffer
+bool downloadDisplayList(FrameBuffer* outBuffer) {
+    LOG_I("=== DOWNLOADING DISPLAY LIST ===");
+
+    HTTPClient http;
+    String url = buildApiUrl("display-list.bin", SERVER_HOST);
+    beginApiRequest(http, url);
+    http.setTimeout(30000);
+    http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
+
+    int httpCode = http.GET();
+    int contentLength = http.getSize();
+    if (httpCode != HTTP_CODE_OK || contentLength <= 0 || contentLength > DISPLAY_LIST_MAX_SIZE) {
+        LOG_W("Display list download failed: %d, %d bytes", httpCode, contentLength);
+        http.end();
+        return false;
+    }
+
+    uint8_t* list = (uint8_t*)malloc(contentLength);
+    if (!list) {
+        http.end();
+        return false;
+    }
+    int bytesRead = http.getStreamPtr()->readBytes(list, contentLength);
+    http.end();
+    LOG_I("Display list: %d bytes", bytesRead);
+
+    // Rendering starts with Paint_Clear, no need to clear it here
+    FrameBuffer frame;
+    bool success = frame.allocate(FrameBuffer::Psram) && bytesRead == contentLength &&
+                   displayListRender(list, bytesRead, frame.data());
+    free(list);
+
+    if (!success) {
+        sendLogToServer("ERROR: Display list could not be rendered", "ERROR");
+        return false;
+    }
+
+    *outBuffer = std::move(frame);
+    return true;
+}
+
+// Panel lines latched high through deep sleep while the controller is kept
+// powered: rail on, out of reset, not selected
+static const int panelHeldPins[] = { EPD_PWR_PIN, EPD_RST_PIN, EPD_CS_M_PIN, EPD_CS_S_PIN };
+
+void holdPanelPins() {
+    for (int pin : panelHeldPins) {
+        digitalWrite(pin, HIGH);
+        pinMode(pin, OUTPUT);
+        gpio_hold_en((gpio_num_t)pin);
+    }
+    gpio_deep_sleep_hold_en();
+}
+
+void releasePanelPins() {
+    for (int pin : panelHeldPins) {
+        gpio_hold_dis((gpio_num_t)pin);
+    }
+}
+
+// Get the panel ready for a frame: a reset and full init after its rail was
+// cut, or just the bus if the controller kept its registers (PANEL_RETAIN).
+// False if the SPI bus could not be set up; the panel is left as it was.
+bool panelPowerUp() {
+    if (panelPowered) return true; // still up from an earlier frame this wake
+    uint32_t start = millis();
+    if (DEV_Module_Init() != 0) {
+        LOG_E("Panel bus init failed");
+        // A retained controller's pins are still latched; a cold one was
+        // never initialized, so its rail can go straight back off
+        if (!panelRetained) digitalWrite(EPD_PWR_PIN, LOW);
+        return false;
+    }
+    panelPowered = true;
+    if (panelRetained) {
+        // Pins are still latched, so reconfiguring them cannot glitch RST
+        digitalWrite(EPD_RST_PIN, HIGH);
+        releasePanelPins();
+        tunePanelSpiClock(false);
+        if (EPD_13IN3E_Resume()) {
+            LOG_I("Panel resumed from standby in %u ms", (unsigned)(millis() - start));
+            recordPhase("panelResume", start);
+            return true;
+        }
+        LOG_W("Panel did not resume, initializing it");
+        panelRetained = false;
+    }
+    tunePanelSpiClock(true);
+    delay(2000);
+    EPD_13IN3E_Init();
+    delay(2000);
+    panelColdInitMs = millis() - start;
+    recordPhase("panelInit", start);
+    return true;
+}
+
+// Whether keeping the controller powered through this sleep costs less than
+// initializing it again afterwards
+bool panelRetainFor(uint64_t sleepTime) {
+#if PANEL_RETAIN == 1
+    return true;
+#elif PANEL_RETAIN == 2
+    if (externalPower) return true;
+    uint32_t initMs = panelColdInitMs ? panelColdInitMs : PANEL_INIT_ESTIMATE_MS;
+    // ms * mA / uA == s
+    uint64_t breakEvenS = (uint64_t)initMs * PANEL_INIT_MA / PANEL_STANDBY_UA;
+    return sleepTime / 1000000ULL < breakEvenS;
+#else
+    return false;
+#endif
+}
+
+// Power the e-paper panel down for a sleep of sleepTime (0: for good, e.g.
+// a restart): standby with the rail on where PANEL_RETAIN finds that
+// cheaper, otherwise DSLP and rail cut. Decided while the bus is still up,
+// so a controller never loses power without DSLP.
+void powerDownDisplay(uint64_t sleepTime) {
+    bool retain = sleepTime > 0 && panelRetainFor(sleepTime);
+    if (panelRetained && !panelPowered) {
+        // Still in standby from the last sleep, untouched this wake
+        if (retain) return;
+        if (DEV_Module_Init() != 0) {
+            // No DSLP without the bus; the rail stays on rather than cut under it
+            LOG_E("Panel bus init failed, leaving panel in standby");
+            return;
+        }
+        LOG_I("Cutting panel power for this sleep");
+        digitalWrite(EPD_RST_PIN, HIGH);
+        releasePanelPins();
+        panelPowered = true;
+    }
+    if (!panelPowered) return;
+    panelPowered = false;
+
+    if (retain) {
+        LOG_I("Leaving e-Paper panel in standby");
+        DEV_Module_Standby();
+        panelRetained = true;
+        return;
+    }
+    LOG_I("Powering down e-Paper panel...");
     EPD_13IN3E_Sleep();
     DEV_Module_Exit();
     pinMode(EPD_PWR_PIN, OUTPUT);
     digitalWrite(EPD_PWR_PIN, LOW);
+    panelRetained = false;
+}
+
+// A frame is up. Without PANEL_RETAIN the panel is powered down right away;
+// otherwise enterDeepSleep() does it once the length of the sleep is known.
+void panelUpdateDone() {
+#if !PANEL_RETAIN
+    powerDownDisplay(0);
+#endif
+}
+
+// Draw a frame straight from the flash frame store, without WiFi or PSRAM
+bool displayStoredFrame(int slot, bool clearFirst) {
+    FrameBuffer frame;
+    if (!frame.map(slot)) {
+        LOG_I("No stored frame in slot %d", slot);
+        return false;
+    }
+
+    LOG_I("Displaying stored frame from slot %d...", slot);
+    if (!panelPowerUp()) return false;
+    if (clearFirst) {
+        EPD_13IN3E_Clear(EINK_WHITE);
+        delay(1000);
+    }
+    esp_task_wdt_reset();
+    EPD_13IN3E_Display(frame.frame());
+    frame.release();
+    LOG_I("SUCCESS: Stored frame displayed!");
+
+    panelUpdateDone();
+    return true;
+}
+
+// Fetch the next piece of a pending firmware update; true once it can be installed
+bool fetchFirmwareUpdate() {
+#if OTA_BYTES_PER_WAKE > 0
+    uint32_t phaseStart = millis();
+    bool ready = otaDownload(FIRMWARE_VERSION, buildApiUrl("", SERVER_HOST), beginApiRequest, OTA_BYTES_PER_WAKE);
+    recordPhase("ota", phaseStart);
+    return ready;
+#else
+    return false;
+#endif
+}
+
+// Top up the offline bundle (see Bundle.h) once it is running low. The
+// response also carries the server's clock, which the schedule runs on.
+void fetchBundle() {
+#if BUNDLE_LOW_WATER > 0
+    if (clockSynced && bundlePendingCount(time(nullptr)) >= BUNDLE_LOW_WATER) {
+        return;
+    }
+    int capacity = bundleCapacity(lastDisplayedSlot);
+    if (capacity <= 0) return;
+
+    LOG_I("Fetching bundle...");
+    uint32_t phaseStart = millis();
+    HTTPClient http;
+    String url = buildApiUrl("bundle.bin", SERVER_HOST) + "?count=" + String(capacity);
+#if DITHER_BLUE_NOISE
+    url += "&" DITHER_PARAM;
+#endif
+    beginApiRequest(http, url);
+    http.setTimeout(60000);
+    http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
+
+    int httpCode = http.GET();
+    if (httpCode == HTTP_CODE_OK) {
+        uint32_t serverTime = 0;
+        int stored = bundleReceive(http.getStreamPtr(), lastDisplayedSlot, &serverTime);
+        if (serverTime != 0) {
+            struct timeval tv = { (time_t)serverTime, 0 };
+            settimeofday(&tv, nullptr);
+            clockSynced = true;
+        }
+        sendLogToServerf("INFO", "Bundle: stored %d frames", stored);
+    } else {
+        LOG_W("Bundle fetch failed: %d", httpCode);
+    }
+    http.end();
+    recordPhase("bundle", phaseStart);
+#endif
+}
+
+// Sleep duration to reach `wakeAt` on the system clock
+uint64_t sleepUntil(time_t wakeAt) {
+    time_t now = time(nullptr);
+    if (wakeAt <= now) return MIN_SLEEP_TIME;
+    uint64_t duration = (uint64_t)(wakeAt - now + 2) * 1000000ULL; // land just after it is due
+    if (duration > MAX_OFFLINE_SLEEP) duration = MAX_OFFLINE_SLEEP;
+    return duration > MIN_SLEEP_TIME ? duration : MIN_SLEEP_TIME;
+}
+
+// Time left until the timer wake that a button press interrupted
+uint64_t remainingSleepTime() {
+    time_t now = time(nullptr);
+    if (scheduledWakeTime == 0 || scheduledWakeTime <= now) {
+        return MIN_SLEEP_TIME;
+    }
+    uint64_t remaining = (uint64_t)(scheduledWakeTime - now) * 1000000ULL;
+    return remaining > MIN_SLEEP_TIME ? remaining : MIN_SLEEP_TIME;
+}
+
+// Use the fastest panel SPI clock this unit's wiring has been verified for.
+// Calibration runs once and the result is kept in NVS. It resets the
+// controller, so a panel resumed from standby (calibrate false) keeps the
+// default clock until its next cold init.
+void tunePanelSpiClock(bool calibrate) {
+#if EPD_USE_HW_SPI
+    Preferences prefs;
+    prefs.begin("panel", false);
+    uint32_t spiHz = prefs.getUInt("spiHz", 0);
+    if (spiHz == 0 && !calibrate) {
+        LOG_D("Panel SPI clock not calibrated yet, keeping the default");
+    } else if (spiHz == 0) {
+        LOG_I("Calibrating panel SPI clock...");
+        UDOUBLE calibrated;
+        if (!EPD_13IN3E_CalibrateClock(&calibrated)) {
+            LOG_E("Panel SPI calibration aborted, retrying next cold init");
+        } else {
+            // No readback on this panel: keep the default, don't retry every wake
+            spiHz = calibrated ? calibrated : DEV_SPI_GetClock();
+            prefs.putUInt("spiHz", spiHz);
+        }
+    } else if (!DEV_SPI_SetClock(spiHz)) {
+        LOG_E("Panel SPI clock %u kHz could not be set", (unsigned)(spiHz / 1000));
+    }
+    prefs.end();
+    LOG_I("Panel SPI clock: %u kHz", (unsigned)(DEV_SPI_GetClock() / 1000));
+#endif
 }
 
 // Cleanly shut down WiFi/BT to minimize sleep current
 void teardownRadios() {
-    Debug("Shutting down radios...\r\n");
+    LOG_I("Shutting down radios...");
+#if SERVER_TLS
+    tlsClose();
+#endif
     WiFi.disconnect(true, true);
     WiFi.mode(WIFI_OFF);
     esp_wifi_stop();
@@ -655,75 +1300,236 @@ void teardownRadios() {
 }
 
 void reportDeviceStatus(const char *status, float batteryVoltage, int signalStrength, int batteryPercent, bool isCharging) {
-    Debug("Reporting status: " + String(status) + "\r\n");
+    LOG_D("Reporting status: %s", status);
+
+    DeviceStatus report;
+    report.deviceId = DEVICE_ID;
+    report.status = status;
+    report.batteryVoltage = batteryVoltage;
+    report.batteryPercent = batteryPercent;
+    report.isCharging = isCharging;
+    report.signalStrength = signalStrength;
+    report.firmwareVersion = FIRMWARE_VERSION;
+    report.freeHeap = ESP.getFreeHeap();
+    report.psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    report.uptime = millis();
+    report.bootCount = bootCount;
+    report.usedFallback = usedFallback;
+    telemetryRecordStatus(&wakeSummary, report);
+#if TELEMETRY_UDP_PORT
+    return;
+#endif
+
+    uint8_t body[TELEMETRY_MAX_SIZE];
+    size_t bodyLength = telemetryEncodeStatus(body, sizeof(body), report);
+    if (bodyLength == 0) {
+        LOG_E("Status report does not fit in %u bytes, not sent", (unsigned)sizeof(body));
+        return;
+    }
 
     HTTPClient http;
     String url = buildApiUrl("device-status", SERVER_HOST);
-    http.begin(url);
+    beginApiRequest(http, url);
     http.setTimeout(10000);
-    http.addHeader("Content-Type", "application/json");
+    http.addHeader("Content-Type", TELEMETRY_CONTENT_TYPE);
     http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
 
-    DynamicJsonDocument doc(1024);
-    doc["deviceId"] = DEVICE_ID;
-
-    JsonObject statusObj = doc.createNestedObject("status");
-    statusObj["status"] = status;
-    statusObj["batteryVoltage"] = batteryVoltage;
-    statusObj["batteryPercent"] = batteryPercent;
-    statusObj["isCharging"] = isCharging;
-    statusObj["signalStrength"] = signalStrength;
-    statusObj["firmwareVersion"] = FIRMWARE_VERSION;
-    statusObj["freeHeap"] = ESP.getFreeHeap();
-    statusObj["psramFree"] = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-    statusObj["uptime"] = millis();
-    statusObj["bootCount"] = bootCount;
-    statusObj["usedFallback"] = usedFallback;
-
-    String jsonString;
-    serializeJson(doc, jsonString);
-
-    int httpCode = http.POST(jsonString);
+    int httpCode = http.POST(body, bodyLength);
     if (httpCode > 0) {
-        Debug("Status reported: " + String(httpCode) + "\r\n");
+        LOG_D("Status reported: %d", httpCode);
     } else {
-        Debug("Status report failed: " + String(httpCode) + "\r\n");
+        LOG_W("Status report failed: %d", httpCode);
     }
 
     http.end();
 }
 
-void sendLogToServer(const char *message, const char *level) {
-    Debug("Log: " + String(message) + "\r\n");
+static void postLog(HTTPClient &http, const char *message, const char *level) {
+    uint8_t body[TELEMETRY_MAX_SIZE];
+    size_t bodyLength = telemetryEncodeLog(body, sizeof(body), DEVICE_ID, message, level, millis());
+    if (bodyLength == 0) {
+        LOG_E("Log message does not fit in %u bytes, not sent", (unsigned)sizeof(body));
+        return;
+    }
 
-    HTTPClient http;
     String url = buildApiUrl("logs", SERVER_HOST);
-    http.begin(url);
+    beginApiRequest(http, url);
     http.setTimeout(5000);
-    http.addHeader("Content-Type", "application/json");
+    http.addHeader("Content-Type", TELEMETRY_CONTENT_TYPE);
     http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
 
-    DynamicJsonDocument doc(1024);
-    doc["deviceId"] = DEVICE_ID;
-    doc["logs"] = message;
-    doc["logLevel"] = level;
-    doc["deviceTime"] = millis();
+    http.POST(body, bodyLength);
+    http.end();
+}
 
-    String jsonString;
-    serializeJson(doc, jsonString);
+void sendLogToServer(const char *message, const char *level) {
+    LOG_D("Log: %s", message);
+
+    if (deferLogs || TELEMETRY_UDP_PORT) {
+        portENTER_CRITICAL(&pendingLogLock);
+        if (pendingLogCount == LOG_QUEUE_LENGTH) {
+            // Full: drop the oldest
+            pendingLogHead = (pendingLogHead + 1) % LOG_QUEUE_LENGTH;
+            pendingLogCount--;
+            pendingLogDropped++;
+        }
+        PendingLog &entry = pendingLogs[(pendingLogHead + pendingLogCount) % LOG_QUEUE_LENGTH];
+        strlcpy(entry.level, level, sizeof(entry.level));
+        strlcpy(entry.message, message, sizeof(entry.message));
+        pendingLogCount++;
+        portEXIT_CRITICAL(&pendingLogLock);
+        return;
+    }
 
-    int httpCode = http.POST(jsonString);
-    http.end();
+    HTTPClient http;
+    postLog(http, message, level);
+}
+
+// sendLogToServer() with a printf format, formatted on the stack to the
+// length a queued message keeps anyway
+void sendLogToServerf(const char *level, const char *fmt, ...) {
+    char message[LOG_QUEUE_MESSAGE];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+    sendLogToServer(message, level);
+}
+
+// Post queued logs in order over one kept-alive connection. With UDP
+// telemetry they stay queued for the wake summary.
+void flushLogs() {
+    HTTPClient http;
+    http.setReuse(true);
+
+#if TELEMETRY_UDP_PORT == 0
+    PendingLog entry;
+    for (;;) {
+        portENTER_CRITICAL(&pendingLogLock);
+        bool empty = (pendingLogCount == 0);
+        if (!empty) {
+            entry = pendingLogs[pendingLogHead];
+            pendingLogHead = (pendingLogHead + 1) % LOG_QUEUE_LENGTH;
+            pendingLogCount--;
+        }
+        portEXIT_CRITICAL(&pendingLogLock);
+        if (empty) break;
+
+        postLog(http, entry.message, entry.level);
+    }
+#endif
+
+#if LOG_DEFERRED
+    // Serial output is not formatted in this build; ship the raw ring for
+    // tools/logdecode.py to expand against the firmware ELF.
+    static uint32_t ring[LOG_RING_WORDS + 2];
+    size_t words = logRingRead(ring, LOG_RING_WORDS + 2);
+    if (words > 2) {
+        beginApiRequest(http, buildApiUrl("logs/ring", SERVER_HOST));
+        http.setTimeout(5000);
+        http.addHeader("Content-Type", "application/octet-stream");
+        http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
+        http.addHeader("X-Device-Id", DEVICE_ID);
+#ifdef DEBUG_UPLOAD_TOKEN
+        http.addHeader("Authorization", "Bearer " DEBUG_UPLOAD_TOKEN);
+#endif
+        int httpCode = http.POST((uint8_t *)ring, words * sizeof(uint32_t));
+        http.end();
+        // Kept for the next wake's upload unless the server has it
+        if (httpCode >= 200 && httpCode < 300) logRingConsume(ring[1]);
+    }
+#endif
+}
+
+void recordPhase(const char *name, uint32_t startMs) {
+    telemetryRecordPhase(&wakeSummary, name, millis() - startMs);
+#if CAPTURE_SESSION
+    captureMark(name, millis() - startMs);
+#endif
+}
+
+#if CAPTURE_SESSION
+// Post this wake's capture (Capture.h), then take down the radios that
+// were left up for it. Recording stops first, so the
+// upload is not part of the capture.
+void uploadCapture() {
+    size_t length = 0;
+    const uint8_t *capture = captureFinish(&length);
+    if (WiFi.status() != WL_CONNECTED) return;
+    if (capture) {
+        HTTPClient http;
+        beginApiRequest(http, buildApiUrl("capture", SERVER_HOST));
+        http.setTimeout(60000);
+        http.addHeader("Content-Type", "application/octet-stream");
+        http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
+        http.addHeader("X-Device-Id", DEVICE_ID);
+#ifdef DEBUG_UPLOAD_TOKEN
+        http.addHeader("Authorization", "Bearer " DEBUG_UPLOAD_TOKEN);
+#endif
+        int httpCode = http.POST((uint8_t *)capture, length);
+        LOG_I("Capture upload: %d", httpCode);
+        http.end();
+    }
+    teardownRadios();
+}
+#endif
+
+// One datagram with the status transitions, phase timings and queued logs
+// of this wake. Fire and forget: nothing waits for an answer.
+void sendWakeSummary() {
+    static PendingLog entries[LOG_QUEUE_LENGTH];
+    const char *levels[LOG_QUEUE_LENGTH];
+    const char *messages[LOG_QUEUE_LENGTH];
+
+    // Take the queued entries out whole: another task logging meanwhile
+    // would otherwise overwrite a full queue's oldest slot under the encoder
+    portENTER_CRITICAL(&pendingLogLock);
+    size_t count = pendingLogCount;
+    uint32_t dropped = pendingLogDropped;
+    for (size_t i = 0; i < count; i++) {
+        entries[i] = pendingLogs[(pendingLogHead + i) % LOG_QUEUE_LENGTH];
+    }
+    pendingLogHead = (pendingLogHead + count) % LOG_QUEUE_LENGTH;
+    pendingLogCount = 0;
+    pendingLogDropped = 0;
+    portEXIT_CRITICAL(&pendingLogLock);
+
+    for (size_t i = 0; i < count; i++) {
+        levels[i] = entries[i].level;
+        messages[i] = entries[i].message;
+    }
+    static uint8_t datagram[TELEMETRY_DATAGRAM_SIZE];
+    size_t length = telemetryEncodeWake(datagram, sizeof(datagram), wakeSummary, levels, messages, count, dropped);
+
+    if (length == 0) {
+        LOG_W("Wake summary does not fit in a datagram");
+        return;
+    }
+
+    String host = SERVER_HOST;
+    int colon = host.indexOf(':');
+    if (colon >= 0) host = host.substring(0, colon);
+
+    WiFiUDP udp;
+    if (udp.beginPacket(host.c_str(), TELEMETRY_UDP_PORT) &&
+        udp.write(datagram, length) == length && udp.endPacket()) {
+        LOG_D("Wake summary sent: %u bytes", (unsigned)length);
+    } else {
+        LOG_W("Wake summary send failed");
+    }
+    // endPacket() only hands the frame to the driver; give it time to go
+    // out before WiFi is stopped
+    delay(20);
 }
 
 // Send a navigation/refresh action triggered by a button press.
 // The server uses this to update which image is "current" before the device fetches it.
 void sendActionToServer(const char *action) {
-    Debug("Sending action to server: " + String(action) + "\r\n");
+    LOG_D("Sending action to server: %s", action);
 
     HTTPClient http;
     String url = buildApiUrl("action", SERVER_HOST);
-    http.begin(url);
+    beginApiRequest(http, url);
     http.setTimeout(10000);
     http.addHeader("Content-Type", "application/json");
     http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
@@ -737,9 +1543,9 @@ void sendActionToServer(const char *action) {
 
     int httpCode = http.POST(jsonString);
     if (httpCode > 0) {
-        Debug("Action sent: " + String(httpCode) + "\r\n");
+        LOG_D("Action sent: %d", httpCode);
     } else {
-        Debug("Action send failed: " + String(httpCode) + "\r\n");
+        LOG_W("Action send failed: %d", httpCode);
     }
     http.end();
 }
@@ -797,53 +1603,123 @@ bool detectCharging(float currentVoltage, float previousVoltage) {
 }
 
 uint64_t getSleepDurationFromServer() {
-    Debug("Fetching sleep duration from server...\r\n");
+    LOG_I("Fetching sleep duration from server...");
 
-    HTTPClient http;
-    String url = buildApiUrl("current.json", SERVER_HOST);
-    http.begin(url);
-    http.setTimeout(10000);
-    http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
+    CurrentJsonDocument doc;
+    int httpCode = 0;
+    if (fetchCurrentJson(doc, 10000, &httpCode)) {
+        if (doc.containsKey("sleepDuration")) {
+            uint64_t sleepDuration = doc["sleepDuration"];
+            LOG_I("Server sleep duration: %llu microseconds", (unsigned long long)sleepDuration);
+            return sleepDuration;
+        } else {
+            LOG_W("Failed to parse sleepDuration from JSON");
+        }
+    } else if (httpCode != HTTP_CODE_OK) {
+        LOG_W("Failed to fetch current.json, code: %d", httpCode);
+    }
 
-    int httpCode = http.GET();
+    return 0; // Caller will use default
+}
 
-    if (httpCode == HTTP_CODE_OK) {
-        String payload = http.getString();
-        http.end();
+// GET current.json and deserialize it from the socket as it arrives, so
+// neither the body nor unused fields are ever held in memory. Returns false
+// with *httpCode set on HTTP failure, or with *httpCode == 200 if the body
+// did not parse.
+bool fetchCurrentJson(CurrentJsonDocument &doc, uint32_t timeoutMs, int *httpCode) {
+    StaticJsonDocument<128> filter;
+    filter["imageId"] = true;
+    filter["sleepDuration"] = true;
+    filter["hasImage"] = true;
+    filter["displayList"] = true;
+    filter["devServerHost"] = true;
 
-        DynamicJsonDocument doc(2048);
-        DeserializationError error = deserializeJson(doc, payload);
+    HTTPClient http;
+    // HTTP/1.0 keeps the server from using chunked encoding, so the stream
+    // is exactly the JSON body
+    http.useHTTP10(true);
+    beginApiRequest(http, buildApiUrl("current.json", SERVER_HOST));
+    http.setTimeout(timeoutMs);
+    http.addHeader("User-Agent", "ESP32-Glance-v3/" FIRMWARE_VERSION);
 
-        if (!error && doc.containsKey("sleepDuration")) {
-            uint64_t sleepDuration = doc["sleepDuration"];
-            Debug("Server sleep duration: " + String(sleepDuration) + " microseconds\r\n");
-            return sleepDuration;
+    *httpCode = http.GET();
+    bool ok = false;
+    if (*httpCode == HTTP_CODE_OK) {
+        DeserializationError error = deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter));
+        if (error) {
+            LOG_W("current.json: %s", error.c_str());
         } else {
-            Debug("Failed to parse sleepDuration from JSON\r\n");
+            ok = true;
         }
-    } else {
-        Debug("Failed to fetch current.json, code: " + String(httpCode) + "\r\n");
     }
-
     http.end();
-    return 0; // Caller will use default
+    return ok;
 }
 
 // Helper function to build API URL
 String buildApiUrl(const char* endpoint, const String& serverHost) {
-    return "http://" + serverHost + "/api/" + endpoint;
+    return (SERVER_TLS ? "https://" : "http://") + serverHost + "/api/" + endpoint;
+}
+
+// Every request goes through here so HTTPS requests share the wake's TLS
+// connection, and capture builds record them
+bool beginApiRequest(HTTPClient &http, const String &url) {
+#if SERVER_TLS
+    static TlsClient tlsClient;
+#if CAPTURE_SESSION
+    static CaptureClient captureClient(tlsClient);
+    return http.begin(captureClient, url);
+#else
+    return http.begin(tlsClient, url);
+#endif
+#elif CAPTURE_SESSION
+    static WiFiClient plainClient;
+    static CaptureClient captureClient(plainClient);
+    return http.begin(captureClient, url);
+#else
+    return http.begin(url);
+#endif
+}
+
+// Start an installed update with a reset rather than a deep sleep wake, so
+// the new image initializes its own RTC memory (Ota.h)
+void restartIntoUpdate() {
+#if CAPTURE_SESSION
+    uploadCapture();
+#endif
+    powerDownDisplay(0);
+    LOG_I("Restarting into the installed update");
+    esp_restart();
 }
 
 void enterDeepSleep(uint64_t sleepTime) {
-    Debug("Entering deep sleep for " + String(sleepTime / 1000000) + " seconds\r\n");
+#if CAPTURE_SESSION
+    uploadCapture();
+#endif
+    LOG_I("Entering deep sleep for %llu seconds", (unsigned long long)(sleepTime / 1000000));
 
-    // Hold display power rail off during deep sleep to prevent leakage current
+    powerDownDisplay(sleepTime);
+    if (panelRetained) {
+        LOG_I("Panel stays in standby through sleep");
+        holdPanelPins();
+    } else {
+        // Hold display power rail off during deep sleep to prevent leakage current
 #ifdef BOARD_XIAO_EE02
-    // GPIO43 is not an RTC GPIO on ESP32-S3, use digital pad hold instead
-    digitalWrite(EPD_PWR_PIN, LOW);
-    gpio_hold_en((gpio_num_t)EPD_PWR_PIN);
-    gpio_deep_sleep_hold_en();
+        // GPIO43 is not an RTC GPIO on ESP32-S3, use digital pad hold instead
+        pinMode(EPD_PWR_PIN, OUTPUT);
+        digitalWrite(EPD_PWR_PIN, LOW);
+        gpio_hold_en((gpio_num_t)EPD_PWR_PIN);
+        gpio_deep_sleep_hold_en();
+#else
+        // GoodDisplay board: EPD_PWR_PIN is GPIO45 — attempt RTC hold
+        rtc_gpio_init((gpio_num_t)EPD_PWR_PIN);
+        rtc_gpio_set_direction((gpio_num_t)EPD_PWR_PIN, RTC_GPIO_MODE_OUTPUT_ONLY);
+        rtc_gpio_set_level((gpio_num_t)EPD_PWR_PIN, 0);
+        rtc_gpio_hold_en((gpio_num_t)EPD_PWR_PIN);
+#endif
+    }
 
+#ifdef BOARD_XIAO_EE02
     // Enable ext1 wakeup on buttons (active-low: wake when any button pin goes LOW)
     esp_sleep_enable_ext1_wakeup(BUTTON_WAKE_MASK, ESP_EXT1_WAKEUP_ANY_LOW);
 
@@ -855,14 +1731,12 @@ void enterDeepSleep(uint64_t sleepTime) {
     rtc_gpio_pulldown_dis(GPIO_NUM_3);
     rtc_gpio_pullup_en(GPIO_NUM_5);
     rtc_gpio_pulldown_dis(GPIO_NUM_5);
-#else
-    // GoodDisplay board: EPD_PWR_PIN is GPIO45 — attempt RTC hold
-    rtc_gpio_init((gpio_num_t)EPD_PWR_PIN);
-    rtc_gpio_set_direction((gpio_num_t)EPD_PWR_PIN, RTC_GPIO_MODE_OUTPUT_ONLY);
-    rtc_gpio_set_level((gpio_num_t)EPD_PWR_PIN, 0);
-    rtc_gpio_hold_en((gpio_num_t)EPD_PWR_PIN);
 #endif
 
+    // The RTC keeps system time through deep sleep, so a later button wake
+    // can work out how much of this interval is left.
+    scheduledWakeTime = time(nullptr) + (time_t)(sleepTime / 1000000ULL);
+
     esp_sleep_enable_timer_wakeup(sleepTime);
     esp_deep_sleep_start();
 }
@@ -872,29 +1746,8 @@ void enterDeepSleep(uint64_t sleepTime) {
 #define COLOR_ORDER_BGR 0
 #endif
 
-// Theoretical palette - what firmware expects
-struct SpectraColor { uint8_t r, g, b, idx; };
-static const SpectraColor SPECTRA6_PALETTE_THEORETICAL[] = {
-    { 0,   0,   0,   0x0 }, // Black
-    { 255, 255, 255, 0x1 }, // White
-    { 255, 255, 0,   0x2 }, // Yellow
-    { 255, 0,   0,   0x3 }, // Red
-    { 0,   0,   255, 0x5 }, // Blue
-    { 0,   255, 0,   0x6 }  // Green
-};
-
-// Measured palette - actual colors displayed by e-paper
-static const SpectraColor SPECTRA6_PALETTE_MEASURED[] = {
-    { 2,   2,   2,   0x0 }, // Black
-    { 190, 200, 200, 0x1 }, // White (actually light gray)
-    { 205, 202, 0,   0x2 }, // Yellow (darker than expected)
-    { 135, 19,  0,   0x3 }, // Red (much darker)
-    { 5,   64,  158, 0x5 }, // Blue (much darker)
-    { 39,  102, 60,  0x6 }  // Green (extremely dark)
-};
-
 void setEinkPixel(uint8_t* buffer, int x, int y, uint8_t color) {
-    if (x < 0 || x >= DISPLAY_WIDTH || y < 0 || y >= DISPLAY_HEIGHT) return;
+    if (x < 0 || x >= (int)DISPLAY_WIDTH || y < 0 || y >= (int)DISPLAY_HEIGHT) return;
     int pixelIndex = y * DISPLAY_WIDTH + x;
     int byteIndex = pixelIndex / 2;
     if (pixelIndex % 2 == 0) {
@@ -944,25 +1797,75 @@ uint8_t mapRGBToEink(uint8_t r, uint8_t g, uint8_t b) {
 #endif
 
     // Fast-path: exact match against theoretical palette (server-dithered images)
-    for (const auto &pc : SPECTRA6_PALETTE_THEORETICAL) {
-        if (rr == pc.r && gg == pc.g && bb == pc.b) {
-            return pc.idx;
+    for (const auto &pc : Panel::Palette) {
+        if (rr == pc.R && gg == pc.G && bb == pc.B) {
+            return pc.Index;
         }
     }
 
     // Fallback: nearest neighbour against measured palette
     uint32_t bestDist = UINT32_MAX;
     uint8_t bestIdx = EINK_WHITE;
-    for (const auto &pc : SPECTRA6_PALETTE_MEASURED) {
-        int dr = (int)rr - (int)pc.r;
-        int dg = (int)gg - (int)pc.g;
-        int db = (int)bb - (int)pc.b;
+    for (const auto &pc : Panel::MeasuredPalette) {
+        int dr = (int)rr - (int)pc.R;
+        int dg = (int)gg - (int)pc.G;
+        int db = (int)bb - (int)pc.B;
         uint32_t dist = (uint32_t)(dr*dr + dg*dg + db*db);
         if (dist < bestDist) {
             bestDist = dist;
-            bestIdx = pc.idx;
+            bestIdx = pc.Index;
             if (bestDist == 0) break;
         }
     }
     return bestIdx;
 }
+
+// Blue-noise pattern dithering of one RGB stream pixel, as blue_noise_dither()
+// in taulu-api/prepare.py: BLUE_NOISE_CANDIDATES nearest-colour matches, each
+// with half the error so far added on, ordered by luminance, and the
+// threshold at (x, y) picks one. Needs no other pixel, so it runs as the
+// stream arrives. Pixels already in the nominal palette pass through.
+uint8_t ditherRGBToEink(uint8_t r, uint8_t g, uint8_t b, int x, int y) {
+#if COLOR_ORDER_BGR
+    const int goal[3] = { b, g, r };
+#else
+    const int goal[3] = { r, g, b };
+#endif
+
+    for (const auto &pc : Panel::Palette) {
+        if (goal[0] == pc.R && goal[1] == pc.G && goal[2] == pc.B) {
+            return pc.Index;
+        }
+    }
+
+    int error[3] = { 0, 0, 0 };
+    uint8_t counts[Panel::PaletteSize] = { 0 };
+    for (int n = 0; n < BLUE_NOISE_CANDIDATES; n++) {
+        const int attempt[3] = { goal[0] + (error[0] >> 1), goal[1] + (error[1] >> 1), goal[2] + (error[2] >> 1) };
+        uint32_t bestDist = UINT32_MAX;
+        int best = 0;
+        for (int i = 0; i < Panel::PaletteSize; i++) {
+            const EPD_PaletteColor &pc = Panel::MeasuredPalette[i];
+            int dr = attempt[0] - pc.R;
+            int dg = attempt[1] - pc.G;
+            int db = attempt[2] - pc.B;
+            uint32_t dist = (uint32_t)(dr*dr + dg*dg + db*db);
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = i;
+            }
+        }
+        counts[best]++;
+        error[0] += goal[0] - Panel::MeasuredPalette[best].R;
+        error[1] += goal[1] - Panel::MeasuredPalette[best].G;
+        error[2] += goal[2] - Panel::MeasuredPalette[best].B;
+    }
+
+    int threshold = BlueNoiseMatrix[(y % BLUE_NOISE_SIZE) * BLUE_NOISE_SIZE + x % BLUE_NOISE_SIZE];
+    int pick = (threshold * BLUE_NOISE_CANDIDATES) >> 8;
+    for (uint8_t i : BlueNoiseLuminanceOrder) {
+        if (pick < counts[i]) return Panel::MeasuredPalette[i].Index;
+        pick -= counts[i];
+    }
+    return EINK_WHITE;
+}
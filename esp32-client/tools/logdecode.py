@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Decode a deferred log ring (LOG_DEFERRED=1 builds) into text.
+
+Records hold the address of the printf format string rather than the text,
+so the firmware ELF that produced the ring is needed to look them up:
+
+    tools/logdecode.py .pio/build/xiao_ee02/firmware.elf state/logs/<device>-<time>.bin
+
+The ring layout is documented in lib/log/Log.h and lib/log/Log.cpp.
+"""
+import re
+import struct
+import sys
+
+RING_MAGIC = 0x31524C54  # "TLR1"
+RECORD_MARK = 0xA5
+LEVEL_TAGS = "-EWIDV"
+
+CONVERSION = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t|L)?([diouxXeEfFgGcspn%])')
+
+
+class Elf:
+    """Just enough ELF32 to read strings out of allocated sections."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] != 1:
+            raise ValueError(f"{path} is not a 32-bit ELF file")
+        shoff, = struct.unpack_from('<I', self.data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            _, kind, flags, addr, offset, size = struct.unpack_from('<IIIIII', self.data, shoff + i * shentsize)
+            # SHT_NOBITS (.bss) has no file contents; only SHF_ALLOC sections have addresses
+            if kind != 8 and flags & 0x2 and addr:
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.index(b'\0', start, offset + size)
+                return self.data[start:end].decode('utf-8', errors='replace')
+        return None
+
+
+def format_args(fmt, words):
+    """Expand `fmt` with arguments packed as LogArgs does; returns (text, words used)."""
+    pos = 0
+    out = []
+    last = 0
+
+    def take():
+        nonlocal pos
+        value = words[pos] if pos < len(words) else 0
+        pos += 1
+        return value
+
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        flags, width, precision, length, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        if width == '*':
+            width = str(struct.unpack('<i', struct.pack('<I', take()))[0])
+        if precision == '*':
+            precision = str(struct.unpack('<i', struct.pack('<I', take()))[0])
+        spec = '%' + (flags or '') + (width or '') + ('.' + precision if precision is not None else '')
+
+        if conv == 's':
+            n = take()
+            raw = b''.join(struct.pack('<I', take()) for _ in range((n + 3) // 4))[:n]
+            out.append((spec + 's') % raw.decode('utf-8', errors='replace'))
+        elif conv in 'eEfFgG':
+            value, = struct.unpack('<f', struct.pack('<I', take()))
+            out.append((spec + conv) % value)
+        elif conv == 'p':
+            out.append('0x%08x' % take())
+        elif conv == 'n':
+            pass
+        else:
+            value = take()
+            if length == 'll':
+                value |= take() << 32
+                bits = 64
+            else:
+                bits = 32
+            if conv in 'di' and value >> (bits - 1):
+                value -= 1 << bits
+            if conv == 'c':
+                out.append((spec + 'c') % chr(value & 0xFF))
+            else:
+                out.append((spec + (conv if conv != 'u' else 'd')) % value)
+    out.append(fmt[last:])
+    return ''.join(out), pos
+
+
+def decode(elf, blob):
+    if len(blob) < 8:
+        raise ValueError("ring dump is too short")
+    magic, count = struct.unpack_from('<II', blob)
+    if magic != RING_MAGIC:
+        raise ValueError("not a log ring dump")
+    words = list(struct.unpack_from(f'<{count}I', blob, 8))
+
+    i = 0
+    while i + 3 <= len(words):
+        header, address, millis = words[i:i + 3]
+        if header >> 24 != RECORD_MARK:
+            raise ValueError(f"corrupt record at word {i}")
+        level = (header >> 16) & 0xFF
+        arg_count = header & 0xFFFF
+        args = words[i + 3:i + 3 + arg_count]
+        i += 3 + arg_count
+
+        fmt = elf.string(address)
+        if fmt is None:
+            text = f"<unknown format 0x{address:08x}> " + ' '.join(f'{w:08x}' for w in args)
+        else:
+            text, _ = format_args(fmt, args)
+        tag = LEVEL_TAGS[level] if level < len(LEVEL_TAGS) else '-'
+        yield f"{millis / 1000:10.3f} [{tag}] {text}"
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(f"usage: {sys.argv[0]} firmware.elf ring.bin", file=sys.stderr)
+        sys.exit(2)
+    elf = Elf(sys.argv[1])
+    with open(sys.argv[2], 'rb') as f:
+        blob = f.read()
+    for line in decode(elf, blob):
+        print(line)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Blue-noise against Floyd-Steinberg dithering: quality and speed.
+
+    bench/dither.py compare [--images a.jpg b.png ...] [--size 600x450]
+        Dithers each image (default: synthetic photos from bench/synthetic.py)
+        both ways after the same resize and dynamic range compression as
+        prepare.convert_image_to_bin(), and reports the conversion time and
+        how close the result looks to the compressed image on the panel:
+
+          blurred dE   mean CIE76 colour difference after a Gaussian blur of
+                       --sigma pixels in linear light, roughly what is seen
+                       from a viewing distance at which single dots vanish
+          p95 dE       95th percentile of the same
+          mean dE      difference of the average colour of the whole image
+
+        Dithered pixels are rendered in the measured palette, the colours the
+        panel actually shows. Floyd-Steinberg is a per-pixel Python loop, so
+        keep --size small; blue-noise time scales with the pixel count.
+
+    bench/dither.py header [--output ../esp32-client/src/BlueNoise.h]
+        Writes the threshold matrix and parameters the firmware dithers RGB
+        streams with (DITHER_BLUE_NOISE builds).
+"""
+import argparse
+import os
+import sys
+import time
+from io import BytesIO
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+API_DIR = os.path.join(BENCH_DIR, '..')
+sys.path.insert(0, API_DIR)
+
+import numpy as np
+from PIL import Image
+
+import prepare
+import synthetic
+
+HEADER = os.path.normpath(os.path.join(API_DIR, '..', 'esp32-client', 'src', 'BlueNoise.h'))
+
+
+def to_linear(srgb: np.ndarray) -> np.ndarray:
+    s = srgb / 255.0
+    return np.where(s <= 0.04045, s / 12.92, ((s + 0.055) / 1.055) ** 2.4)
+
+
+def to_lab(linear: np.ndarray) -> np.ndarray:
+    """CIELAB (D65) of linear sRGB."""
+    m = np.array([[0.4124, 0.3576, 0.1805], [0.2126, 0.7152, 0.0722], [0.0193, 0.1192, 0.9505]])
+    xyz = linear @ m.T / np.array([0.9505, 1.0, 1.089])
+    f = np.where(xyz > 0.008856, np.cbrt(xyz), 7.787 * xyz + 16 / 116)
+    return np.stack([116 * f[..., 1] - 16, 500 * (f[..., 0] - f[..., 1]), 200 * (f[..., 1] - f[..., 2])], axis=-1)
+
+
+def blur(linear: np.ndarray, sigma: float) -> np.ndarray:
+    """Separable Gaussian blur with edges extended."""
+    r = max(1, int(3 * sigma))
+    k = np.exp(-np.arange(-r, r + 1) ** 2 / (2 * sigma ** 2))
+    k /= k.sum()
+    h, w = linear.shape[:2]
+    p = np.pad(linear, ((r, r), (0, 0), (0, 0)), mode='edge')
+    linear = sum(k[i] * p[i:i + h] for i in range(2 * r + 1))
+    p = np.pad(linear, ((0, 0), (r, r), (0, 0)), mode='edge')
+    return sum(k[i] * p[:, i:i + w] for i in range(2 * r + 1))
+
+
+def quality(reference: np.ndarray, indices: np.ndarray, sigma: float) -> dict:
+    shown = np.array(prepare.PALETTE_MEASURED, dtype=np.float64)[indices]
+    ref, out = to_linear(reference.astype(np.float64)), to_linear(shown)
+    de = np.linalg.norm(to_lab(blur(ref, sigma)) - to_lab(blur(out, sigma)), axis=-1)
+    mean = np.linalg.norm(to_lab(ref.mean(axis=(0, 1))) - to_lab(out.mean(axis=(0, 1))))
+    return {'blurred dE': de.mean(), 'p95 dE': np.percentile(de, 95), 'mean dE': mean}
+
+
+def floyd_steinberg(image_array: np.ndarray) -> np.ndarray:
+    """Palette indices, as convert_image_to_bin() maps them."""
+    dithered = prepare.floyd_steinberg_dither(image_array, prepare.PALETTE_MEASURED, prepare.PALETTE_THEORETICAL)
+    nominal = np.array(prepare.PALETTE_THEORETICAL)
+    return np.argmax((dithered[:, :, None, :] == nominal).all(axis=3), axis=2)
+
+
+def blue_noise(image_array: np.ndarray) -> np.ndarray:
+    return prepare.blue_noise_dither(image_array, prepare.PALETTE_MEASURED)
+
+
+MODES = {prepare.DITHER_FLOYD_STEINBERG: floyd_steinberg, prepare.DITHER_BLUE_NOISE: blue_noise}
+
+
+def load(args) -> list:
+    width, height = (int(v) for v in args.size.split('x'))
+    if args.images:
+        sources = [(os.path.basename(p), open(p, 'rb').read()) for p in args.images]
+    else:
+        sources = [(f'synthetic {seed}', synthetic.photo(seed, 1200, 900, 2)) for seed in range(args.count)]
+    images = []
+    for name, data in sources:
+        image = prepare.resize_and_truncate(Image.open(BytesIO(data)), (width, height)).convert('RGB')
+        images.append((name, prepare.compress_dynamic_range(np.array(image, dtype=np.uint8),
+                                                            prepare.PALETTE_MEASURED)))
+    return images
+
+
+def compare(args) -> None:
+    prepare.blue_noise_matrix()  # made once per process, not part of the timing
+    columns = ('time s', 'blurred dE', 'p95 dE', 'mean dE')
+    print(f"{'image':<16}{'mode':<17}" + ''.join(f'{c:>12}' for c in columns))
+    totals = {mode: {c: 0.0 for c in columns} for mode in MODES}
+    images = load(args)
+    for name, image_array in images:
+        for mode, dither in MODES.items():
+            start = time.perf_counter()
+            indices = dither(image_array)
+            row = {'time s': time.perf_counter() - start, **quality(image_array, indices, args.sigma)}
+            for c in columns:
+                totals[mode][c] += row[c]
+            print(f"{name:<16}{mode:<17}" + ''.join(f'{row[c]:>12.2f}' for c in columns))
+    for mode in MODES:
+        print(f"{'average':<16}{mode:<17}" + ''.join(f'{totals[mode][c] / len(images):>12.2f}' for c in columns))
+
+
+def header(args) -> None:
+    matrix = prepare.blue_noise_matrix()
+    luminance = np.array(prepare.PALETTE_MEASURED) @ np.array([299, 587, 114])
+    order = ', '.join(str(i) for i in np.argsort(luminance, kind='stable'))
+    values = matrix.ravel()
+    rows = ',\n'.join('    ' + ', '.join(f'{v:3d}' for v in values[i:i + 16]) for i in range(0, len(values), 16))
+    with open(args.output, 'w') as f:
+        f.write(f"""#pragma once
+
+#include <stdint.h>
+
+// Blue-noise pattern dithering of RGB streams (DITHER_BLUE_NOISE builds), the
+// same as blue_noise_dither() in taulu-api/prepare.py. Written by
+// taulu-api/bench/dither.py header; do not edit.
+
+#define BLUE_NOISE_SIZE {matrix.shape[0]}
+#define BLUE_NOISE_CANDIDATES {prepare.BLUE_NOISE_CANDIDATES} // palette colours mixed per pixel
+
+// Measured palette entries from darkest to lightest
+static const uint8_t BlueNoiseLuminanceOrder[] = {{ {order} }};
+
+// Void-and-cluster threshold matrix, tiled over the frame
+static const uint8_t BlueNoiseMatrix[BLUE_NOISE_SIZE * BLUE_NOISE_SIZE] = {{
+{rows}
+}};
+""")
+    print(f"Wrote {args.output}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest='command', required=True)
+    compare_parser = commands.add_parser('compare')
+    compare_parser.add_argument('--images', nargs='*', help="image files (default: synthetic photos)")
+    compare_parser.add_argument('--count', type=int, default=3, help="synthetic photos")
+    compare_parser.add_argument('--size', default='600x450', help="dithered size, WxH")
+    compare_parser.add_argument('--sigma', type=float, default=1.5, help="blur radius in pixels")
+    header_parser = commands.add_parser('header')
+    header_parser.add_argument('--output', default=HEADER)
+    args = parser.parse_args()
+
+    if args.command == 'compare':
+        compare(args)
+    else:
+        header(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,447 @@
+#!/usr/bin/env python3
+"""Accelerated-time fleet simulation of this server under a model of the firmware.
+
+This does not run the firmware. Device._wake is a hand-written Python model
+of the wake path in esp32-client/src/main.cpp (setup() and
+chooseSleepInterval()), kept in step with it by hand; nothing checks that
+it still matches, so after changing the wake path, change the model too.
+Only numeric #defines are taken from the firmware sources, at their
+defaults. Device-side durations (boot, WiFi join, transfer time, panel
+refresh) and currents are estimates from the timing model below, not
+measurements, and deep sleep is a jump of the virtual clock.
+
+What is real is the server: every request a modelled device makes goes to
+the actual Flask app, in-process, with the server's clock patched to the
+virtual one, so sleep durations, day changes, bundles and image ids are the
+server's own answers. Use it to see how the server schedules and loads a
+fleet, and to compare firmware policies on paper; check device-side
+figures against a real device (bench/replay.py, or a power meter).
+
+    bench/fleetsim.py --devices 50 --days 7
+
+A week of 50 devices takes a few minutes, most of it converting the
+synthetic photos the server "downloads" (bench/synthetic.py stands in for
+Immich). The server runs from a temporary copy of taulu-api, so its state
+directory is left alone.
+
+Reported per modelled device: wakes (online/offline/button), radio-on
+seconds, bytes sent and received, panel refreshes and estimated charge used.
+"""
+import argparse
+import datetime as real_datetime
+import heapq
+import json
+import os
+import random
+import re
+import shutil
+import struct
+import sys
+import tempfile
+import threading
+import time as real_time
+import types
+
+import synthetic
+
+API_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+FIRMWARE_DIR = os.path.join(API_DIR, '..', 'esp32-client')
+
+
+def firmware_defines(*paths) -> dict:
+    """Numeric #defines of firmware sources, at their defaults (no -D overrides)."""
+    defines = {}
+    for path in paths:
+        with open(os.path.join(FIRMWARE_DIR, path)) as f:
+            for line in f:
+                match = re.match(r'\s*#define\s+(\w+)\s+([^/"]+?)\s*(//.*)?$', line)
+                if not match:
+                    continue
+                expression = re.sub(r'(\d)(?:ULL|UL|LL|U|L)\b', r'\1', match.group(2))
+                try:
+                    defines[match.group(1)] = eval(expression, {'__builtins__': {}}, dict(defines))
+                except (SyntaxError, NameError, TypeError):
+                    pass  # not plain arithmetic
+    return defines
+
+
+FIRMWARE = firmware_defines('src/main.cpp', 'lib/epd/EPD_13in3e.h')
+DEFAULT_SLEEP_S = FIRMWARE['DEFAULT_SLEEP_TIME'] / 1e6
+FAILURE_SLEEP_S = FIRMWARE['FAILURE_SLEEP_TIME'] / 1e6
+MIN_SLEEP_S = FIRMWARE['MIN_SLEEP_TIME'] / 1e6
+MAX_OFFLINE_SLEEP_S = FIRMWARE['MAX_OFFLINE_SLEEP'] / 1e6
+BUNDLE_LOW_WATER = FIRMWARE['BUNDLE_LOW_WATER']
+LOW_BATTERY_V = FIRMWARE['LOW_BATTERY_THRESHOLD']
+FRAME_BYTES = FIRMWARE['EPD_13IN3E_WIDTH'] * FIRMWARE['EPD_13IN3E_HEIGHT'] // 2
+BUNDLE_SLOTS = 3           # frame store slots left for a bundle next to the frame on the panel (partition table)
+
+# Timing model, seconds unless noted
+BOOT_S = 0.35
+WIFI_JOIN_S = (1.6, 0.4)   # mean, standard deviation
+RTT_S = 0.03
+HEADER_BYTES = 220         # request line and headers each way
+PANEL_INIT_S = FIRMWARE['PANEL_INIT_ESTIMATE_MS'] / 1000  # power-up, reset, init and the settling waits
+PANEL_REFRESH_S = 35.0
+
+# Current model
+SLEEP_UA = 15
+ACTIVE_MA = 45             # CPU on
+RADIO_MA = 110             # extra while WiFi is up
+PANEL_MA = 35              # extra while the panel refreshes
+
+
+class VirtualClock:
+    def __init__(self, start: float):
+        self.now = start
+
+
+def install_clock(module, clock: VirtualClock) -> None:
+    """Point the module's `datetime` and `time` at the virtual clock."""
+    class Datetime(real_datetime.datetime):
+        @classmethod
+        def now(cls, tz=None):
+            return cls.fromtimestamp(clock.now, tz)
+
+    class Date(real_datetime.date):
+        @classmethod
+        def today(cls):
+            return cls.fromtimestamp(clock.now)
+
+    class Time:
+        def __getattr__(self, name):
+            return getattr(real_time, name)
+
+        def time(self):
+            return clock.now
+
+    module.datetime = types.SimpleNamespace(datetime=Datetime, date=Date,
+                                            timedelta=real_datetime.timedelta, time=real_datetime.time)
+    module.time = Time()
+
+
+class SyntheticLibrary:
+    """Stands in for ImmichClient: an endless supply of distinct photos."""
+
+    def __init__(self):
+        self.count = 0
+        self.lock = threading.Lock()
+
+    def find_random_group_photo(self, person_ids, exclude_ids=None):
+        with self.lock:
+            self.count += 1
+            return {'id': f'sim-{self.count:06d}'}
+
+    def download_asset(self, asset_id):
+        return synthetic.photo(int(asset_id.split('-')[1]))
+
+
+class Server:
+    """taulu-api imported from a scratch copy, on the virtual clock."""
+
+    def __init__(self, clock: VirtualClock):
+        self.workdir = tempfile.mkdtemp(prefix='fleetsim-')
+        for name in os.listdir(API_DIR):
+            if name.endswith('.py') or name == 'people-ids.json':
+                shutil.copy(os.path.join(API_DIR, name), self.workdir)
+        os.environ['TELEMETRY_UDP_PORT'] = '0'
+        os.environ.pop('IMMICH_API_KEY', None)
+        sys.path.insert(0, self.workdir)
+        import main
+        self.main = main
+        main.logger.setLevel('WARNING')
+        main.immich_client = SyntheticLibrary()
+        install_clock(main, clock)
+        main.manager = main.ImageManager()  # the import-time one had no library to fetch from
+        self.client = main.app.test_client()
+
+    def settle(self, timeout: float = 120) -> None:
+        """Let background fetches finish; the server has hours between wakes."""
+        deadline = real_time.monotonic() + timeout
+        while self.main.manager.fetching and real_time.monotonic() < deadline:
+            real_time.sleep(0.02)
+
+    def close(self) -> None:
+        shutil.rmtree(self.workdir, ignore_errors=True)
+
+
+class Device:
+    def __init__(self, index: int, args, rng: random.Random):
+        self.id = f"sim-{index:03d}"
+        self.rng = rng
+        self.args = args
+        self.last_image_id = ''
+        self.clock_synced = False
+        self.bundle = []            # [image id, display time]
+        self.scheduled_wake = 0.0
+        self.charge_mas = args.battery_mah * 3600.0
+        self.stats = dict(wakes=0, online=0, offline=0, buttons=0, wifi_failures=0,
+                          requests=0, radio_s=0.0, awake_s=0.0, tx=0, rx=0, refreshes=0, used_mas=0.0)
+
+    # -- battery ----------------------------------------------------------------
+
+    def voltage(self) -> float:
+        left = max(0.0, self.charge_mas / (self.args.battery_mah * 3600.0))
+        return 3.2 + 1.0 * left
+
+    def spend(self, seconds: float, milliamps: float) -> None:
+        self.charge_mas -= seconds * milliamps
+        self.stats['used_mas'] += seconds * milliamps
+
+    # -- network ----------------------------------------------------------------
+
+    def request(self, sim, method: str, path: str, body: bytes = b'') -> tuple[int, bytes]:
+        sim.clock.now = self.t
+        if method == 'GET':
+            response = sim.server.client.get(path)
+        else:
+            response = sim.server.client.post(path, data=body, content_type='application/json')
+        data = response.get_data()
+        tx, rx = HEADER_BYTES + len(body), HEADER_BYTES + len(data)
+        self.stats['requests'] += 1
+        self.stats['tx'] += tx
+        self.stats['rx'] += rx
+        self.t += RTT_S + (tx + rx) * 8 / (self.args.bandwidth_kbit * 1000)
+        sim.server.settle()
+        return response.status_code, data
+
+    def report(self, sim, status: str) -> None:
+        body = json.dumps({'deviceId': self.id, 'status': {'status': status,
+                           'batteryVoltage': round(self.voltage(), 2)}}).encode()
+        self.request(sim, 'POST', '/api/device-status', body)
+
+    def log(self, sim, message: str) -> None:
+        body = json.dumps({'deviceId': self.id, 'logs': message, 'logLevel': 'INFO'}).encode()
+        self.request(sim, 'POST', '/api/logs', body)
+
+    # -- bundle -----------------------------------------------------------------
+
+    def pending(self, now: float) -> int:
+        return sum(1 for _, at in self.bundle if at > now)
+
+    def next_frame_at(self, now: float) -> float:
+        upcoming = [at for _, at in self.bundle if at > now]
+        return min(upcoming) if upcoming else 0
+
+    def due_frame(self, now: float):
+        due = [f for f in self.bundle if f[1] <= now and f[0] != self.last_image_id]
+        return max(due, key=lambda f: f[1]) if due else None
+
+    def fetch_bundle(self, sim) -> None:
+        if self.clock_synced and self.pending(self.t) >= BUNDLE_LOW_WATER:
+            return
+        code, data = self.request(sim, 'GET', f'/api/bundle.bin?count={BUNDLE_SLOTS}')
+        if code != 200 or data[:4] != b'TBD1':
+            return
+        _, server_time, count, _ = struct.unpack_from('<4sIHH', data)
+        self.clock_synced = True
+        self.bundle, pos = [], 12
+        for _ in range(count):
+            image_id, display_at, length = struct.unpack_from('<64sII', data, pos)
+            self.bundle.append([image_id.rstrip(b'\0').decode(), display_at])
+            pos += 72 + length
+
+    # -- one wake ---------------------------------------------------------------
+
+    def sleep_until(self, wake_at: float) -> float:
+        if wake_at <= self.t:
+            return MIN_SLEEP_S
+        return max(MIN_SLEEP_S, min(wake_at - self.t + 2, MAX_OFFLINE_SLEEP_S))
+
+    def choose_sleep(self, sim, download_failed: bool, low_battery: bool) -> float:
+        """chooseSleepInterval(): only a normal wake asks the server."""
+        if download_failed:
+            sleep = FAILURE_SLEEP_S
+            self.log(sim, 'Using 15-minute sleep due to download failure')
+        elif low_battery:
+            sleep = DEFAULT_SLEEP_S * 2
+            self.log(sim, 'Using extended sleep due to low battery')
+        else:
+            code, data = self.request(sim, 'GET', '/api/current.json')
+            sleep = json.loads(data).get('sleepDuration', 0) / 1e6 if code == 200 else 0
+            sleep = sleep or DEFAULT_SLEEP_S
+        if self.clock_synced and self.next_frame_at(self.t):
+            sleep = min(sleep, self.sleep_until(self.next_frame_at(self.t)))
+        return sleep
+
+    def refresh(self) -> None:
+        self.spend(PANEL_INIT_S + PANEL_REFRESH_S, PANEL_MA)
+        self.stats['refreshes'] += 1
+
+    def wake(self, sim, start: float, button) -> float:
+        """Run one wake from `start` (timer wake, or KEY0-2); returns the sleep it ends with."""
+        self.t = start + BOOT_S
+        self.stats['wakes'] += 1
+        sleep = self._wake(sim, button)
+        awake = self.t - start
+        self.stats['awake_s'] += awake
+        self.spend(awake, ACTIVE_MA)
+        self.spend(sleep, SLEEP_UA / 1000)
+        self.scheduled_wake = self.t + sleep
+        return sleep
+
+    def _wake(self, sim, button) -> float:
+        if button == 1:
+            # KEY1 redraws the stored frame offline, then finishes the interrupted sleep
+            self.stats['buttons'] += 1
+            self.stats['offline'] += 1
+            self.t += PANEL_INIT_S + PANEL_REFRESH_S
+            self.refresh()
+            return max(MIN_SLEEP_S, self.scheduled_wake - self.t)
+        if button is not None:
+            self.stats['buttons'] += 1
+
+        low_battery = self.voltage() < LOW_BATTERY_V
+        if button is None and self.clock_synced:
+            frame = self.due_frame(self.t)
+            if frame:
+                self.t += PANEL_INIT_S + PANEL_REFRESH_S
+                self.refresh()
+                self.last_image_id = frame[0]
+                self.bundle = [f for f in self.bundle if f[1] >= frame[1]]
+            if self.pending(self.t) >= BUNDLE_LOW_WATER:
+                self.stats['offline'] += 1
+                return self.sleep_until(self.next_frame_at(self.t))
+
+        radio_on = self.t
+        self.t += max(0.3, self.rng.gauss(*WIFI_JOIN_S))
+        if self.rng.random() < self.args.wifi_failure:
+            self.stats['wifi_failures'] += 1
+            self.stats['radio_s'] += self.t - radio_on
+            self.spend(self.t - radio_on, RADIO_MA)
+            return DEFAULT_SLEEP_S
+        self.stats['online'] += 1
+
+        self.log(sim, 'WiFi connected')
+        self.report(sim, 'awake')
+        if button is not None:
+            body = json.dumps({'deviceId': self.id, 'action': 'previous' if button == 0 else 'next'}).encode()
+            self.request(sim, 'POST', '/api/action', body)
+        else:
+            self.log(sim, 'Timer wake, checking for new image')
+
+        code, data = self.request(sim, 'GET', '/api/current.json')
+        current = json.loads(data) if code == 200 else None
+        refresh_end = None
+        download_failed = False
+        if current is None:
+            self.log(sim, 'Metadata fetch failed, skipping display update')
+            self.report(sim, 'metadata_fetch_failed')
+        elif button is None and current['imageId'] == self.last_image_id:
+            self.log(sim, 'Image unchanged, skipping update to save power')
+            self.report(sim, 'display_unchanged')
+        else:
+            if button is None:
+                self.log(sim, 'Image changed, will update display' if self.last_image_id
+                         else 'First boot, displaying initial image')
+            for message in ('Starting display update for new image', 'Downloading new image'):
+                self.log(sim, message)
+            path = '/api/display-list.bin' if current.get('displayList') else '/api/image.bin'
+            code, data = self.request(sim, 'GET', path)
+            if code == 200 and (len(data) == FRAME_BYTES or path.endswith('list.bin')):
+                # The refresh runs while the refresh window does the rest of the network work
+                self.t += PANEL_INIT_S
+                refresh_end = self.t + PANEL_REFRESH_S
+                self.refresh()
+                self.last_image_id = current['imageId']
+                for _ in range(3):
+                    self.log(sim, 'queued during panel init')
+                self.report(sim, 'display_updated')
+            else:
+                self.log(sim, 'Download failed, keeping previous image on display')
+                self.report(sim, 'download_failed')
+                download_failed = True
+
+        if not download_failed:
+            self.fetch_bundle(sim)
+            self.request(sim, 'GET', '/api/ota.json?from=sim')
+        sleep = self.choose_sleep(sim, download_failed, low_battery)
+        self.report(sim, 'sleeping')
+        self.log(sim, f'Entering deep sleep for {int(sleep // 60)} minutes')
+
+        self.stats['radio_s'] += self.t - radio_on
+        self.spend(self.t - radio_on, RADIO_MA)
+        if refresh_end is not None:
+            self.t = max(self.t, refresh_end)
+        return max(MIN_SLEEP_S, sleep)
+
+
+class Simulation:
+    def __init__(self, args):
+        start = real_datetime.datetime.combine(real_datetime.date.today(), real_datetime.time(hour=8)).timestamp()
+        self.clock = VirtualClock(start)
+        self.server = Server(self.clock)
+        self.rng = random.Random(args.seed)
+        self.devices = [Device(i, args, random.Random(args.seed * 1000 + i)) for i in range(args.devices)]
+        self.end = start + args.days * 86400
+        self.args = args
+        # (time, sequence, device index, button); first wakes spread over an hour
+        self.queue = [(start + self.rng.uniform(0, 3600), i, i, -1) for i in range(args.devices)]
+        self.sequence = args.devices
+        heapq.heapify(self.queue)
+
+    def schedule(self, index: int, timer_at: float, now: float) -> None:
+        button, at = -1, timer_at
+        rate = self.args.presses_per_day / 86400
+        if rate > 0:
+            press_at = now + self.rng.expovariate(rate)
+            if press_at < timer_at:
+                button, at = self.rng.choice((0, 1, 2)), press_at
+        self.sequence += 1
+        heapq.heappush(self.queue, (at, self.sequence, index, button))
+
+    def run(self) -> None:
+        started = real_time.monotonic()
+        wakes = 0
+        while self.queue and self.queue[0][0] < self.end:
+            at, _, index, button = heapq.heappop(self.queue)
+            device = self.devices[index]
+            self.clock.now = at
+            sleep = device.wake(self, at, button if button >= 0 else None)
+            self.schedule(index, device.t + sleep, device.t)
+            wakes += 1
+        elapsed = real_time.monotonic() - started
+        print(f"Simulated {self.args.days} days of {len(self.devices)} devices ({wakes} wakes) "
+              f"in {elapsed:.0f} s")
+
+    def report(self) -> None:
+        days = self.args.days
+        print(f"\n{'device':<9}{'wakes':>6}{'online':>7}{'offline':>8}{'button':>7}{'radio s/d':>10}"
+              f"{'MB rx':>8}{'kB tx':>7}{'refresh':>8}{'mAh/d':>7}{'life d':>7}")
+        totals = dict.fromkeys(('wakes', 'online', 'offline', 'buttons', 'radio_s', 'rx', 'tx', 'refreshes', 'used_mas'), 0)
+        for device in self.devices:
+            s = device.stats
+            for key in totals:
+                totals[key] += s[key]
+            mah_day = s['used_mas'] / 3600 / days
+            print(f"{device.id:<9}{s['wakes']:>6}{s['online']:>7}{s['offline']:>8}{s['buttons']:>7}"
+                  f"{s['radio_s'] / days:>10.1f}{s['rx'] / 1e6:>8.2f}{s['tx'] / 1e3:>7.1f}{s['refreshes']:>8}"
+                  f"{mah_day:>7.1f}{self.args.battery_mah / mah_day if mah_day else 0:>7.0f}")
+        n = len(self.devices)
+        print(f"\nFleet: {totals['wakes']} wakes ({totals['online']} online, {totals['offline']} offline, "
+              f"{totals['buttons']} button), {totals['refreshes']} refreshes, "
+              f"{totals['rx'] / 1e6:.1f} MB down, {totals['tx'] / 1e6:.2f} MB up, "
+              f"{totals['radio_s'] / n / days:.1f} radio s per device-day, "
+              f"{totals['used_mas'] / 3600 / n / days:.1f} mAh per device-day")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--devices', type=int, default=50)
+    parser.add_argument('--days', type=float, default=7)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--presses-per-day', type=float, default=0.5, help="button presses per device and day")
+    parser.add_argument('--wifi-failure', type=float, default=0.02, help="chance a WiFi join fails")
+    parser.add_argument('--bandwidth-kbit', type=float, default=4000, help="effective WiFi throughput")
+    parser.add_argument('--battery-mah', type=float, default=12000)
+    args = parser.parse_args()
+
+    simulation = Simulation(args)
+    try:
+        simulation.run()
+        simulation.report()
+    finally:
+        simulation.server.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""End-to-end ImageManager benchmark: cold start to every slot ready.
+
+Starts bench/immich_standin.py in its own process, then imports the server
+from a scratch copy of taulu-api (empty state) pointed at it. Importing
+main is the cold start: the startup revalidation thread queues the first
+fetches. ensure_images() is then called every --poll seconds, as incoming
+requests would, until the three navigation slots, next_daily and the
+BUNDLE_DAYS - 1 upcoming images are all converted and on disk.
+
+    bench/imagemanager.py --assets 100 --latency-ms 40 --bandwidth-mbit 50
+
+Reports when each slot became ready, and the time spent searching, looking
+up assets, downloading and converting, summed over the fetch threads.
+Stand-in options (library, latency, bandwidth, photo size) are passed on.
+"""
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+import immich_standin
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+API_DIR = os.path.join(BENCH_DIR, '..')
+
+
+class Stages:
+    """Wall time per stage, summed over threads."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.seconds = {}
+        self.calls = {}
+
+    def wrap(self, name: str, fn):
+        def timed(*args, **kwargs):
+            start = time.perf_counter()
+            try:
+                return fn(*args, **kwargs)
+            finally:
+                with self.lock:
+                    self.seconds[name] = self.seconds.get(name, 0) + time.perf_counter() - start
+                    self.calls[name] = self.calls.get(name, 0) + 1
+        return timed
+
+
+def start_standin(argv: list) -> tuple:
+    process = subprocess.Popen([sys.executable, os.path.join(BENCH_DIR, 'immich_standin.py'), '--port', '0'] + argv,
+                               stdout=subprocess.PIPE, text=True)
+    line = process.stdout.readline()
+    if not line:
+        raise SystemExit("Immich stand-in did not start")
+    port = int(line.rsplit(' ', 1)[1])
+    return process, port
+
+
+def stop_standin(process) -> dict:
+    process.terminate()
+    out, _ = process.communicate(timeout=10)
+    return json.loads(out.strip().splitlines()[-1])
+
+
+def slots(manager, bundle_days: int) -> dict:
+    """Which slots hold a converted image right now."""
+    with manager.lock:
+        ready = {f'slot {i}': image is not None for i, image in enumerate(manager.images)}
+        ready['next_daily'] = manager.next_daily is not None
+        for i in range(bundle_days - 1):
+            ready[f'upcoming {i}'] = i < len(manager.upcoming)
+    return ready
+
+
+def slot_count(server) -> int:
+    """Navigation slots, next_daily and the upcoming daily images."""
+    return server.NUM_SLOTS + 1 + server.BUNDLE_DAYS - 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    immich_standin.add_arguments(parser)
+    parser.add_argument('--poll', type=float, default=0.1, help="seconds between ensure_images() calls")
+    parser.add_argument('--timeout', type=float, default=600)
+    args = parser.parse_args()
+
+    print("Preparing the Immich stand-in...", flush=True)
+    standin, port = start_standin(immich_standin.arguments(args))
+    workdir = tempfile.mkdtemp(prefix='imagemanager-')
+    try:
+        for name in os.listdir(API_DIR):
+            if name.endswith('.py') or name == 'people-ids.json':
+                shutil.copy(os.path.join(API_DIR, name), workdir)
+        os.environ.update(IMMICH_API_KEY='bench', IMMICH_BASE_URL=f'http://127.0.0.1:{port}',
+                          TELEMETRY_UDP_PORT='0')
+        sys.path.insert(0, workdir)
+
+        # Time the stages by wrapping the code ImageManager calls into
+        import immich
+        import prepare
+        stages = Stages()
+        immich.ImmichClient.search_assets = stages.wrap('search', immich.ImmichClient.search_assets)
+        immich.ImmichClient.get_asset_info = stages.wrap('asset info', immich.ImmichClient.get_asset_info)
+        immich.ImmichClient.download_asset = stages.wrap('download', immich.ImmichClient.download_asset)
+        prepare.convert_image_to_bin = stages.wrap('convert', prepare.convert_image_to_bin)
+
+        start = time.perf_counter()
+        import main as server
+        server.logger.setLevel('WARNING')
+        imported = time.perf_counter() - start
+
+        ready_at = {}
+        while time.perf_counter() - start < args.timeout:
+            server.manager.ensure_images()
+            now = time.perf_counter() - start
+            for name, ready in slots(server.manager, server.BUNDLE_DAYS).items():
+                if ready and name not in ready_at:
+                    ready_at[name] = now
+            if len(ready_at) == slot_count(server) and not server.manager.fetching:
+                break
+            time.sleep(args.poll)
+        total = time.perf_counter() - start
+    finally:
+        served = stop_standin(standin)
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    print(f"\nImport (cold start) {imported:.2f} s")
+    for name, at in sorted(ready_at.items(), key=lambda item: item[1]):
+        print(f"  {name:<12} ready at {at:7.2f} s")
+    missing = slot_count(server) - len(ready_at)
+    print(f"{'All slots ready' if not missing else f'{missing} slots not ready'} after {total:.2f} s")
+    print(f"\n{'stage':<12}{'calls':>7}{'total s':>9}{'mean ms':>9}")
+    for name in ('search', 'asset info', 'download', 'convert'):
+        calls = stages.calls.get(name, 0)
+        seconds = stages.seconds.get(name, 0)
+        print(f"{name:<12}{calls:>7}{seconds:>9.2f}{seconds / calls * 1000 if calls else 0:>9.0f}")
+    print(f"\nStand-in served {sum(served['requests'].values())} requests, {served['bytes'] / 1e6:.1f} MB: "
+          + ', '.join(f"{k} {v}" for k, v in sorted(served['requests'].items())))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""Local stand-in for the parts of the Immich API that ImmichClient uses.
+
+    POST /api/search/metadata       assets.items, without people (as Immich
+                                    returns them), so the client looks each
+                                    candidate up
+    GET  /api/asset/{id}            asset info with its people
+    GET  /api/assets/{id}/original  the image file
+
+The library is either a directory of images (--library) or --assets
+synthetic photos from bench/synthetic.py. --match-rate of the assets show
+all the people in people-ids.json, the rest only some of them. Every
+response waits --latency-ms first and bodies are sent at no more than
+--bandwidth-mbit, so a slow or remote Immich can be imitated.
+
+    bench/immich_standin.py --port 2283 --assets 200 --latency-ms 40 --bandwidth-mbit 50
+    IMMICH_BASE_URL=http://localhost:2283 IMMICH_API_KEY=any uv run main.py
+
+Prints one JSON line with request counts and bytes served when stopped.
+"""
+import argparse
+import json
+import os
+import random
+import signal
+import sys
+import threading
+import time
+import uuid
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import synthetic
+
+API_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+IMAGE_TYPES = ('.jpg', '.jpeg', '.png', '.webp', '.heic')
+
+
+class Library:
+    def __init__(self, args):
+        with open(args.people) as f:
+            self.people = json.load(f)
+        rng = random.Random(args.seed)
+        self.files = {}      # id -> path, for a directory library
+        self.photos = {}     # id -> bytes, for a synthetic one
+        if args.library:
+            names = sorted(n for n in os.listdir(args.library) if n.lower().endswith(IMAGE_TYPES))
+            for name in names:
+                self.files[str(uuid.uuid5(uuid.NAMESPACE_URL, name))] = os.path.join(args.library, name)
+            ids = list(self.files)
+        else:
+            width, height = (int(v) for v in args.photo_size.split('x'))
+            ids = []
+            for seed in range(args.assets):
+                asset_id = str(uuid.UUID(int=rng.getrandbits(128), version=4))
+                self.photos[asset_id] = synthetic.photo(seed, width, height, args.noise_bits)
+                ids.append(asset_id)
+        self.assets = {}
+        for asset_id in ids:
+            if rng.random() < args.match_rate or not self.people:
+                people = list(self.people)
+            else:
+                people = rng.sample(self.people, rng.randrange(len(self.people)))
+            self.assets[asset_id] = [{'id': p, 'name': ''} for p in people]
+
+    def original(self, asset_id: str) -> bytes:
+        if asset_id in self.photos:
+            return self.photos[asset_id]
+        with open(self.files[asset_id], 'rb') as f:
+            return f.read()
+
+
+class Counters:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.requests = {}
+        self.bytes = 0
+
+    def add(self, endpoint: str, size: int) -> None:
+        with self.lock:
+            self.requests[endpoint] = self.requests.get(endpoint, 0) + 1
+            self.bytes += size
+
+
+def make_handler(library: Library, counters: Counters, args):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = 'HTTP/1.1'
+
+        def log_message(self, format, *a):
+            if args.verbose:
+                super().log_message(format, *a)
+
+        def send(self, endpoint: str, status: int, body: bytes, content_type: str) -> None:
+            time.sleep(args.latency_ms / 1000)
+            self.send_response(status)
+            self.send_header('Content-Type', content_type)
+            self.send_header('Content-Length', str(len(body)))
+            self.end_headers()
+            # Paced in 16 KB pieces to the configured rate
+            chunk = 16 * 1024
+            start = time.monotonic()
+            for pos in range(0, len(body), chunk):
+                self.wfile.write(body[pos:pos + chunk])
+                if args.bandwidth_mbit > 0:
+                    due = start + (pos + chunk) * 8 / (args.bandwidth_mbit * 1e6)
+                    delay = due - time.monotonic()
+                    if delay > 0:
+                        time.sleep(delay)
+            counters.add(endpoint, len(body))
+
+        def send_json(self, endpoint: str, value, status: int = 200) -> None:
+            self.send(endpoint, status, json.dumps(value).encode(), 'application/json')
+
+        def authorized(self) -> bool:
+            if self.headers.get('x-api-key'):
+                return True
+            self.send_json('unauthorized', {'message': 'Authentication required'}, 401)
+            return False
+
+        def do_POST(self):
+            body = self.rfile.read(int(self.headers.get('Content-Length', 0)))
+            if not self.authorized():
+                return
+            if self.path != '/api/search/metadata':
+                self.send_json('not found', {'message': 'Not found'}, 404)
+                return
+            query = json.loads(body or b'{}')
+            wanted = set(query.get('personIds') or [])
+            # Immich matches any of the people; ImmichClient narrows it down
+            items = [{'id': asset_id, 'type': 'IMAGE', 'originalFileName': f'{asset_id}.png'}
+                     for asset_id, people in library.assets.items()
+                     if not wanted or wanted & {p['id'] for p in people}]
+            self.send_json('search', {'assets': {'total': len(items), 'count': len(items),
+                                                 'items': items, 'nextPage': None}})
+
+        def do_GET(self):
+            if not self.authorized():
+                return
+            parts = self.path.split('?')[0].strip('/').split('/')
+            if len(parts) == 3 and parts[:2] == ['api', 'asset'] and parts[2] in library.assets:
+                self.send_json('asset', {'id': parts[2], 'type': 'IMAGE', 'people': library.assets[parts[2]]})
+            elif len(parts) == 4 and parts[:2] == ['api', 'assets'] and parts[3] == 'original' \
+                    and parts[2] in library.assets:
+                self.send('original', 200, library.original(parts[2]), 'application/octet-stream')
+            else:
+                self.send_json('not found', {'message': 'Not found'}, 404)
+
+    return Handler
+
+
+def add_arguments(parser: argparse.ArgumentParser) -> None:
+    parser.add_argument('--library', help="directory of images (default: synthetic photos)")
+    parser.add_argument('--assets', type=int, default=100, help="synthetic photos in the library")
+    parser.add_argument('--photo-size', default='1200x900', help="synthetic photo size, WxH")
+    parser.add_argument('--noise-bits', type=int, default=2, help="random low bits per channel in synthetic photos")
+    parser.add_argument('--match-rate', type=float, default=0.5, help="share of assets showing all the people")
+    parser.add_argument('--people', default=os.path.join(API_DIR, 'people-ids.json'))
+    parser.add_argument('--latency-ms', type=float, default=20)
+    parser.add_argument('--bandwidth-mbit', type=float, default=100, help="0 for unlimited")
+    parser.add_argument('--seed', type=int, default=1)
+
+
+def arguments(args) -> list:
+    """Command line for a stand-in with the options in `args`."""
+    argv = ['--assets', str(args.assets), '--photo-size', args.photo_size,
+            '--noise-bits', str(args.noise_bits), '--match-rate', str(args.match_rate),
+            '--people', args.people, '--latency-ms', str(args.latency_ms),
+            '--bandwidth-mbit', str(args.bandwidth_mbit), '--seed', str(args.seed)]
+    if args.library:
+        argv += ['--library', args.library]
+    return argv
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--port', type=int, default=2283)
+    parser.add_argument('--verbose', action='store_true')
+    add_arguments(parser)
+    args = parser.parse_args()
+
+    library = Library(args)
+    counters = Counters()
+    server = ThreadingHTTPServer(('127.0.0.1', args.port), make_handler(library, counters, args))
+    print(f"Immich stand-in with {len(library.assets)} assets on port {server.server_address[1]}", flush=True)
+    def stop(signum, frame):
+        raise KeyboardInterrupt
+    signal.signal(signal.SIGTERM, stop)
+    signal.signal(signal.SIGINT, stop)  # ignored by default when started in the background
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print(json.dumps({'requests': counters.requests, 'bytes': counters.bytes}), flush=True)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
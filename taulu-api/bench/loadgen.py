@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+"""Load generator replaying the firmware's per-wake traffic against a server.
+
+Each simulated device wakes on a schedule and makes the requests setup()
+in esp32-client/src/main.cpp makes, in its order and with its bodies:
+
+    logs (WiFi connected)          device-status awake
+    action (button wakes) / logs   current.json
+    logs                           device-status display_unchanged, or
+                                   logs x2, image.bin, logs, then the
+                                   refresh window: queued logs over one
+                                   kept-alive connection, device-status
+                                   display_updated, bundle.bin (when due)
+    ota.json                       current.json (sleep duration)
+    device-status sleeping         logs (entering deep sleep)
+
+Telemetry is CBOR like the firmware's (esp32-client/src/Telemetry.h), and
+every request other than the log flush opens its own connection, as
+HTTPClient does on the device. A device downloads image.bin only when the
+server's imageId differs from the one it last showed.
+
+    bench/loadgen.py http://localhost:3000 --devices 300 --period 60 --rounds 3
+
+Wakes are spread over each --period seconds (an hour, compressed) by
+--distribution: 'aligned' puts every device on the period boundary, which is
+what servers returning "sleep to the next hour" produce, with --jitter
+seconds of clock drift; 'uniform' spreads them evenly; 'poisson' draws
+independent arrivals. Reports latency percentiles, request rate and
+throughput per endpoint.
+"""
+import argparse
+import http.client
+import json
+import random
+import struct
+import threading
+import time
+import urllib.parse
+from concurrent.futures import ThreadPoolExecutor
+
+USER_AGENT = 'ESP32-Glance-v3/loadgen'
+CBOR_TYPE = 'application/cbor'
+
+# Field ids, in sync with TM_* in esp32-client/src/Telemetry.h
+TM_DEVICE_ID = 1
+TM_STATUS = 2
+TM_STATUS_NAME = 3
+TM_BATTERY_VOLTAGE = 4
+TM_BATTERY_PERCENT = 5
+TM_IS_CHARGING = 6
+TM_SIGNAL_STRENGTH = 7
+TM_FIRMWARE_VERSION = 8
+TM_FREE_HEAP = 9
+TM_PSRAM_FREE = 10
+TM_UPTIME = 11
+TM_BOOT_COUNT = 12
+TM_USED_FALLBACK = 13
+TM_LOG_MESSAGE = 14
+TM_LOG_LEVEL = 15
+TM_DEVICE_TIME = 16
+
+
+def _cbor_head(major: int, value: int) -> bytes:
+    if value < 24:
+        return bytes([major << 5 | value])
+    if value < 0x100:
+        return bytes([major << 5 | 24, value])
+    if value < 0x10000:
+        return bytes([major << 5 | 25]) + struct.pack('>H', value)
+    return bytes([major << 5 | 26]) + struct.pack('>I', value)
+
+
+def cbor(value) -> bytes:
+    """The subset of CBOR the firmware's CborWriter emits."""
+    if isinstance(value, bool):
+        return bytes([0xF5 if value else 0xF4])
+    if isinstance(value, int):
+        return _cbor_head(0, value) if value >= 0 else _cbor_head(1, -1 - value)
+    if isinstance(value, float):
+        return b'\xFA' + struct.pack('>f', value)
+    if isinstance(value, str):
+        data = value.encode()
+        return _cbor_head(3, len(data)) + data
+    if isinstance(value, dict):
+        return _cbor_head(5, len(value)) + b''.join(cbor(k) + cbor(v) for k, v in value.items())
+    raise TypeError(f"cannot encode {type(value).__name__}")
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latency = {}     # endpoint -> [seconds]
+        self.bytes = {}       # endpoint -> response bytes
+        self.errors = {}      # endpoint -> count
+
+    def record(self, endpoint: str, seconds: float, size: int, ok: bool) -> None:
+        with self.lock:
+            self.latency.setdefault(endpoint, []).append(seconds)
+            self.bytes[endpoint] = self.bytes.get(endpoint, 0) + size
+            if not ok:
+                self.errors[endpoint] = self.errors.get(endpoint, 0) + 1
+
+
+class Device:
+    def __init__(self, index: int, server, args, stats: Stats):
+        self.id = f"load-{index:04d}"
+        self.server = server
+        self.args = args
+        self.stats = stats
+        self.rng = random.Random(index)
+        self.last_image_id = ''
+        self.boot_count = 0
+        self.wakes_since_bundle = args.bundle_every  # due on the first wake
+
+    # -- transport --------------------------------------------------------------
+
+    def connect(self) -> http.client.HTTPConnection:
+        kind = http.client.HTTPSConnection if self.server.scheme == 'https' else http.client.HTTPConnection
+        return kind(self.server.hostname, self.server.port, timeout=self.args.timeout)
+
+    def request(self, method: str, endpoint: str, body: bytes = None, content_type: str = None,
+                conn: http.client.HTTPConnection = None) -> bytes:
+        path = f"{self.server.path.rstrip('/')}/api/{endpoint}"
+        headers = {'User-Agent': USER_AGENT}
+        if content_type:
+            headers['Content-Type'] = content_type
+        own = conn is None
+        if own:
+            conn = self.connect()
+        name = endpoint.split('?')[0]
+        start = time.perf_counter()
+        try:
+            conn.request(method, path, body=body, headers=headers)
+            response = conn.getresponse()
+            data = response.read()
+            ok = response.status == 200
+        except (OSError, http.client.HTTPException):
+            data, ok = b'', False
+            if not own:
+                conn.close()
+        self.stats.record(name, time.perf_counter() - start, len(data), ok)
+        if own:
+            conn.close()
+        return data if ok else None
+
+    # -- firmware requests ------------------------------------------------------
+
+    def status(self, name: str) -> None:
+        body = cbor({TM_DEVICE_ID: self.id, TM_STATUS: {
+            TM_STATUS_NAME: name, TM_BATTERY_VOLTAGE: 3.92, TM_BATTERY_PERCENT: 78,
+            TM_IS_CHARGING: False, TM_SIGNAL_STRENGTH: -61, TM_FIRMWARE_VERSION: 'loadgen',
+            TM_FREE_HEAP: 180000, TM_PSRAM_FREE: 7300000, TM_UPTIME: int(self.uptime() * 1000),
+            TM_BOOT_COUNT: self.boot_count, TM_USED_FALLBACK: False}})
+        self.request('POST', 'device-status', body, CBOR_TYPE)
+
+    def log(self, message: str, level: str = 'INFO', conn=None) -> None:
+        body = cbor({TM_DEVICE_ID: self.id, TM_LOG_MESSAGE: message, TM_LOG_LEVEL: level,
+                     TM_DEVICE_TIME: int(self.uptime() * 1000)})
+        self.request('POST', 'logs', body, CBOR_TYPE, conn)
+
+    def current(self):
+        data = self.request('GET', 'current.json')
+        try:
+            return json.loads(data) if data else None
+        except ValueError:
+            return None
+
+    def uptime(self) -> float:
+        return time.perf_counter() - self.woke
+
+    # -- one wake ---------------------------------------------------------------
+
+    def wake(self) -> None:
+        self.woke = time.perf_counter()
+        self.boot_count += 1
+        self.log('WiFi connected, signal: -61 dBm')
+        self.status('awake')
+        if self.rng.random() < self.args.button_rate:
+            body = json.dumps({'deviceId': self.id, 'action': self.rng.choice(('previous', 'next'))}).encode()
+            self.request('POST', 'action', body, 'application/json')
+        else:
+            self.log('Timer wake, checking for new image')
+
+        metadata = self.current()
+        failed = metadata is None
+        if failed:
+            self.log('Metadata fetch failed, skipping display update', 'ERROR')
+            self.status('metadata_fetch_failed')
+        elif metadata['imageId'] == self.last_image_id and not self.args.always_download:
+            self.log('Image unchanged, skipping update to save power')
+            self.status('display_unchanged')
+        else:
+            self.log('Image changed, will update display')
+            self.log('Starting display update for new image')
+            self.log('Downloading new image')
+            endpoint = 'display-list.bin' if metadata.get('displayList') else 'image.bin'
+            if self.request('GET', endpoint) is None:
+                failed = True
+                self.log('Download failed, keeping previous image on display', 'ERROR')
+                self.status('download_failed')
+            else:
+                self.last_image_id = metadata['imageId']
+                # Refresh window: logs deferred during panel init go out over one connection
+                conn = self.connect()
+                for message in ('Download successful, initializing display',
+                                'Rendering image to display (30-45s)'):
+                    self.log(message, conn=conn)
+                conn.close()
+                self.status('display_updated')
+
+        self.wakes_since_bundle += 1
+        if self.args.bundle_every and self.wakes_since_bundle >= self.args.bundle_every:
+            self.wakes_since_bundle = 0
+            self.request('GET', f'bundle.bin?count={self.args.bundle_count}')
+        self.request('GET', 'ota.json?from=loadgen')
+
+        if failed:
+            self.log('Using 15-minute sleep due to download failure')
+        else:
+            self.current()
+        self.status('sleeping')
+        self.log('Entering deep sleep for 60 minutes')
+
+
+def schedule(args) -> list:
+    """(start offset in seconds, device index) for every wake of the run."""
+    rng = random.Random(args.seed)
+    wakes = []
+    for round_ in range(args.rounds):
+        base = round_ * args.period
+        if args.distribution == 'poisson':
+            t = base
+            order = list(range(args.devices))
+            rng.shuffle(order)
+            for device in order:
+                t += rng.expovariate(args.devices / args.period)
+                wakes.append((min(t, base + args.period), device))
+            continue
+        for device in range(args.devices):
+            if args.distribution == 'aligned':
+                offset = abs(rng.gauss(0, args.jitter))
+            else:
+                offset = rng.uniform(0, args.period)
+            wakes.append((base + offset, device))
+    return sorted(wakes)
+
+
+def percentile(sorted_values: list, p: float) -> float:
+    index = min(len(sorted_values) - 1, int(round(p / 100 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def report(stats: Stats, elapsed: float) -> None:
+    print(f"\n{'endpoint':<16}{'count':>7}{'err':>5}{'req/s':>8}{'p50 ms':>9}{'p90 ms':>9}"
+          f"{'p99 ms':>9}{'max ms':>9}{'MB/s':>8}")
+    total = 0
+    for endpoint in sorted(stats.latency):
+        values = sorted(stats.latency[endpoint])
+        total += len(values)
+        print(f"{endpoint:<16}{len(values):>7}{stats.errors.get(endpoint, 0):>5}{len(values) / elapsed:>8.1f}"
+              f"{percentile(values, 50) * 1000:>9.1f}{percentile(values, 90) * 1000:>9.1f}"
+              f"{percentile(values, 99) * 1000:>9.1f}{values[-1] * 1000:>9.1f}"
+              f"{stats.bytes[endpoint] / elapsed / 1e6:>8.2f}")
+    print(f"\n{total} requests in {elapsed:.1f} s ({total / elapsed:.1f} req/s), "
+          f"{sum(stats.errors.values())} errors, {sum(stats.bytes.values()) / 1e6:.1f} MB received")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('server', help="base URL, e.g. http://localhost:3000")
+    parser.add_argument('--devices', type=int, default=200)
+    parser.add_argument('--period', type=float, default=60, help="seconds between a device's wakes")
+    parser.add_argument('--rounds', type=int, default=3, help="wakes per device")
+    parser.add_argument('--distribution', choices=('aligned', 'uniform', 'poisson'), default='aligned')
+    parser.add_argument('--jitter', type=float, default=2.0, help="clock drift spread for aligned wakes, seconds")
+    parser.add_argument('--button-rate', type=float, default=0.02, help="share of wakes from a button press")
+    parser.add_argument('--always-download', action='store_true', help="fetch image.bin on every wake")
+    parser.add_argument('--bundle-every', type=int, default=0, help="fetch bundle.bin every N wakes (0: never)")
+    parser.add_argument('--bundle-count', type=int, default=3)
+    parser.add_argument('--timeout', type=float, default=60)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    server = urllib.parse.urlsplit(args.server)
+    stats = Stats()
+    devices = [Device(i, server, args, stats) for i in range(args.devices)]
+    wakes = schedule(args)
+    print(f"{len(wakes)} wakes of {args.devices} devices over {args.rounds * args.period:.0f} s "
+          f"({args.distribution})")
+
+    # A device's wakes are a period apart, so one worker per device is enough
+    # for a wake never to wait on another.
+    start = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=args.devices) as pool:
+        for offset, index in wakes:
+            delay = start + offset - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+            pool.submit(devices[index].wake)
+    report(stats, time.perf_counter() - start)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+"""Inspect, replay and compare wake captures from CAPTURE_SESSION builds.
+
+A capture (esp32-client/src/Capture.h, uploaded to state/captures/) holds
+every byte a wake sent and received over HTTP, the panel commands and a
+CRC of the panel data, and the wake's phase timings.
+
+    bench/replay.py show capture.bin
+        Timeline: phases, requests with sizes and times, panel traffic.
+
+    bench/replay.py serve capture.bin [--port 3000] [--speed 1]
+        Answer a device with the recorded responses, byte for byte. Point a
+        build without SERVER_TLS at this host (SERVER_HOST) and it gets the
+        same metadata, image and bundle as in the capture. Requests are
+        matched by method and path in recorded order. --speed 1 releases
+        response bytes no faster than the device originally read them,
+        --speed 10 ten times faster, --speed 0 at once. Receive times are
+        when the device read the bytes, so they include its own processing;
+        compare decode changes at --speed 0.
+
+    bench/replay.py compare before.bin after.bin
+        Phase durations side by side, and whether the panel got the same
+        commands and data.
+"""
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+MAGIC = b'TCP1'
+
+CONNECT = 1
+SEND = 2
+RECEIVE = 3
+CLOSE = 4
+SPI_BYTE = 5
+SPI_COMMAND = 6
+SPI_DATA = 7
+MARK = 8
+
+KIND_NAMES = {CONNECT: 'connect', SEND: 'send', RECEIVE: 'receive', CLOSE: 'close',
+              SPI_BYTE: 'spi byte', SPI_COMMAND: 'spi command', SPI_DATA: 'spi data', MARK: 'mark'}
+
+
+class Exchange:
+    """One request on a recorded connection and the response bytes read for it."""
+
+    def __init__(self, stream: int, start: int):
+        self.stream = stream
+        self.start = start      # us, first request byte
+        self.sent_at = start    # us, last request byte
+        self.request = bytearray()
+        self.response = []      # (us, bytes)
+
+    @property
+    def request_line(self) -> str:
+        return self.request.split(b'\r\n', 1)[0].decode(errors='replace')
+
+    @property
+    def key(self) -> tuple:
+        method, path = (self.request_line.split(' ') + ['', ''])[:2]
+        return method, path
+
+    @property
+    def response_bytes(self) -> int:
+        return sum(len(chunk) for _, chunk in self.response)
+
+    @property
+    def closes(self) -> bool:
+        head = b''.join(chunk for _, chunk in self.response).split(b'\r\n\r\n', 1)[0].lower()
+        return b'connection: close' in head
+
+
+class Capture:
+    def __init__(self, data: bytes):
+        magic, length, self.dropped, _ = struct.unpack_from('<4sIII', data)
+        if magic != MAGIC:
+            raise ValueError("not a wake capture")
+        self.records = []   # (kind, stream, us, payload)
+        pos, end = 16, 16 + length
+        while pos + 12 <= end:
+            kind, stream, _, at, size = struct.unpack_from('<BBHII', data, pos)
+            pos += 12
+            self.records.append((kind, stream, at, data[pos:pos + size]))
+            pos += (size + 3) & ~3
+        self.exchanges = self._exchanges()
+
+    def _exchanges(self) -> list:
+        done, current = [], {}
+        for kind, stream, at, payload in self.records:
+            exchange = current.get(stream)
+            if kind == SEND:
+                if exchange is None or exchange.response:
+                    if exchange is not None:
+                        done.append(exchange)
+                    exchange = current[stream] = Exchange(stream, at)
+                exchange.request += payload
+                exchange.sent_at = at
+            elif kind == RECEIVE and exchange is not None:
+                exchange.response.append((at, payload))
+            elif kind in (CONNECT, CLOSE) and exchange is not None:
+                done.append(current.pop(stream))
+        done.extend(current.values())
+        return sorted(done, key=lambda e: e.start)
+
+    def marks(self) -> list:
+        return [(payload[4:].decode(errors='replace'), struct.unpack_from('<I', payload)[0], at)
+                for kind, _, at, payload in self.records if kind == MARK]
+
+    def panel(self) -> list:
+        """Panel traffic in order: ('cmd', cs, bytes), ('byte', value) and ('data', length, crc)."""
+        out = []
+        for kind, stream, _, payload in self.records:
+            if kind == SPI_COMMAND:
+                out.append(('cmd', stream, bytes(payload)))
+            elif kind == SPI_BYTE:
+                out.append(('byte', payload[0]))
+            elif kind == SPI_DATA:
+                out.append(('data',) + struct.unpack('<II', payload))
+        return out
+
+    @property
+    def duration(self) -> int:
+        return self.records[-1][2] if self.records else 0
+
+
+def load(path: str) -> Capture:
+    with open(path, 'rb') as f:
+        return Capture(f.read())
+
+
+# -- show ------------------------------------------------------------------------
+
+def show(capture: Capture) -> None:
+    print(f"{len(capture.records)} records over {capture.duration / 1e6:.2f} s"
+          + (f", {capture.dropped} dropped (buffer full)" if capture.dropped else ""))
+    print("\nPhases")
+    for name, ms, at in capture.marks():
+        print(f"  {at / 1e6:8.3f} s  {name:<16}{ms:>7} ms")
+    print("\nRequests")
+    for e in capture.exchanges:
+        first = e.response[0][0] if e.response else e.sent_at
+        last = e.response[-1][0] if e.response else e.sent_at
+        print(f"  {e.start / 1e6:8.3f} s  #{e.stream:<3} {e.request_line[:60]:<60} "
+              f"{len(e.request):>6} B out {e.response_bytes:>8} B in  "
+              f"first byte {(first - e.sent_at) / 1e3:7.1f} ms  done {(last - e.start) / 1e3:8.1f} ms")
+    panel = capture.panel()
+    commands = sum(1 for p in panel if p[0] != 'data')
+    data = [p for p in panel if p[0] == 'data']
+    print(f"\nPanel: {commands} commands, {len(data)} data writes, "
+          f"{sum(p[1] for p in data)} bytes")
+
+
+# -- serve -----------------------------------------------------------------------
+
+class Replayer:
+    def __init__(self, capture: Capture, speed: float):
+        self.speed = speed
+        self.lock = threading.Lock()
+        self.queues = {}
+        for e in capture.exchanges:
+            if e.response:
+                self.queues.setdefault(e.key, []).append(e)
+        self.last = {}
+
+    def take(self, method: str, path: str):
+        with self.lock:
+            for key in ((method, path), (method, path.split('?')[0])):
+                queue = self.queues.get(key)
+                if queue:
+                    self.last[key] = queue.pop(0)
+                    return self.last[key]
+            for key, exchange in self.last.items():
+                if key[0] == method and key[1].split('?')[0] == path.split('?')[0]:
+                    return exchange  # asked again: answer as before
+        return None
+
+    def answer(self, conn: socket.socket, exchange: Exchange) -> None:
+        start = time.monotonic()
+        for at, chunk in exchange.response:
+            if self.speed > 0:
+                delay = start + (at - exchange.sent_at) / 1e6 / self.speed - time.monotonic()
+                if delay > 0:
+                    time.sleep(delay)
+            conn.sendall(chunk)
+
+    def handle(self, conn: socket.socket, peer) -> None:
+        reader = conn.makefile('rb')
+        try:
+            while True:
+                line = reader.readline()
+                if not line:
+                    return
+                headers = {}
+                while True:
+                    header = reader.readline()
+                    if header in (b'\r\n', b'\n', b''):
+                        break
+                    name, _, value = header.decode(errors='replace').partition(':')
+                    headers[name.strip().lower()] = value.strip()
+                reader.read(int(headers.get('content-length', 0)))
+                method, path = (line.decode(errors='replace').split(' ') + ['', ''])[:2]
+                exchange = self.take(method, path)
+                if exchange is None:
+                    print(f"{peer[0]}: {method} {path} not in capture")
+                    conn.sendall(b'HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n')
+                    return
+                print(f"{peer[0]}: {method} {path} -> {exchange.response_bytes} bytes")
+                self.answer(conn, exchange)
+                if exchange.closes:
+                    return
+        except OSError:
+            pass
+        finally:
+            reader.close()
+            conn.close()
+
+
+def serve(capture: Capture, port: int, speed: float) -> None:
+    replayer = Replayer(capture, speed)
+    server = socket.create_server(('', port))
+    print(f"Replaying {len(capture.exchanges)} requests on port {port} at "
+          f"{'full speed' if speed <= 0 else f'{speed:g}x'}")
+    while True:
+        conn, peer = server.accept()
+        threading.Thread(target=replayer.handle, args=(conn, peer), daemon=True).start()
+
+
+# -- compare ---------------------------------------------------------------------
+
+def compare(a: Capture, b: Capture) -> int:
+    print(f"{'phase':<18}{'before ms':>10}{'after ms':>10}{'change':>9}")
+    after = {}
+    for name, ms, _ in b.marks():
+        after.setdefault(name, []).append(ms)
+    for name, ms, _ in a.marks():
+        other = after.get(name)
+        if other:
+            ms_b = other.pop(0)
+            change = f"{(ms_b - ms) / ms * 100:+.0f}%" if ms else ''
+            print(f"{name:<18}{ms:>10}{ms_b:>10}{change:>9}")
+        else:
+            print(f"{name:<18}{ms:>10}{'-':>10}")
+    for name, left in after.items():
+        for ms_b in left:
+            print(f"{name:<18}{'-':>10}{ms_b:>10}")
+    print(f"{'wake':<18}{a.duration // 1000:>10}{b.duration // 1000:>10}")
+
+    pa, pb = a.panel(), b.panel()
+    if pa == pb:
+        print(f"\nPanel traffic identical ({len(pa)} writes)")
+        return 0
+    index = next((i for i, (x, y) in enumerate(zip(pa, pb)) if x != y), min(len(pa), len(pb)))
+    print(f"\nPanel traffic differs at write {index}: "
+          f"{pa[index] if index < len(pa) else 'end'} vs {pb[index] if index < len(pb) else 'end'}")
+    return 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest='command', required=True)
+    commands.add_parser('show').add_argument('capture')
+    serve_parser = commands.add_parser('serve')
+    serve_parser.add_argument('capture')
+    serve_parser.add_argument('--port', type=int, default=3000)
+    serve_parser.add_argument('--speed', type=float, default=1.0)
+    compare_parser = commands.add_parser('compare')
+    compare_parser.add_argument('before')
+    compare_parser.add_argument('after')
+    args = parser.parse_args()
+
+    if args.command == 'show':
+        show(load(args.capture))
+    elif args.command == 'serve':
+        serve(load(args.capture), args.port, args.speed)
+    else:
+        sys.exit(compare(load(args.before), load(args.after)))
+
+
+if __name__ == '__main__':
+    main()
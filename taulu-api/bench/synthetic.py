@@ -0,0 +1,58 @@
+"""Synthetic photos for the benchmarks and simulators in this directory.
+
+Images are generated from a seed and PNG-encoded with the standard library
+only, so the tools run anywhere and the same seed always gives the same
+bytes. They are busy enough (gradients, blocks of saturated colour) to give
+the dithering in prepare.py real work to do.
+"""
+import random
+import struct
+import zlib
+
+
+def _chunk(kind: bytes, data: bytes) -> bytes:
+    return struct.pack('>I', len(data)) + kind + data + struct.pack('>I', zlib.crc32(kind + data))
+
+
+def encode_png(width: int, height: int, rows: list[bytes]) -> bytes:
+    """8-bit RGB PNG from `height` rows of width * 3 bytes."""
+    raw = b''.join(b'\x00' + row for row in rows)  # filter type 0 on every row
+    return (b'\x89PNG\r\n\x1a\n'
+            + _chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 2, 0, 0, 0))
+            + _chunk(b'IDAT', zlib.compress(raw, 6))
+            + _chunk(b'IEND', b''))
+
+
+def photo(seed: int, width: int = 1200, height: int = 900, noise_bits: int = 0) -> bytes:
+    """A deterministic landscape 'photo' for `seed`.
+
+    noise_bits of random low bits per channel make it compress like a real
+    photo instead of a few kilobytes.
+    """
+    rng = random.Random(seed)
+    r0, g0, b0 = (rng.randrange(256) for _ in range(3))
+    # One wide gradient row; every image row is a shifted slice of it
+    base = bytearray()
+    for x in range(2 * width):
+        base += bytes(((r0 + x) & 0xFF, (g0 + x // 2) & 0xFF, (b0 + 255 - x // 3) & 0xFF))
+    blocks = []
+    for _ in range(rng.randrange(3, 8)):
+        w, h = rng.randrange(width // 10, width // 3), rng.randrange(height // 10, height // 3)
+        x, y = rng.randrange(width - w), rng.randrange(height - h)
+        colour = bytes(rng.choice([(255, 0, 0), (0, 160, 0), (0, 0, 255), (255, 220, 0), (20, 20, 20), (240, 240, 240)]))
+        blocks.append((x, y, w, h, colour * w))
+
+    # Noise is merged a whole row at a time as one big integer
+    mask = int.from_bytes(bytes([(1 << noise_bits) - 1]) * (width * 3), 'big')
+    rows = []
+    for y in range(height):
+        shift = (y * 3 // 4) % width
+        row = bytearray(base[shift * 3:(shift + width) * 3])
+        for x, by, w, h, fill in blocks:
+            if by <= y < by + h:
+                row[x * 3:(x + w) * 3] = fill
+        if noise_bits:
+            value = int.from_bytes(row, 'big') & ~mask | int.from_bytes(rng.randbytes(width * 3), 'big') & mask
+            row = value.to_bytes(width * 3, 'big')
+        rows.append(bytes(row))
+    return encode_png(width, height, rows)
@@ -0,0 +1,116 @@
+"""Compact display lists, rasterised on the device by GUI_Paint.
+
+For text and graphics screens (calendar, weather, captions) a list of drawing
+operations is a few KB instead of a 960 KB frame. The wire format is
+documented in esp32-client/src/DisplayList.h and must stay in sync with it.
+"""
+import struct
+
+WIDTH = 1200
+HEIGHT = 1600
+
+MAGIC = b'TDL1'
+
+OP_END = 0x00
+OP_RECT = 0x01
+OP_LINE = 0x02
+OP_CIRCLE = 0x03
+OP_TEXT = 0x04
+OP_ICON = 0x05
+OP_IMAGE = 0x06
+
+TRANSPARENT = 0xFF
+
+# Panel color indexes (EPD_13in3e.h)
+COLORS = {
+    'black': 0x0,
+    'white': 0x1,
+    'yellow': 0x2,
+    'red': 0x3,
+    'blue': 0x5,
+    'green': 0x6,
+}
+
+# Font id by glyph height; widths are 5, 7, 11, 14 and 17 px
+FONTS = {8: 0, 12: 1, 16: 2, 20: 3, 24: 4}
+
+ICONS = {'sun': 0, 'cloud': 1, 'rain': 2, 'snow': 3, 'battery-low': 4}
+
+
+def _color(value) -> int:
+    if isinstance(value, int):
+        if not 0 <= value <= 0xF:
+            raise ValueError(f"color index out of range: {value}")
+        return value
+    if value in (None, 'transparent'):
+        return TRANSPARENT
+    try:
+        return COLORS[value]
+    except KeyError:
+        raise ValueError(f"unknown color: {value}") from None
+
+
+class DisplayList:
+    def __init__(self, background='white', width: int = WIDTH, height: int = HEIGHT):
+        self.width = width
+        self.height = height
+        self.background = _color(background)
+        self.ops: list[bytes] = []
+
+    def rect(self, x0: int, y0: int, x1: int, y1: int, color='black', fill: bool = False, width: int = 1):
+        self.ops.append(struct.pack('<BHHHHBBB', OP_RECT, x0, y0, x1, y1, _color(color), int(fill), width))
+        return self
+
+    def line(self, x0: int, y0: int, x1: int, y1: int, color='black', width: int = 1, dotted: bool = False):
+        self.ops.append(struct.pack('<BHHHHBBB', OP_LINE, x0, y0, x1, y1, _color(color), width, int(dotted)))
+        return self
+
+    def circle(self, x: int, y: int, radius: int, color='black', fill: bool = False, width: int = 1):
+        self.ops.append(struct.pack('<BHHHBBB', OP_CIRCLE, x, y, radius, _color(color), int(fill), width))
+        return self
+
+    def text(self, x: int, y: int, text: str, size: int = 24, color='black', background=None, scale: int = 1):
+        """ASCII text; '\\n' starts a new line. Non-ASCII characters are drawn as '?'."""
+        if size not in FONTS:
+            raise ValueError(f"font size must be one of {sorted(FONTS)}")
+        data = text.encode('ascii', errors='replace')
+        if len(data) > 255:
+            raise ValueError("text op is limited to 255 characters")
+        self.ops.append(struct.pack('<BHHBBBBB', OP_TEXT, x, y, FONTS[size], _color(color),
+                                    _color(background), scale, len(data)) + data)
+        return self
+
+    def icon(self, x: int, y: int, name: str, color='black', scale: int = 1):
+        """Built-in 16x16 icon, drawn `scale` times larger."""
+        self.ops.append(struct.pack('<BHHBBB', OP_ICON, x, y, ICONS[name], _color(color), scale))
+        return self
+
+    def image(self, x: int, y: int, width: int, height: int, packed: bytes):
+        """Packed 4bpp pixels (two per byte, high nibble first), ceil(width / 2) bytes per row."""
+        expected = (width + 1) // 2 * height
+        if len(packed) != expected:
+            raise ValueError(f"image data is {len(packed)} bytes, expected {expected}")
+        self.ops.append(struct.pack('<BHHHH', OP_IMAGE, x, y, width, height) + packed)
+        return self
+
+    def encode(self) -> bytes:
+        header = struct.pack('<4sHHBBH', MAGIC, self.width, self.height, self.background, 0, 0)
+        return header + b''.join(self.ops) + bytes([OP_END])
+
+
+def from_json(doc: dict) -> DisplayList:
+    """Build a list from {"background": ..., "ops": [{"op": "text", ...}, ...]}.
+
+    Each op's remaining keys are passed to the DisplayList method of the same
+    name; images carry their packed pixels as a hex string in "data".
+    """
+    dl = DisplayList(background=doc.get('background', 'white'))
+    for op in doc.get('ops', []):
+        args = dict(op)
+        kind = args.pop('op', None)
+        if kind == 'image':
+            args['packed'] = bytes.fromhex(args.pop('data', ''))
+        if kind not in ('rect', 'line', 'circle', 'text', 'icon', 'image'):
+            raise ValueError(f"unknown op: {kind}")
+        getattr(dl, kind)(**args)
+    return dl
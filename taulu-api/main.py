@@ -1,18 +1,28 @@
 import os
 import json
+import time
+import zlib
+import struct
+import hashlib
+import hmac
 import datetime
 import threading
 import logging
+import socket
 from io import BytesIO
-from flask import Flask, jsonify, request, Response
+from flask import Flask, jsonify, request, Response, send_file
 from dotenv import load_dotenv
 
 from immich import ImmichClient
-from prepare import convert_image_to_bin
+from prepare import convert_image_to_bin, PIPELINE_VERSION, DITHER_MODES, DITHER_FLOYD_STEINBERG
+import displaylist
+import telemetry
+import ota
 
 load_dotenv()
 
 app = Flask(__name__)
+app.config['MAX_CONTENT_LENGTH'] = 8 * 1024 * 1024  # a wake capture is up to 4 MB, a firmware image 2 MB
 
 logging.basicConfig(
     level=logging.INFO,
@@ -26,12 +36,28 @@ HEIGHT = 1600
 READY_DIR = os.path.join(os.path.dirname(__file__), 'state')
 STATE_FILE = os.path.join(os.path.dirname(__file__), 'state', 'state.json')
 PEOPLE_IDS_FILE = os.path.join(os.path.dirname(__file__), 'people-ids.json')
+DISPLAY_LIST_FILE = os.path.join(os.path.dirname(__file__), 'state', 'display-list.bin')
+LOG_RING_DIR = os.path.join(os.path.dirname(__file__), 'state', 'logs')
+CAPTURE_DIR = os.path.join(os.path.dirname(__file__), 'state', 'captures')
+FIRMWARE_DIR = os.path.join(os.path.dirname(__file__), 'state', 'firmware')
 
 SLEEP_MINUTES = os.getenv("SLEEP_MINUTES")
 REFRESH_HOUR = os.getenv("REFRESH_HOUR")
+BUNDLE_DAYS = int(os.getenv("BUNDLE_DAYS", "3"))  # daily images kept ready ahead of time
+BUNDLE_MAGIC = b'TBD1'
+TELEMETRY_UDP_PORT = int(os.getenv("TELEMETRY_UDP_PORT", "3001"))  # 0 disables the listener
+FRAME_WAIT_SECONDS = float(os.getenv("FRAME_WAIT_SECONDS", "20"))  # image.bin waits this long for a frame in conversion
+DITHER_MODE = os.getenv("DITHER_MODE", DITHER_FLOYD_STEINBERG)  # default; devices can ask for another with ?dither=
+FIRMWARE_TOKEN = os.getenv("FIRMWARE_TOKEN")  # bearer token for firmware uploads; unset refuses them
+DEBUG_UPLOAD_TOKEN = os.getenv("DEBUG_UPLOAD_TOKEN")  # bearer token for wake captures and log rings; unset refuses them
+OTA_PATCH_MAX = int(os.getenv("OTA_PATCH_MAX", str(0x40000)))  # size of the devices' otapatch partition
 
 os.makedirs(READY_DIR, exist_ok=True)
 
+if DITHER_MODE not in DITHER_MODES:
+    logger.warning(f"Invalid DITHER_MODE: {DITHER_MODE}, defaulting to {DITHER_FLOYD_STEINBERG}")
+    DITHER_MODE = DITHER_FLOYD_STEINBERG
+
 try:
     with open(PEOPLE_IDS_FILE, 'r') as f:
         PEOPLE_IDS = json.load(f)
@@ -43,24 +69,115 @@ IMMICH_API_KEY = os.getenv("IMMICH_API_KEY")
 IMMICH_BASE_URL = os.getenv("IMMICH_BASE_URL")
 immich_client = ImmichClient(api_key=IMMICH_API_KEY, base_url=IMMICH_BASE_URL) if IMMICH_API_KEY else None
 
+# ---------------------------------------------------------------------------
+# Frame preparation
+#   One download and conversion per (asset, pipeline version, dither mode) at
+#   a time, however many slots or requests want it; the others wait for it.
+#   Frames stay on disk, so an asset picked again is not converted twice.
+# ---------------------------------------------------------------------------
+
+class Flight:
+    def __init__(self):
+        self.done = threading.Event()
+        self.path = None  # set once the frame is written; stays None on failure
+
+
+class FrameFlights:
+    def __init__(self):
+        self.flights = {}  # (asset_id, PIPELINE_VERSION, dither) -> Flight in progress
+        self.lock = threading.Lock()
+
+    @staticmethod
+    def frame_path(asset_id, dither):
+        return os.path.join(READY_DIR, f"{asset_id}.p{PIPELINE_VERSION}.{dither}.bin")
+
+    def prepare(self, asset_id, dither=DITHER_MODE, timeout=None):
+        """Path of the converted frame for `asset_id`, or None if it could not be made.
+        Downloads and converts unless the frame is on disk or already being made.
+        With a `timeout`, gives up waiting after that many seconds (returning None)
+        and leaves the conversion to finish in the background."""
+        key = (asset_id, PIPELINE_VERSION, dither)
+        path = self.frame_path(asset_id, dither)
+        with self.lock:
+            if os.path.exists(path):
+                return path
+            flight = self.flights.get(key)
+            leader = flight is None
+            if leader:
+                flight = self.flights[key] = Flight()
+        if leader and timeout is None:
+            self._make(key, flight, path)
+        elif leader:
+            threading.Thread(target=self._make, args=(key, flight, path), daemon=True).start()
+        else:
+            logger.info(f"Joining conversion of {asset_id} ({dither}) already in progress")
+        if not flight.done.wait(timeout):
+            if timeout:
+                logger.info(f"{asset_id} ({dither}) not ready within {timeout:.0f} s, left converting")
+            return None
+        return flight.path
+
+    def _make(self, key, flight, path):
+        asset_id, _, dither = key
+        # Written under another name first so a frame on disk is always complete
+        tmp = f"{path}.{threading.get_ident()}.tmp"
+        try:
+            data = immich_client.download_asset(asset_id)
+            if not data:
+                logger.warning(f"Download failed for {asset_id}")
+                return
+            with open(tmp, 'wb') as f:
+                f.write(convert_image_to_bin(BytesIO(data), dither=dither))
+            os.replace(tmp, path)
+            flight.path = path
+        except Exception as e:
+            logger.error(f"Error converting {asset_id} ({dither}): {e}")
+        finally:
+            if os.path.exists(tmp):
+                os.remove(tmp)
+            with self.lock:
+                del self.flights[key]
+            flight.done.set()
+
+
+frames = FrameFlights()
+
 # ---------------------------------------------------------------------------
 # Image manager
 #   images[0]  = daily image, refreshed once per day
 #   images[1]  = navigation buffer
 #   images[2]  = navigation buffer
+#   next_daily = tomorrow's daily image
+#   upcoming   = daily images for the days after that (BUNDLE_DAYS - 1 of them)
 # ---------------------------------------------------------------------------
 
 NUM_SLOTS = 3
+FRAME_BYTES = WIDTH * HEIGHT // 2  # packed 4-bit frame as convert_image_to_bin() writes it
+
+
+def frame_on_disk(image):
+    """True if `image` ({'id', 'path'} or None) has a complete frame file."""
+    try:
+        return image is not None and os.path.getsize(image.get('path', '')) == FRAME_BYTES
+    except OSError:
+        return False
+
 
 class ImageManager:
     def __init__(self):
         self.images = [None] * NUM_SLOTS  # {'id': str, 'path': str} or None
         self.next_daily = None            # pre-fetched image ready for the next day
+        self.upcoming = []                # pre-fetched daily images after next_daily, in order
+        self.display_list = None          # {'id': str, 'path': str} shown instead of photos while set
         self.current_index = 0
         self.last_date = None
         self.fetching = set()             # slot indices (int or 'next_daily') being fetched
         self.shown_ids = set()            # asset IDs that have been served via /api/image.bin
+        self.stale = set()                # slot indices kept past their day until a refill lands
+        self.last_served = None           # last image sent by /api/image.bin, the fallback of last resort
+        self.dither_modes = {DITHER_MODE} # modes devices have asked for; new images are converted in each
         self.lock = threading.Lock()
+        self.ready = threading.Condition(self.lock)  # notified whenever a fetch finishes
         self._load_state()
 
     def _load_state(self):
@@ -69,16 +186,17 @@ class ImageManager:
         try:
             with open(STATE_FILE, 'r') as f:
                 state = json.load(f)
-            raw = state.get('images', [])
-            self.images = [
-                (img if img and os.path.exists(img.get('path', '')) else None)
-                for img in (raw + [None] * NUM_SLOTS)[:NUM_SLOTS]
-            ]
-            nd = state.get('nextDaily')
-            self.next_daily = nd if nd and os.path.exists(nd.get('path', '')) else None
+            # Taken as recorded; revalidate() checks the files once serving has started
+            self.images = (state.get('images', []) + [None] * NUM_SLOTS)[:NUM_SLOTS]
+            self.next_daily = state.get('nextDaily')
+            self.upcoming = state.get('upcoming', [])
+            self.display_list = state.get('displayList')
             self.current_index = state.get('currentIndex', 0) % NUM_SLOTS
             self.last_date = state.get('lastDate')
             self.shown_ids = set(state.get('shownIds', []))
+            self.stale = set(state.get('staleSlots', []))
+            self.last_served = state.get('lastServed')
+            self.dither_modes |= set(state.get('ditherModes', [])) & set(DITHER_MODES)
         except Exception as e:
             logger.error(f"Error loading state: {e}")
 
@@ -88,15 +206,20 @@ class ImageManager:
                 json.dump({
                     'images': self.images,
                     'nextDaily': self.next_daily,
+                    'upcoming': self.upcoming,
+                    'displayList': self.display_list,
                     'currentIndex': self.current_index,
                     'lastDate': self.last_date,
                     'shownIds': list(self.shown_ids),
+                    'staleSlots': sorted(self.stale),
+                    'lastServed': self.last_served,
+                    'ditherModes': sorted(self.dither_modes),
                 }, f)
         except Exception as e:
             logger.error(f"Error saving state: {e}")
 
     def _fetch(self, slot):
-        """Fetch a random image into `slot` (int index or 'next_daily'). Background thread."""
+        """Fetch a random image into `slot` (int index, 'next_daily' or 'upcoming'). Background thread."""
         try:
             if not immich_client:
                 logger.warning("Immich client not configured")
@@ -114,25 +237,30 @@ class ImageManager:
             if not asset:
                 logger.warning(f"No asset found for slot {slot}")
                 return
-            data = immich_client.download_asset(asset['id'])
-            if not data:
-                logger.warning(f"Download failed for {asset['id']} (slot {slot})")
+            path = frames.prepare(asset['id'])
+            if not path:
+                logger.warning(f"No frame for {asset['id']} (slot {slot})")
                 return
-            path = os.path.join(READY_DIR, f"{asset['id']}.bin")
-            with open(path, 'wb') as f:
-                f.write(convert_image_to_bin(BytesIO(data)))
             with self.lock:
                 if slot == 'next_daily':
                     self.next_daily = {'id': asset['id'], 'path': path}
+                elif slot == 'upcoming':
+                    self.upcoming.append({'id': asset['id'], 'path': path})
                 else:
                     self.images[slot] = {'id': asset['id'], 'path': path}
-                self.fetching.discard(slot)
+                    self.stale.discard(slot)
                 self._save_state()
+                self.ready.notify_all()
+                other_modes = self.dither_modes - {DITHER_MODE}
             logger.info(f"Slot {slot} ready: {asset['id']}")
+            for dither in sorted(other_modes):
+                frames.prepare(asset['id'], dither)  # the slot is served meanwhile
         except Exception as e:
             logger.error(f"Error fetching slot {slot}: {e}")
+        finally:
             with self.lock:
                 self.fetching.discard(slot)
+                self.ready.notify_all()
 
     def _start_fetch(self, slot):
         """Queue a background fetch for `slot`. Must be called while holding lock."""
@@ -142,22 +270,81 @@ class ImageManager:
         threading.Thread(target=self._fetch, args=(slot,), daemon=True).start()
         logger.info(f"Queued fetch for slot {slot}")
 
+    def revalidate(self):
+        """Drop recorded frames whose files are missing or incomplete, then refill. Background thread
+        at startup, so requests are served from the recorded frames in the meantime."""
+        with self.lock:
+            images = [img if frame_on_disk(img) else None for img in self.images]
+            next_daily = self.next_daily if frame_on_disk(self.next_daily) else None
+            upcoming = [img for img in self.upcoming if frame_on_disk(img)]
+            display_list = self.display_list if self.display_list and os.path.exists(self.display_list.get('path', '')) else None
+            last_served = self.last_served if frame_on_disk(self.last_served) else None
+            dropped = (sum(1 for a, b in zip(self.images, images) if a != b) + (self.next_daily != next_daily)
+                       + len(self.upcoming) - len(upcoming) + (self.display_list != display_list))
+            if dropped or last_served != self.last_served:
+                logger.warning(f"Revalidation dropped {dropped} recorded frames missing on disk")
+                self.images, self.next_daily, self.upcoming = images, next_daily, upcoming
+                self.display_list, self.last_served = display_list, last_served
+                self.stale &= {i for i, img in enumerate(images) if img}
+                self._save_state()
+        self.ensure_images()
+
     def ensure_images(self):
         """Called on each request: swap in pre-fetched image on day change, fill empty slots."""
         today = datetime.date.today().isoformat()
         with self.lock:
             if self.last_date != today:
-                logger.info(f"New day ({today}), swapping in pre-fetched daily image")
-                self.images[0] = self.next_daily  # instant swap; None if not ready yet
+                if self.next_daily:
+                    logger.info(f"New day ({today}), swapping in pre-fetched daily image")
+                    self.images[0] = self.next_daily
+                    self.stale.discard(0)
+                    self.next_daily = self.upcoming.pop(0) if self.upcoming else None
+                elif self.images[0]:
+                    # Stale while revalidating: yesterday's image beats a 404 until the refill lands
+                    logger.info(f"New day ({today}), no daily image ready; keeping {self.images[0]['id']} meanwhile")
+                    self.stale.add(0)
                 self.current_index = 0
-                self.next_daily = None
                 self.last_date = today
                 self._save_state()
             for i in range(NUM_SLOTS):
-                if self.images[i] is None:
+                if self.images[i] is None or i in self.stale:
                     self._start_fetch(i)
             if self.next_daily is None:
                 self._start_fetch('next_daily')
+            elif len(self.upcoming) < BUNDLE_DAYS - 1:
+                self._start_fetch('upcoming')  # one at a time, keeps the order
+
+    def scheduled_frames(self, count):
+        """Up to `count` pre-fetched daily images after today's, as (image, days ahead)."""
+        with self.lock:
+            queue = [self.next_daily] + self.upcoming
+        frames = []
+        for days_ahead, image in enumerate(queue, start=1):
+            if image is None or len(frames) >= count:
+                break
+            frames.append((image, days_ahead))
+        return frames
+
+    def servable(self):
+        """The image /api/image.bin serves now, or None. Must be called while holding lock.
+        Falls back to any frame still on disk, down to the last one served."""
+        candidates = [self.images[self.current_index], self.images[0]] + self.images + [self.last_served]
+        return next((img for img in candidates if frame_on_disk(img)), None)
+
+    def servable_pending(self):
+        """True while a fetch may still fill the image /api/image.bin serves. Must be called while holding lock."""
+        return bool({self.current_index, 0} & self.fetching)
+
+    def slot_status(self):
+        """Readiness of every slot, for /ready. Must be called while holding lock."""
+        def status(slot, image):
+            return {'id': image['id'] if image else None, 'ready': frame_on_disk(image),
+                    'stale': slot in self.stale, 'fetching': slot in self.fetching}
+        slots = {str(i): status(i, img) for i, img in enumerate(self.images)}
+        slots['next_daily'] = status('next_daily', self.next_daily)
+        slots['upcoming'] = {'ready': sum(1 for img in self.upcoming if frame_on_disk(img)),
+                             'wanted': BUNDLE_DAYS - 1, 'fetching': 'upcoming' in self.fetching}
+        return slots
 
     def handle_action(self, action):
         """Advance or retreat current_index. Buffer slots are replaced in the background."""
@@ -175,7 +362,42 @@ class ImageManager:
 
 
 manager = ImageManager()
-manager.ensure_images()
+threading.Thread(target=manager.revalidate, daemon=True).start()
+
+
+def log_wake_summary(addr, summary):
+    device_id = summary.get('deviceId', 'unknown')
+    transitions = ' -> '.join(f"{name}@{at}ms" for name, at in summary.get('transitions', []))
+    phases = ', '.join(f"{name}={ms}ms" for name, ms in summary.get('phases', {}).items())
+    logger.info(f"UDP telemetry from {addr} - {device_id}: {summary.get('status')}")
+    logger.info(f"UDP telemetry from {addr} - {device_id}: transitions {transitions}; phases {phases}")
+    for level, msg in summary.get('logs', []):
+        logger.info(f"UDP telemetry from {addr} - [{level}] {device_id}: {msg}")
+    if summary.get('droppedLogs'):
+        logger.info(f"UDP telemetry from {addr} - {device_id}: {summary['droppedLogs']} logs dropped on the device")
+
+
+def telemetry_listener(port):
+    """Receive wake summaries sent by firmware built with TELEMETRY_UDP_PORT."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        sock.bind(('0.0.0.0', port))
+    except OSError as e:
+        logger.warning(f"UDP telemetry listener not started on port {port}: {e}")
+        return
+    logger.info(f"Listening for UDP telemetry on port {port}")
+    while True:
+        data, (addr, _) = sock.recvfrom(2048)
+        # Valid CBOR can still have the wrong shape; one bad datagram must
+        # not end the listener
+        try:
+            log_wake_summary(addr, telemetry.decode(data))
+        except Exception as e:
+            logger.warning(f"Bad UDP telemetry from {addr}: {e!r}")
+
+
+if TELEMETRY_UDP_PORT:
+    threading.Thread(target=telemetry_listener, args=(TELEMETRY_UDP_PORT,), daemon=True).start()
 
 # ---------------------------------------------------------------------------
 # Routes
@@ -190,11 +412,12 @@ def health():
 def ready():
     """Kubernetes readiness probe."""
     with manager.lock:
-        has_image = manager.images[0] is not None
-        is_fetching = 0 in manager.fetching
+        has_image = manager.servable() is not None
+        is_fetching = manager.servable_pending()
+        slots = manager.slot_status()
     if has_image or is_fetching:
-        return jsonify({"status": "ready", "hasImages": has_image, "updating": is_fetching}), 200
-    return jsonify({"status": "not ready", "reason": "no images available"}), 503
+        return jsonify({"status": "ready", "hasImages": has_image, "updating": is_fetching, "slots": slots}), 200
+    return jsonify({"status": "not ready", "reason": "no images available", "slots": slots}), 503
 
 
 @app.route('/api/current.json', methods=['GET'])
@@ -203,11 +426,14 @@ def get_current():
     manager.ensure_images()
 
     with manager.lock:
-        image = manager.images[manager.current_index]
-        has_image = manager.images[0] is not None
+        image = manager.servable()  # the id must match what image.bin will send
+        has_image = image is not None
         updating = bool(manager.fetching)
         image_count = sum(1 for img in manager.images if img is not None)
         current_image_id = image['id'] if image else "no-image"
+        display_list = manager.display_list
+    if display_list:
+        current_image_id = display_list['id']
 
     now = datetime.datetime.now()
     if SLEEP_MINUTES:
@@ -239,6 +465,7 @@ def get_current():
         "hasImage": has_image,
         "imageCount": image_count,
         "updating": updating,
+        "displayList": display_list is not None,
         "devServerHost": None
     })
 
@@ -248,7 +475,11 @@ def get_image():
     logger.info(f"GET /api/image.bin from {request.remote_addr}")
 
     with manager.lock:
-        image = manager.images[manager.current_index] or manager.images[0]
+        # A frame still being converted is worth waiting for: a 404 costs the device its wake.
+        # Only this request's thread waits (gthread workers); keep it well inside the device's timeout.
+        manager.ready.wait_for(lambda: manager.servable() or not manager.servable_pending(),
+                               timeout=FRAME_WAIT_SECONDS)
+        image = manager.servable()
 
     if not image:
         logger.warning("No image available")
@@ -257,13 +488,152 @@ def get_image():
         logger.warning(f"Image file not found: {image['path']}")
         return "Image file not found", 404
 
-    logger.info(f"Serving {image['id']} ({os.path.getsize(image['path'])} bytes)")
+    path = device_frame(image, requested_dither())
+    logger.info(f"Serving {image['id']} ({os.path.getsize(path)} bytes)")
     with manager.lock:
+        if manager.last_served != image:
+            manager.last_served = image
+            manager._save_state()
         if image['id'] not in manager.shown_ids:
             manager.shown_ids.add(image['id'])
             manager._save_state()
             logger.info(f"Marked {image['id']} as shown ({len(manager.shown_ids)} total)")
-    with open(image['path'], 'rb') as f:
+    with open(path, 'rb') as f:
+        return Response(f.read(), mimetype='application/octet-stream')
+
+
+def requested_dither():
+    """Dither mode the device asked for with ?dither=, or the server default."""
+    dither = request.args.get('dither', DITHER_MODE)
+    if dither not in DITHER_MODES:
+        logger.warning(f"Unknown dither mode '{dither}', using {DITHER_MODE}")
+        return DITHER_MODE
+    return dither
+
+
+def device_frame(image, dither):
+    """Path of `image` dithered with `dither`; see device_frames()."""
+    return device_frames([image], dither)[0]
+
+
+def device_frames(images, dither):
+    """Paths of `images` dithered with `dither`. Other modes than the default are made on first
+    request and for every new image after that. All missing frames are started at once and
+    waited for together, up to FRAME_WAIT_SECONDS in all; the default frame stands in for any
+    not ready by then."""
+    if dither == DITHER_MODE:
+        return [image['path'] for image in images]
+    with manager.lock:
+        if dither not in manager.dither_modes:
+            manager.dither_modes.add(dither)
+            manager._save_state()
+    for image in images:
+        frames.prepare(image['id'], dither, timeout=0)
+    deadline = time.monotonic() + FRAME_WAIT_SECONDS
+    paths = []
+    for image in images:
+        path = frames.prepare(image['id'], dither, timeout=max(0, deadline - time.monotonic()))
+        if not path:
+            logger.warning(f"No {dither} frame of {image['id']} yet, sending {DITHER_MODE}")
+        paths.append(path or image['path'])
+    return paths
+
+
+def daily_display_time(days_ahead):
+    """Unix time at which the daily image `days_ahead` days from now goes up."""
+    hour = 0
+    if REFRESH_HOUR is not None:
+        try:
+            hour = int(REFRESH_HOUR) % 24
+        except ValueError:
+            pass
+    day = datetime.date.today() + datetime.timedelta(days=days_ahead)
+    return int(datetime.datetime.combine(day, datetime.time(hour=hour)).timestamp())
+
+
+def compressed_frame(path):
+    """zlib stream of a prepared frame, cached next to it."""
+    z_path = path + '.z'
+    if not os.path.exists(z_path) or os.path.getmtime(z_path) < os.path.getmtime(path):
+        with open(path, 'rb') as f:
+            data = zlib.compress(f.read(), 9)
+        # Requests run in threads; another bundle may be reading the cache
+        tmp = f"{z_path}.{threading.get_ident()}.tmp"
+        with open(tmp, 'wb') as f:
+            f.write(data)
+        os.replace(tmp, z_path)
+        return data
+    with open(z_path, 'rb') as f:
+        return f.read()
+
+
+@app.route('/api/bundle.bin', methods=['GET'])
+def get_bundle():
+    """Upcoming daily frames for offline display.
+
+    Layout (little-endian):
+        header: magic 'TBD1', u32 server time, u16 frame count, u16 reserved
+        per frame: char[64] image id, u32 display time, u32 length, zlib data
+    """
+    count = max(0, min(request.args.get('count', BUNDLE_DAYS, type=int), BUNDLE_DAYS))
+    dither = requested_dither()
+    logger.info(f"GET /api/bundle.bin?count={count}&dither={dither} from {request.remote_addr}")
+    manager.ensure_images()
+
+    scheduled = manager.scheduled_frames(count)
+    paths = device_frames([image for image, _ in scheduled], dither)
+    parts = []
+    for (image, days_ahead), path in zip(scheduled, paths):
+        data = compressed_frame(path)
+        parts.append(struct.pack('<64sII', image['id'].encode()[:64], daily_display_time(days_ahead), len(data)))
+        parts.append(data)
+
+    with manager.lock:
+        for image, _ in scheduled:
+            manager.shown_ids.add(image['id'])
+        manager._save_state()
+
+    header = struct.pack('<4sIHH', BUNDLE_MAGIC, int(time.time()), len(scheduled), 0)
+    body = header + b''.join(parts)
+    logger.info(f"Serving bundle of {len(scheduled)} frames ({len(body)} bytes)")
+    return Response(body, mimetype='application/octet-stream')
+
+
+@app.route('/api/display-list', methods=['POST', 'DELETE'])
+def set_display_list():
+    """Show a display list (see displaylist.py) instead of photos, or go back to photos."""
+    if request.method == 'DELETE':
+        with manager.lock:
+            manager.display_list = None
+            manager._save_state()
+        logger.info("Display list cleared")
+        return jsonify({"status": "cleared"})
+
+    try:
+        data = displaylist.from_json(request.json or {}).encode()
+    except (ValueError, KeyError, TypeError, struct.error) as e:
+        return jsonify({"error": str(e)}), 400
+
+    list_id = 'dl-' + hashlib.sha1(data).hexdigest()[:16]
+    tmp = f"{DISPLAY_LIST_FILE}.{threading.get_ident()}.tmp"
+    with open(tmp, 'wb') as f:
+        f.write(data)
+    os.replace(tmp, DISPLAY_LIST_FILE)
+    with manager.lock:
+        manager.display_list = {'id': list_id, 'path': DISPLAY_LIST_FILE}
+        manager._save_state()
+    logger.info(f"Display list {list_id} set ({len(data)} bytes)")
+    return jsonify({"status": "ok", "id": list_id, "size": len(data)})
+
+
+@app.route('/api/display-list.bin', methods=['GET'])
+def get_display_list():
+    logger.info(f"GET /api/display-list.bin from {request.remote_addr}")
+    with manager.lock:
+        display_list = manager.display_list
+    if not display_list or not os.path.exists(display_list['path']):
+        return "No display list", 404
+    with open(display_list['path'], 'rb') as f:
         return Response(f.read(), mimetype='application/octet-stream')
 
 
@@ -277,15 +647,171 @@ def action():
     return jsonify({"status": "ok"})
 
 
+def firmware_path(version):
+    """Stored image for a firmware version, or None if the name is not a plain version string."""
+    if not version or not all(c.isalnum() or c in '-_.' for c in version) or version.startswith('.'):
+        return None
+    return os.path.join(FIRMWARE_DIR, f"{version}.bin")
+
+
+def latest_firmware():
+    try:
+        with open(os.path.join(FIRMWARE_DIR, 'LATEST')) as f:
+            return f.read().strip() or None
+    except FileNotFoundError:
+        return None
+
+
+patch_lock = threading.Lock()
+
+
+def firmware_patch(from_version, to_version):
+    """Path of the delta patch between two stored images, or None if it has not been built."""
+    if not firmware_path(from_version) or not firmware_path(to_version):
+        return None
+    path = os.path.join(FIRMWARE_DIR, 'patches', f"{from_version}__{to_version}.top")
+    return path if os.path.exists(path) else None
+
+
+def firmware_signature(version):
+    """Uploader's signature of the image's SHA-256 (hex), or None."""
+    try:
+        with open(os.path.join(FIRMWARE_DIR, f"{version}.sig")) as f:
+            return f.read().strip() or None
+    except FileNotFoundError:
+        return None
+
+
+def publish_firmware(version):
+    """Build and check patches from every other stored image, then offer `version` as the latest.
+
+    Runs in the background: on a couple of megabytes the pure-Python diff
+    takes far longer than any request may.
+    """
+    target_path = firmware_path(version)
+    patch_dir = os.path.join(FIRMWARE_DIR, 'patches')
+    os.makedirs(patch_dir, exist_ok=True)
+    with patch_lock:
+        with open(target_path, 'rb') as f:
+            target = f.read()
+        for name in sorted(os.listdir(FIRMWARE_DIR)):
+            if not name.endswith('.bin') or name == f"{version}.bin":
+                continue
+            from_version = name[:-len('.bin')]
+            path = os.path.join(patch_dir, f"{from_version}__{version}.top")
+            try:
+                with open(os.path.join(FIRMWARE_DIR, name), 'rb') as f:
+                    source = f.read()
+                patch = ota.make_patch(source, target)
+                ota.apply_patch(source, patch)
+                with open(path + '.tmp', 'wb') as f:
+                    f.write(patch)
+                os.replace(path + '.tmp', path)
+                logger.info(f"Built firmware patch {from_version} -> {version}: {len(patch)} bytes "
+                            f"(image {len(target)} bytes)")
+            except Exception as e:
+                logger.error(f"Building firmware patch {from_version} -> {version} failed: {e}")
+        with open(os.path.join(FIRMWARE_DIR, 'LATEST'), 'w') as f:
+            f.write(version)
+    logger.info(f"Firmware {version} is now latest")
+
+
+@app.route('/api/firmware', methods=['POST'])
+def upload_firmware():
+    """Store a firmware image (the build's firmware.bin); it becomes the latest version once its patches are built.
+
+    Needs `Authorization: Bearer <FIRMWARE_TOKEN>`. `signature` is the hex
+    signature of the image's SHA-256 that devices built with OTA_SIGNING_KEY
+    check before installing it.
+    """
+    if not FIRMWARE_TOKEN:
+        return jsonify({"error": "firmware uploads are disabled, set FIRMWARE_TOKEN"}), 403
+    if not hmac.compare_digest(request.headers.get('Authorization', '').encode(), f"Bearer {FIRMWARE_TOKEN}".encode()):
+        return jsonify({"error": "missing or wrong firmware token"}), 401
+    version = request.args.get('version', '')
+    path = firmware_path(version)
+    if not path:
+        return jsonify({"error": "version must be a plain version string"}), 400
+    signature = request.args.get('signature', '').lower()
+    if len(signature) % 2 or not all(c in '0123456789abcdef' for c in signature):
+        return jsonify({"error": "signature must be hex"}), 400
+    data = request.get_data()
+    if not data:
+        return jsonify({"error": "empty firmware image"}), 400
+    os.makedirs(FIRMWARE_DIR, exist_ok=True)
+    with open(path + '.tmp', 'wb') as f:
+        f.write(data)
+    os.replace(path + '.tmp', path)
+    signature_path = os.path.join(FIRMWARE_DIR, f"{version}.sig")
+    if signature:
+        with open(signature_path + '.tmp', 'w') as f:
+            f.write(signature)
+        os.replace(signature_path + '.tmp', signature_path)
+    elif os.path.exists(signature_path):
+        os.remove(signature_path)
+    threading.Thread(target=publish_firmware, args=(version,), daemon=True).start()
+    logger.info(f"Firmware {version} stored ({len(data)} bytes{', signed' if signature else ''}), building patches")
+    return jsonify({"status": "stored", "version": version}), 202
+
+
+@app.route('/api/ota.json', methods=['GET'])
+def ota_manifest():
+    """What a device running `from` should download: nothing, or a patch to the latest firmware."""
+    current = request.args.get('from', '')
+    latest = latest_firmware()
+    if not latest or latest == current:
+        return jsonify({"version": current})
+    path = firmware_patch(current, latest)
+    if not path:
+        logger.info(f"No patch from {current} to {latest}; device needs a USB update")
+        return jsonify({"version": current})
+    size = os.path.getsize(path)
+    if size > OTA_PATCH_MAX:
+        logger.info(f"Patch from {current} to {latest} is {size} bytes, over OTA_PATCH_MAX; "
+                    f"device needs a USB update")
+        return jsonify({"version": current, "usbUpdateNeeded": latest})
+    with open(path, 'rb') as f:
+        patch_id = hashlib.sha256(f.read()).hexdigest()
+    manifest = {"version": latest, "patchId": patch_id, "size": size}
+    signature = firmware_signature(latest)
+    if signature:
+        manifest["signature"] = signature
+    return jsonify(manifest)
+
+
+@app.route('/api/ota/patch.bin', methods=['GET'])
+def ota_patch():
+    """Patch download; Range requests let the device fetch it a piece per wake."""
+    path = firmware_patch(request.args.get('from', ''), request.args.get('to', ''))
+    if not path:
+        return "No such patch", 404
+    logger.info(f"GET /api/ota/patch.bin from {request.remote_addr} {request.headers.get('Range', '')}")
+    return send_file(path, mimetype='application/octet-stream', conditional=True)
+
+
+def telemetry_body() -> dict:
+    """Device telemetry as a dict, whether it was posted as CBOR or JSON."""
+    if request.mimetype == telemetry.CONTENT_TYPE:
+        return telemetry.decode(request.get_data())
+    return request.json
+
+
 @app.route('/api/device-status', methods=['POST'])
 def device_status():
-    logger.info(f"POST /api/device-status from {request.remote_addr}: {request.json}")
+    try:
+        data = telemetry_body()
+    except ValueError as e:
+        return jsonify({"error": str(e)}), 400
+    logger.info(f"POST /api/device-status from {request.remote_addr}: {data}")
     return jsonify({"status": "received"})
 
 
 @app.route('/api/logs', methods=['POST'])
 def logs():
-    data = request.json
+    try:
+        data = telemetry_body()
+    except ValueError as e:
+        return jsonify({"error": str(e)}), 400
     level = data.get('logLevel', 'INFO')
     msg = data.get('logs', '')
     device_id = data.get('deviceId', 'unknown')
@@ -293,6 +819,54 @@ def logs():
     return jsonify({"status": "logged"})
 
 
+def debug_upload_refused():
+    """Error response for a capture or log ring upload without the debug token, or None."""
+    if not DEBUG_UPLOAD_TOKEN:
+        return jsonify({"error": "debug uploads are disabled, set DEBUG_UPLOAD_TOKEN"}), 403
+    if not hmac.compare_digest(request.headers.get('Authorization', '').encode(),
+                               f"Bearer {DEBUG_UPLOAD_TOKEN}".encode()):
+        return jsonify({"error": "missing or wrong debug upload token"}), 401
+    return None
+
+
+@app.route('/api/logs/ring', methods=['POST'])
+def log_ring():
+    """Raw deferred log ring from a LOG_DEFERRED build; decode with esp32-client/tools/logdecode.py.
+
+    Needs `Authorization: Bearer <DEBUG_UPLOAD_TOKEN>`.
+    """
+    refused = debug_upload_refused()
+    if refused:
+        return refused
+    device_id = request.headers.get('X-Device-Id', 'unknown')
+    safe_id = ''.join(c for c in device_id if c.isalnum() or c in '-_') or 'unknown'
+    os.makedirs(LOG_RING_DIR, exist_ok=True)
+    path = os.path.join(LOG_RING_DIR, f"{safe_id}-{int(time.time())}.bin")
+    with open(path, 'wb') as f:
+        f.write(request.get_data())
+    logger.info(f"POST /api/logs/ring from {request.remote_addr} - {device_id}: {request.content_length} bytes")
+    return jsonify({"status": "logged"})
+
+
+@app.route('/api/capture', methods=['POST'])
+def capture():
+    """Wake capture from a CAPTURE_SESSION build; replay or compare with bench/replay.py.
+
+    Needs `Authorization: Bearer <DEBUG_UPLOAD_TOKEN>`.
+    """
+    refused = debug_upload_refused()
+    if refused:
+        return refused
+    device_id = request.headers.get('X-Device-Id', 'unknown')
+    safe_id = ''.join(c for c in device_id if c.isalnum() or c in '-_') or 'unknown'
+    os.makedirs(CAPTURE_DIR, exist_ok=True)
+    path = os.path.join(CAPTURE_DIR, f"{safe_id}-{int(time.time())}.bin")
+    with open(path, 'wb') as f:
+        f.write(request.get_data())
+    logger.info(f"POST /api/capture from {request.remote_addr} - {device_id}: {request.content_length} bytes")
+    return jsonify({"status": "stored"})
+
+
 if __name__ == '__main__':
     logger.info("Starting server at http://0.0.0.0:3000")
     app.run(host='0.0.0.0', port=3000, debug=True)
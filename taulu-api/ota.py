@@ -0,0 +1,123 @@
+"""Firmware delta patches for over-the-air updates.
+
+A patch turns the firmware image a device is running into a newer one. It is
+built bsdiff-style: regions of the new image are matched against the old one
+and sent as byte-wise differences, which are mostly zeros where code only
+moved, plus literal inserts for what is new. The op stream is zlib-compressed.
+The device applier is esp32-client/src/Ota.cpp; the format must stay in sync.
+
+Layout (little-endian):
+    header: magic 'TOP1', u32 target size, u32 source size, u32 reserved,
+            sha256(target), sha256(source)
+    zlib stream of ops:
+        0x01 ADD     u32 source offset, u32 length, length difference bytes
+        0x02 INSERT  u32 length, length literal bytes
+        0x00 END
+"""
+import hashlib
+import struct
+import zlib
+
+MAGIC = b'TOP1'
+HEADER = struct.Struct('<4sIII32s32s')
+
+OP_END = 0x00
+OP_ADD = 0x01
+OP_INSERT = 0x02
+
+WINDOW = 32       # bytes that must match exactly to anchor a region
+STEP = 16         # source positions indexed; any match of WINDOW + STEP bytes is found
+GIVE_UP = 64      # stop extending once the score is this far below its best
+
+
+def _index(source: bytes) -> dict:
+    index = {}
+    for pos in range(0, len(source) - WINDOW + 1, STEP):
+        index.setdefault(source[pos:pos + WINDOW], pos)
+    return index
+
+
+def _extend_forward(source, target, s, t):
+    """Length of the region at (s, t) maximising matches - mismatches."""
+    best = score = length = 0
+    limit = min(len(source) - s, len(target) - t)
+    i = 0
+    while i < limit:
+        score += 1 if source[s + i] == target[t + i] else -1
+        i += 1
+        if score > best:
+            best, length = score, i
+        elif score < best - GIVE_UP:
+            break
+    return length
+
+
+def _extend_backward(source, target, s, t, floor):
+    best = score = length = 0
+    limit = min(s, t - floor)
+    i = 0
+    while i < limit:
+        i += 1
+        score += 1 if source[s - i] == target[t - i] else -1
+        if score > best:
+            best, length = score, i
+        elif score < best - GIVE_UP:
+            break
+    return length
+
+
+def _difference(source, target, s, t, length):
+    return bytes((target[t + i] - source[s + i]) & 0xFF for i in range(length))
+
+
+def make_patch(source: bytes, target: bytes) -> bytes:
+    index = _index(source)
+    ops = []
+    done = 0  # target bytes covered so far
+    t = 0
+    while t <= len(target) - WINDOW:
+        s = index.get(target[t:t + WINDOW])
+        if s is None:
+            t += 1
+            continue
+        back = _extend_backward(source, target, s, t, done)
+        start_s, start_t = s - back, t - back
+        length = back + _extend_forward(source, target, s, t)
+        if start_t > done:
+            ops.append(struct.pack('<BI', OP_INSERT, start_t - done) + target[done:start_t])
+        ops.append(struct.pack('<BII', OP_ADD, start_s, length) +
+                   _difference(source, target, start_s, start_t, length))
+        done = t = start_t + length
+    if done < len(target):
+        ops.append(struct.pack('<BI', OP_INSERT, len(target) - done) + target[done:])
+    ops.append(bytes([OP_END]))
+
+    header = HEADER.pack(MAGIC, len(target), len(source), 0,
+                         hashlib.sha256(target).digest(), hashlib.sha256(source).digest())
+    return header + zlib.compress(b''.join(ops), 9)
+
+
+def apply_patch(source: bytes, patch: bytes) -> bytes:
+    """Reference applier, used to check a patch before it is served."""
+    magic, target_size, source_size, _, target_sha, source_sha = HEADER.unpack_from(patch)
+    if magic != MAGIC or source_size != len(source) or hashlib.sha256(source).digest() != source_sha:
+        raise ValueError("patch does not apply to this image")
+    ops = zlib.decompress(patch[HEADER.size:])
+    out = bytearray()
+    pos = 0
+    while ops[pos] != OP_END:
+        op = ops[pos]
+        if op == OP_ADD:
+            s, length = struct.unpack_from('<II', ops, pos + 1)
+            pos += 9
+            out += bytes((source[s + i] + ops[pos + i]) & 0xFF for i in range(length))
+        elif op == OP_INSERT:
+            length, = struct.unpack_from('<I', ops, pos + 1)
+            pos += 5
+            out += ops[pos:pos + length]
+        else:
+            raise ValueError(f"bad patch op {op}")
+        pos += length
+    if len(out) != target_size or hashlib.sha256(out).digest() != target_sha:
+        raise ValueError("patch output does not match the target image")
+    return bytes(out)
@@ -1,8 +1,13 @@
 import os
+import functools
 from PIL import Image
 import numpy as np
 from io import BytesIO
 
+# Version of the conversion output. Bump it whenever a change here alters the
+# bytes convert_image_to_bin() produces, so frames converted before are not reused.
+PIPELINE_VERSION = 1
+
 # 6-color palette for GDEP073E01 Spectra E6 display
 # Black, White, Yellow, Red, Blue, Green
 
@@ -33,6 +38,16 @@ PALETTE_MEASURED = [
 # Keep backward compatibility
 PALETTE_COLORS = PALETTE_THEORETICAL
 
+# Dithering modes of convert_image_to_bin()
+DITHER_FLOYD_STEINBERG = 'floyd-steinberg'
+DITHER_BLUE_NOISE = 'blue-noise'
+DITHER_MODES = (DITHER_FLOYD_STEINBERG, DITHER_BLUE_NOISE)
+
+# Blue-noise pattern dithering, shared with the firmware
+# (esp32-client/src/BlueNoise.h, written by bench/dither.py header)
+BLUE_NOISE_SIZE = 64        # threshold matrix is BLUE_NOISE_SIZE x BLUE_NOISE_SIZE
+BLUE_NOISE_CANDIDATES = 4   # palette colours mixed per pixel
+
 
 # Gamma correction lookup tables for sRGB <-> linear conversion
 def srgb_to_linear(srgb_value: int) -> float:
@@ -86,38 +101,30 @@ def compress_dynamic_range(image_array: np.ndarray, measured_palette: list) -> n
 
     display_range = white_Y - black_Y
 
-    # Process each pixel
-    result = np.zeros_like(image_array, dtype=np.uint8)
-    height, width = image_array.shape[:2]
-
-    for y in range(height):
-        for x in range(width):
-            r, g, b = image_array[y, x]
-
-            # Convert to linear
-            lr = srgb_to_linear(r)
-            lg = srgb_to_linear(g)
-            lb = srgb_to_linear(b)
-
-            # Original luminance
-            Y = 0.2126729 * lr + 0.7151522 * lg + 0.0721750 * lb
-
-            # Compress to display range
-            compressed_Y = black_Y + Y * display_range
-
-            # Scale RGB proportionally
-            if Y > 1e-6:
-                scale = compressed_Y / Y
-                lr *= scale
-                lg *= scale
-                lb *= scale
-            else:
-                # Near-black pixel
-                lr = lg = lb = black_Y
-
-            # Convert back to sRGB
-            result[y, x] = [linear_to_srgb(lr), linear_to_srgb(lg), linear_to_srgb(lb)]
-
+    # Whole-image arrays; the same arithmetic as srgb_to_linear() and
+    # linear_to_srgb() per pixel, so the output is unchanged
+    to_linear = np.array([srgb_to_linear(v) for v in range(256)])
+    linear = to_linear[image_array]
+
+    # Original luminance
+    Y = (0.2126729 * linear[..., 0] +
+         0.7151522 * linear[..., 1] +
+         0.0721750 * linear[..., 2])
+
+    # Compress to display range
+    compressed_Y = black_Y + Y * display_range
+
+    # Scale RGB proportionally; near-black pixels go to the display's black
+    dark = Y <= 1e-6
+    scale = compressed_Y / np.where(dark, 1.0, Y)
+    linear = np.where(dark[..., None], black_Y, linear * scale[..., None])
+
+    # Convert back to sRGB
+    srgb = np.where(linear <= 0.0031308, 12.92 * linear,
+                    1.055 * np.power(np.maximum(linear, 0.0), 1.0 / 2.4) - 0.055)
+    result = np.clip(srgb * 255.0 + 0.5, 0, 255).astype(np.uint8)
+    result[linear <= 0.0] = 0
+    result[linear >= 1.0] = 255
     return result
 
 
@@ -205,6 +212,121 @@ def floyd_steinberg_dither(image_array: np.ndarray,
     return result
 
 
+@functools.lru_cache(maxsize=None)
+def blue_noise_matrix(size: int = BLUE_NOISE_SIZE) -> np.ndarray:
+    """
+    Tileable blue-noise threshold matrix (size x size, values 0-255), made with
+    Ulichney's void-and-cluster method.
+
+    Each pixel's rank is the order in which it joins a dot pattern that is
+    kept as even as possible, so any threshold gives dots with no low-frequency
+    clumps. Deterministic: the firmware carries the same matrix.
+    """
+    n = size * size
+    # Gaussian energy of one dot, wrapped around the tile edges
+    d = np.minimum(np.arange(size), size - np.arange(size))
+    kernel = np.exp(-(d[:, None] ** 2 + d[None, :] ** 2) / (2 * 1.9 ** 2))
+
+    def splat(i):
+        return np.roll(kernel, divmod(int(i), size), axis=(0, 1)).ravel()
+
+    # Random initial pattern of a tenth of the pixels, then move the dot in the
+    # tightest cluster to the largest void until it lands where it came from
+    pattern = np.zeros(n, dtype=bool)
+    pattern[np.random.default_rng(1).choice(n, n // 10, replace=False)] = True
+    energy = np.zeros(n)
+    for i in np.flatnonzero(pattern):
+        energy += splat(i)
+    while True:
+        cluster = np.argmax(np.where(pattern, energy, -np.inf))
+        pattern[cluster] = False
+        energy -= splat(cluster)
+        void = np.argmin(np.where(pattern, np.inf, energy))
+        pattern[void] = True
+        energy += splat(void)
+        if void == cluster:
+            break
+
+    # Ranks: remove the initial dots tightest cluster first, then fill the
+    # largest voids until every pixel has one
+    ranks = np.zeros(n, dtype=np.int64)
+    ones = int(pattern.sum())
+    remaining, remaining_energy = pattern.copy(), energy.copy()
+    for rank in range(ones - 1, -1, -1):
+        cluster = np.argmax(np.where(remaining, remaining_energy, -np.inf))
+        remaining[cluster] = False
+        remaining_energy -= splat(cluster)
+        ranks[cluster] = rank
+    for rank in range(ones, n):
+        void = np.argmin(np.where(pattern, np.inf, energy))
+        pattern[void] = True
+        energy += splat(void)
+        ranks[void] = rank
+
+    return (ranks * 256 // n).astype(np.uint8).reshape(size, size)
+
+
+def blue_noise_dither(image_array: np.ndarray, measured_palette: list,
+                      nominal_palette: list = PALETTE_THEORETICAL) -> np.ndarray:
+    """
+    Blue-noise pattern dithering (Knoll): each pixel is a mix of
+    BLUE_NOISE_CANDIDATES palette colours and the threshold matrix picks one.
+
+    The mix comes from repeated nearest-colour matches, each with half the
+    error accumulated so far added on; the candidates are ordered by
+    luminance and the threshold at the pixel selects among them. Unlike
+    error diffusion no pixel depends on another, so this is whole-array work
+    here and can run on any row of a stream, as the firmware does. Pixels
+    exactly in a nominal palette colour are that colour, undithered. Integer
+    arithmetic throughout, matching the firmware bit for bit.
+
+    Args:
+        image_array: RGB image as numpy array (H, W, 3)
+        measured_palette: Measured colors for dithering decisions
+        nominal_palette: Colors passed through as they are, in the same order
+
+    Returns:
+        Palette indices (H, W)
+    """
+    height, width = image_array.shape[:2]
+    palette = np.array(measured_palette, dtype=np.int32)
+    # Per-channel planes keep the temporaries to one plane each
+    goal = [image_array[..., c].astype(np.int32) for c in range(3)]
+    error = [np.zeros((height, width), dtype=np.int32) for _ in range(3)]
+    counts = np.zeros((len(palette), height, width), dtype=np.uint8)
+
+    for _ in range(BLUE_NOISE_CANDIDATES):
+        attempt = [g + (e >> 1) for g, e in zip(goal, error)]
+        chosen = np.zeros((height, width), dtype=np.intp)
+        best = sum((a - int(v)) ** 2 for a, v in zip(attempt, palette[0]))
+        for i in range(1, len(palette)):
+            distance = sum((a - int(v)) ** 2 for a, v in zip(attempt, palette[i]))
+            closer = distance < best  # first of equals wins, as in the firmware
+            best = np.where(closer, distance, best)
+            chosen[closer] = i
+        for i in range(len(palette)):
+            counts[i] += chosen == i
+        matched = palette[chosen]
+        for c in range(3):
+            error[c] += goal[c] - matched[..., c]
+
+    matrix = blue_noise_matrix()
+    size = matrix.shape[0]
+    threshold = np.tile(matrix, (height // size + 1, width // size + 1))[:height, :width]
+    pick = (threshold.astype(np.int32) * BLUE_NOISE_CANDIDATES) >> 8
+
+    # The pick-th candidate in order of luminance
+    luminance = palette @ np.array([299, 587, 114])
+    result = np.zeros((height, width), dtype=np.uint8)
+    seen = np.zeros((height, width), dtype=np.int32)
+    for i in np.argsort(luminance, kind='stable'):
+        seen += counts[i]
+        result[(seen > pick) & (seen - counts[i] <= pick)] = i
+    for i, colour in enumerate(nominal_palette):
+        result[(image_array == colour).all(axis=-1)] = i
+    return result
+
+
 def resize_and_truncate(image: Image.Image, target_size: tuple[int, int] = (1600, 1200)) -> Image.Image:
     """Resize the image to fit the target size and truncate symmetrically"""
     # Calculate the aspect ratio
@@ -249,7 +371,8 @@ def resize_and_truncate(image: Image.Image, target_size: tuple[int, int] = (1600
     return truncated_image
 
 
-def convert_image_to_bin(image_input: str | BytesIO, use_optimizations: bool = True) -> bytes:
+def convert_image_to_bin(image_input: str | BytesIO, use_optimizations: bool = True,
+                         dither: str = DITHER_FLOYD_STEINBERG) -> bytes:
     """
     Reads an image, processes it for the Spectra E6 display, and returns the binary data.
 
@@ -257,13 +380,14 @@ def convert_image_to_bin(image_input: str | BytesIO, use_optimizations: bool = T
     1. Resize/Crop to 1600x1200
     2. Rotate 90 degrees (becoming 1200x1600)
     3. Apply dynamic range compression (if optimizations enabled)
-    4. Apply Floyd-Steinberg dithering with measured palette (if optimizations enabled)
+    4. Apply Floyd-Steinberg or blue-noise dithering with measured palette (if optimizations enabled)
     5. Pack pixels (4 bits per pixel)
 
     Args:
         image_input: Path to image file or BytesIO object
         use_optimizations: If True, use measured palette and dithering (default: True)
                           If False, use legacy quantization method
+        dither: One of DITHER_MODES (default: Floyd-Steinberg)
     """
     if isinstance(image_input, (str, os.PathLike)):
         image = Image.open(image_input)
@@ -288,24 +412,29 @@ def convert_image_to_bin(image_input: str | BytesIO, use_optimizations: bool = T
         print("Compressing dynamic range for e-paper...")
         image_array = compress_dynamic_range(image_array, PALETTE_MEASURED)
 
-        # Step 2: Apply Floyd-Steinberg dithering with measured palette
-        print("Applying Floyd-Steinberg dithering with measured palette...")
-        image_array = floyd_steinberg_dither(image_array, PALETTE_MEASURED, PALETTE_THEORETICAL)
-
-        # Step 3: Map RGB colors to palette indices
-        # Since dithering already outputs theoretical palette colors,
-        # we can do exact matching
-        height, width = image_array.shape[:2]
-        image_data = np.zeros((height, width), dtype=np.uint8)
-
-        for y in range(height):
-            for x in range(width):
-                r, g, b = image_array[y, x]
-                # Find exact match in theoretical palette
-                for idx, (pr, pg, pb) in enumerate(PALETTE_THEORETICAL):
-                    if r == pr and g == pg and b == pb:
-                        image_data[y, x] = idx
-                        break
+        if dither == DITHER_BLUE_NOISE:
+            # Step 2: Blue-noise dithering straight to palette indices
+            print("Applying blue-noise dithering with measured palette...")
+            image_data = blue_noise_dither(image_array, PALETTE_MEASURED)
+        else:
+            # Step 2: Apply Floyd-Steinberg dithering with measured palette
+            print("Applying Floyd-Steinberg dithering with measured palette...")
+            image_array = floyd_steinberg_dither(image_array, PALETTE_MEASURED, PALETTE_THEORETICAL)
+
+            # Step 3: Map RGB colors to palette indices
+            # Since dithering already outputs theoretical palette colors,
+            # we can do exact matching
+            height, width = image_array.shape[:2]
+            image_data = np.zeros((height, width), dtype=np.uint8)
+
+            for y in range(height):
+                for x in range(width):
+                    r, g, b = image_array[y, x]
+                    # Find exact match in theoretical palette
+                    for idx, (pr, pg, pb) in enumerate(PALETTE_THEORETICAL):
+                        if r == pr and g == pg and b == pb:
+                            image_data[y, x] = idx
+                            break
     else:
         # LEGACY PATH: Simple quantization
         # Create palette image for quantization
@@ -0,0 +1,123 @@
+"""Decoder for the CBOR telemetry bodies sent by the firmware.
+
+The device posts /api/device-status and /api/logs as CBOR maps keyed by
+small integer field ids (esp32-client/src/Telemetry.h), or sends a whole
+wake's worth as one UDP datagram. decode() turns them back into the same
+dicts the JSON bodies produce, so handlers do not care which encoding a
+device used.
+"""
+import struct
+
+CONTENT_TYPE = 'application/cbor'
+
+# Field ids, in sync with TM_* in esp32-client/src/Telemetry.h
+FIELDS = {
+    1: 'deviceId',
+    2: 'status',
+    3: 'status',
+    4: 'batteryVoltage',
+    5: 'batteryPercent',
+    6: 'isCharging',
+    7: 'signalStrength',
+    8: 'firmwareVersion',
+    9: 'freeHeap',
+    10: 'psramFree',
+    11: 'uptime',
+    12: 'bootCount',
+    13: 'usedFallback',
+    14: 'logs',
+    15: 'logLevel',
+    16: 'deviceTime',
+    17: 'transitions',
+    18: 'phases',
+    19: 'logs',
+    20: 'droppedLogs',
+}
+
+
+class _Reader:
+    def __init__(self, data: bytes):
+        self.data = data
+        self.pos = 0
+
+    def take(self, n: int) -> bytes:
+        if self.pos + n > len(self.data):
+            raise ValueError("truncated CBOR")
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def argument(self, info: int) -> int:
+        if info < 24:
+            return info
+        if info == 24:
+            return self.take(1)[0]
+        if info == 25:
+            return struct.unpack('>H', self.take(2))[0]
+        if info == 26:
+            return struct.unpack('>I', self.take(4))[0]
+        if info == 27:
+            return struct.unpack('>Q', self.take(8))[0]
+        raise ValueError("indefinite-length CBOR is not supported")
+
+    def item(self, depth: int = 0):
+        if depth > 8:
+            raise ValueError("CBOR nested too deeply")
+        initial = self.take(1)[0]
+        major, info = initial >> 5, initial & 0x1F
+        if major == 7:
+            if info == 20:
+                return False
+            if info == 21:
+                return True
+            if info in (22, 23):
+                return None
+            if info == 25:
+                return struct.unpack('>e', self.take(2))[0]
+            if info == 26:
+                return struct.unpack('>f', self.take(4))[0]
+            if info == 27:
+                return struct.unpack('>d', self.take(8))[0]
+            raise ValueError(f"unsupported CBOR simple value {info}")
+        value = self.argument(info)
+        if major == 0:
+            return value
+        if major == 1:
+            return -1 - value
+        if major == 2:
+            return self.take(value)
+        if major == 3:
+            return self.take(value).decode('utf-8', errors='replace')
+        if major == 4:
+            return [self.item(depth + 1) for _ in range(value)]
+        if major == 5:
+            result = {}
+            for _ in range(value):
+                key = self.item(depth + 1)
+                if isinstance(key, (list, dict)):
+                    raise ValueError("CBOR map keys must be scalars")
+                result[key] = self.item(depth + 1)
+            return result
+        raise ValueError("CBOR tags are not supported")
+
+
+def _named(value):
+    if isinstance(value, dict):
+        return {FIELDS.get(k, k): _named(v) for k, v in value.items()}
+    return value
+
+
+def decode(data: bytes) -> dict:
+    """Decode a telemetry body into a dict with the JSON field names."""
+    reader = _Reader(data)
+    value = reader.item()
+    if reader.pos != len(data):
+        raise ValueError("trailing bytes after CBOR item")
+    if not isinstance(value, dict):
+        raise ValueError("telemetry body is not a map")
+    value = _named(value)
+    # float32 on the wire; 3.7 would otherwise come back as 3.700000047683716
+    status = value.get('status')
+    if isinstance(status, dict) and isinstance(status.get('batteryVoltage'), float):
+        status['batteryVoltage'] = round(status['batteryVoltage'], 3)
+    return value